@@ -0,0 +1,56 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#include "pmp/AsyncMeshWriter.h"
+
+#include "pmp/SurfaceMeshIO.h"
+
+namespace pmp {
+
+AsyncMeshWriter::AsyncMeshWriter()
+    : is_writing_(false), progress_(0.0f), success_(false)
+{
+}
+
+AsyncMeshWriter::~AsyncMeshWriter()
+{
+    wait();
+}
+
+bool AsyncMeshWriter::write(const SurfaceMesh& mesh,
+                            const std::string& filename, const IOFlags& flags)
+{
+    if (is_writing_)
+        return false;
+    if (thread_.joinable())
+        thread_.join();
+
+    // the snapshot shares the data of mesh, copying it is cheap
+    snapshot_ = mesh;
+    filename_ = filename;
+    progress_ = 0.0f;
+    success_ = false;
+    is_writing_ = true;
+
+    thread_ = std::thread([this, flags]() {
+        SurfaceMeshIO writer(filename_, flags);
+        writer.set_progress_callback([this](float p) { progress_ = p; });
+        success_ = writer.write(snapshot_);
+
+        // release the data that is no longer shared with the mesh
+        snapshot_ = SurfaceMesh();
+
+        progress_ = 1.0f;
+        is_writing_ = false;
+    });
+    return true;
+}
+
+bool AsyncMeshWriter::wait()
+{
+    if (thread_.joinable())
+        thread_.join();
+    return success_;
+}
+
+} // namespace pmp
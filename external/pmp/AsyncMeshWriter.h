@@ -0,0 +1,60 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "pmp/SurfaceMesh.h"
+#include "pmp/Types.h"
+
+namespace pmp {
+
+//! \brief Write meshes to files on a background thread.
+//! \details write() takes a snapshot of the mesh, which shares the property
+//! data with the mesh until one of them is modified, hence the caller can
+//! continue to work with the mesh right away.
+//! \ingroup core
+class AsyncMeshWriter
+{
+public:
+    //! Constructor
+    AsyncMeshWriter();
+
+    //! waits for a running write to finish
+    ~AsyncMeshWriter();
+
+    AsyncMeshWriter(const AsyncMeshWriter&) = delete;
+    AsyncMeshWriter& operator=(const AsyncMeshWriter&) = delete;
+
+    //! start writing a snapshot of \p mesh to \p filename, see
+    //! SurfaceMesh::write(). returns false without writing if the previous
+    //! write is still running.
+    bool write(const SurfaceMesh& mesh, const std::string& filename,
+               const IOFlags& flags = IOFlags());
+
+    //! is a write running?
+    bool is_writing() const { return is_writing_; }
+
+    //! fraction of the file written so far, between 0 and 1
+    float progress() const { return progress_; }
+
+    //! name of the file written last
+    const std::string& filename() const { return filename_; }
+
+    //! wait for the running write to finish, returns whether the last write
+    //! succeeded
+    bool wait();
+
+private:
+    SurfaceMesh snapshot_;
+    std::string filename_;
+    std::thread thread_;
+    std::atomic<bool> is_writing_;
+    std::atomic<float> progress_;
+    bool success_;
+};
+
+} // namespace pmp
@@ -0,0 +1,121 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#include "pmp/MappedFile.h"
+
+#include <fstream>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#define PMP_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pmp {
+
+MappedFile::MappedFile(const std::string& filename, bool copy_on_write)
+    : data_(nullptr),
+      size_(0),
+      is_open_(false),
+      is_mapped_(false),
+      file_handle_(nullptr),
+      mapping_handle_(nullptr)
+{
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+        {
+            HANDLE mapping = CreateFileMappingA(
+                file, nullptr, copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY,
+                0, 0, nullptr);
+            if (mapping)
+            {
+                void* view = MapViewOfFile(
+                    mapping, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0,
+                    0, 0);
+                if (view)
+                {
+                    data_ = static_cast<char*>(view);
+                    size_ = size_t(size.QuadPart);
+                    is_open_ = is_mapped_ = true;
+                    file_handle_ = file;
+                    mapping_handle_ = mapping;
+                    return;
+                }
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+    }
+#elif defined(PMP_HAS_MMAP)
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            const int protection =
+                copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+            void* view = mmap(nullptr, size_t(st.st_size), protection,
+                              MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED)
+            {
+                // the text readers scan the file front to back, pages of
+                // copy-on-write mappings are accessed on demand
+                madvise(view, size_t(st.st_size),
+                        copy_on_write ? MADV_NORMAL : MADV_SEQUENTIAL);
+                data_ = static_cast<char*>(view);
+                size_ = size_t(st.st_size);
+                is_open_ = is_mapped_ = true;
+            }
+        }
+        close(fd);
+        if (is_mapped_)
+            return;
+    }
+#endif
+
+    // fall back to reading the whole file (also used for empty files), the
+    // buffer is always writable
+    (void)copy_on_write;
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    if (!in)
+        return;
+    in.seekg(0, std::ios::end);
+    buffer_.resize(size_t(in.tellg()));
+    in.seekg(0, std::ios::beg);
+    if (!buffer_.empty() && !in.read(buffer_.data(), buffer_.size()))
+        return;
+
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+    is_open_ = true;
+}
+
+MappedFile::~MappedFile()
+{
+    if (!is_mapped_)
+        return;
+
+#if defined(_WIN32)
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_handle_);
+    CloseHandle(file_handle_);
+#elif defined(PMP_HAS_MMAP)
+    munmap(data_, size_);
+#endif
+}
+
+} // namespace pmp
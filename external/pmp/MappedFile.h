@@ -0,0 +1,61 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace pmp {
+
+//! \brief Read-only view of the contents of a file.
+//! \details The file is mapped into memory if the platform supports it,
+//! otherwise it is read into a buffer. The contents are not zero-terminated.
+//! \ingroup core
+class MappedFile
+{
+public:
+    //! open and map the file \p filename, check is_open() for success. if
+    //! \p copy_on_write is true the contents can be modified through
+    //! data(), changes stay private to the process and never reach the file.
+    explicit MappedFile(const std::string& filename,
+                        bool copy_on_write = false);
+
+    //! unmap the file
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //! could the file be opened?
+    bool is_open() const { return is_open_; }
+
+    //! pointer to the first byte of the file
+    const char* data() const { return data_; }
+
+    //! pointer to the first byte of the file, only writable if the file was
+    //! opened with copy_on_write
+    char* data() { return data_; }
+
+    //! pointer behind the last byte of the file
+    const char* end() const { return data_ + size_; }
+
+    //! size of the file in bytes
+    size_t size() const { return size_; }
+
+private:
+    char* data_;
+    size_t size_;
+    bool is_open_;
+    bool is_mapped_;
+
+    // platform handles of the mapping
+    void* file_handle_;
+    void* mapping_handle_;
+
+    // file contents if the file could not be mapped
+    std::vector<char> buffer_;
+};
+
+} // namespace pmp
@@ -11,6 +11,15 @@
 #include <limits>
 #include <initializer_list>
 
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PMP_MATVEC_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PMP_MATVEC_NEON
+#include <arm_neon.h>
+#endif
+
 namespace pmp {
 
 //! \addtogroup core
@@ -1103,4 +1112,143 @@ inline Vector<Scalar, 3> cross(const Vector<Scalar, 3>& v0,
 
 //!@}
 
+//! \name SIMD overloads for float matrices
+//! \details These non-template overloads take precedence over the generic
+//! implementations above for mat4 and vec4. They operate directly on the
+//! column-major data of the matrices (with unaligned loads and stores), so
+//! the memory layout stays a plain array of floats. The order of floating
+//! point operations is the same as in the generic code.
+//!@{
+
+#if defined(PMP_MATVEC_SSE)
+
+//! matrix-vector multiplication for mat4 and vec4 (SSE)
+inline vec4 operator*(const mat4& m, const vec4& v)
+{
+    const float* a = m.data();
+    const __m128 x = _mm_loadu_ps(v.data());
+    const __m128 x0 = _mm_shuffle_ps(x, x, _MM_SHUFFLE(0, 0, 0, 0));
+    const __m128 x1 = _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 1, 1, 1));
+    const __m128 x2 = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 2, 2, 2));
+    const __m128 x3 = _mm_shuffle_ps(x, x, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128 r = _mm_mul_ps(_mm_loadu_ps(a), x0);
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(a + 4), x1));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(a + 8), x2));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(a + 12), x3));
+    vec4 result;
+    _mm_storeu_ps(result.data(), r);
+    return result;
+}
+
+//! matrix-matrix multiplication for mat4 (SSE)
+inline mat4 operator*(const mat4& m1, const mat4& m2)
+{
+    const float* a = m1.data();
+    const __m128 c0 = _mm_loadu_ps(a), c1 = _mm_loadu_ps(a + 4),
+                 c2 = _mm_loadu_ps(a + 8), c3 = _mm_loadu_ps(a + 12);
+    mat4 result;
+    for (int j = 0; j < 4; ++j)
+    {
+        const float* b = m2.data() + 4 * j;
+        __m128 r = _mm_mul_ps(c0, _mm_set1_ps(b[0]));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(b[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(b[2])));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_set1_ps(b[3])));
+        _mm_storeu_ps(result.data() + 4 * j, r);
+    }
+    return result;
+}
+
+//! inverse of a mat4 (SSE), vectorized version of the generic inverse()
+inline mat4 inverse(const mat4& m)
+{
+    const float* a = m.data();
+    __m128 r0 = _mm_loadu_ps(a), r1 = _mm_loadu_ps(a + 4),
+           r2 = _mm_loadu_ps(a + 8), r3 = _mm_loadu_ps(a + 12);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3); // now r_i is the i'th row
+
+    // Fac(r,s) = (Coef, Coef, Coef, Coef) of the generic version, i.e.,
+    // (r2*s3 - r3*s2, r2*s3 - r3*s2, r1*s3 - r3*s1, r1*s2 - r2*s1)
+    auto fac = [](__m128 r, __m128 s) {
+        const __m128 a = _mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 2, 2));
+        const __m128 b = _mm_shuffle_ps(s, s, _MM_SHUFFLE(2, 3, 3, 3));
+        const __m128 c = _mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 3, 3, 3));
+        const __m128 d = _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 1, 2, 2));
+        return _mm_sub_ps(_mm_mul_ps(a, b), _mm_mul_ps(c, d));
+    };
+    const __m128 fac0 = fac(r2, r3), fac1 = fac(r1, r3), fac2 = fac(r1, r2),
+                 fac3 = fac(r0, r3), fac4 = fac(r0, r2), fac5 = fac(r0, r1);
+
+    // Vec_i = (m(i,1), m(i,0), m(i,0), m(i,0))
+    const __m128 vec0 = _mm_shuffle_ps(r0, r0, _MM_SHUFFLE(0, 0, 0, 1));
+    const __m128 vec1 = _mm_shuffle_ps(r1, r1, _MM_SHUFFLE(0, 0, 0, 1));
+    const __m128 vec2 = _mm_shuffle_ps(r2, r2, _MM_SHUFFLE(0, 0, 0, 1));
+    const __m128 vec3 = _mm_shuffle_ps(r3, r3, _MM_SHUFFLE(0, 0, 0, 1));
+
+    const __m128 sign_a = _mm_setr_ps(+1, -1, +1, -1);
+    const __m128 sign_b = _mm_setr_ps(-1, +1, -1, +1);
+
+    // x*p - y*q + z*r
+    auto combine = [](__m128 x, __m128 p, __m128 y, __m128 q, __m128 z,
+                      __m128 r) {
+        return _mm_add_ps(_mm_sub_ps(_mm_mul_ps(x, p), _mm_mul_ps(y, q)),
+                          _mm_mul_ps(z, r));
+    };
+    __m128 inv[4];
+    inv[0] = _mm_mul_ps(sign_a, combine(vec1, fac0, vec2, fac1, vec3, fac2));
+    inv[1] = _mm_mul_ps(sign_b, combine(vec0, fac0, vec2, fac3, vec3, fac4));
+    inv[2] = _mm_mul_ps(sign_a, combine(vec0, fac1, vec1, fac3, vec3, fac5));
+    inv[3] = _mm_mul_ps(sign_b, combine(vec0, fac2, vec1, fac4, vec2, fac5));
+
+    // determinant from first row of m and first column of the inverse
+    float col0[4];
+    _mm_storeu_ps(col0, inv[0]);
+    const float det = m(0, 0) * col0[0] + m(0, 1) * col0[1] +
+                      m(0, 2) * col0[2] + m(0, 3) * col0[3];
+
+    const __m128 d = _mm_set1_ps(det);
+    mat4 result;
+    for (int j = 0; j < 4; ++j)
+        _mm_storeu_ps(result.data() + 4 * j, _mm_div_ps(inv[j], d));
+    return result;
+}
+
+#elif defined(PMP_MATVEC_NEON)
+
+//! matrix-vector multiplication for mat4 and vec4 (NEON)
+inline vec4 operator*(const mat4& m, const vec4& v)
+{
+    const float* a = m.data();
+    float32x4_t r = vmulq_n_f32(vld1q_f32(a), v[0]);
+    r = vaddq_f32(r, vmulq_n_f32(vld1q_f32(a + 4), v[1]));
+    r = vaddq_f32(r, vmulq_n_f32(vld1q_f32(a + 8), v[2]));
+    r = vaddq_f32(r, vmulq_n_f32(vld1q_f32(a + 12), v[3]));
+    vec4 result;
+    vst1q_f32(result.data(), r);
+    return result;
+}
+
+//! matrix-matrix multiplication for mat4 (NEON)
+inline mat4 operator*(const mat4& m1, const mat4& m2)
+{
+    const float* a = m1.data();
+    const float32x4_t c0 = vld1q_f32(a), c1 = vld1q_f32(a + 4),
+                      c2 = vld1q_f32(a + 8), c3 = vld1q_f32(a + 12);
+    mat4 result;
+    for (int j = 0; j < 4; ++j)
+    {
+        const float* b = m2.data() + 4 * j;
+        float32x4_t r = vmulq_n_f32(c0, b[0]);
+        r = vaddq_f32(r, vmulq_n_f32(c1, b[1]));
+        r = vaddq_f32(r, vmulq_n_f32(c2, b[2]));
+        r = vaddq_f32(r, vmulq_n_f32(c3, b[3]));
+        vst1q_f32(result.data() + 4 * j, r);
+    }
+    return result;
+}
+
+#endif
+
+//!@}
+
 } // namespace pmp
@@ -0,0 +1,186 @@
+// Copyright 2017-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#include "pmp/MemoryUsage.h"
+
+#if defined _WIN32
+#include <windows.h>
+#include <psapi.h>
+#elif defined __linux__
+#include <sys/resource.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#elif defined __APPLE__
+#include <sys/resource.h>
+#include <mach/mach.h>
+#include <iostream>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+namespace pmp {
+
+namespace {
+
+// number of records kept by MemoryUsage::record()
+const size_t max_records = 16;
+
+std::mutex records_mutex;
+std::deque<MemoryRecord> recent_records;
+
+// number of MemoryScopes alive
+std::atomic<int> n_active_scopes(0);
+
+} // namespace
+
+size_t MemoryUsage::max_size()
+{
+#if defined(_WIN32)
+
+    PROCESS_MEMORY_COUNTERS info;
+    GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info));
+    return (size_t)info.PeakWorkingSetSize;
+
+#elif defined(__linux__) || defined(__APPLE__)
+
+    struct rusage rusage;
+    getrusage(RUSAGE_SELF, &rusage);
+
+#if defined(__APPLE__)
+    return (size_t)rusage.ru_maxrss;
+#else
+    return (size_t)(rusage.ru_maxrss * 1024);
+#endif
+
+#endif
+    return 0;
+}
+
+size_t MemoryUsage::current_size()
+{
+#if defined(_WIN32)
+
+    PROCESS_MEMORY_COUNTERS info;
+    GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info));
+    return (size_t)info.WorkingSetSize;
+
+#elif defined(__linux__)
+
+    long rss = 0;
+    FILE* fp = nullptr;
+
+    if ((fp = fopen("/proc/self/statm", "r")) == nullptr)
+    {
+        std::cerr << "Failed to read process information file" << std::endl;
+        return 0;
+    }
+
+    if (fscanf(fp, "%*s%ld", &rss) != 1)
+    {
+        std::cerr << "Failed to retrieve RSS information" << std::endl;
+        fclose(fp);
+        return 0;
+    }
+
+    fclose(fp);
+    return (size_t)rss * (size_t)sysconf(_SC_PAGESIZE);
+
+#elif defined(__APPLE__)
+
+    struct mach_task_basic_info info;
+    mach_msg_type_number_t infoCount = MACH_TASK_BASIC_INFO_COUNT;
+    auto ret = task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                         (task_info_t)&info, &infoCount);
+    if (ret != KERN_SUCCESS)
+    {
+        std::cerr << "Failed to retrieve task information" << std::endl;
+        return 0;
+    }
+    return (size_t)info.resident_size;
+
+#else
+    return 0;
+#endif
+}
+
+bool MemoryUsage::reset_peak()
+{
+#if defined(__linux__)
+
+    // writing 5 resets the peak RSS (VmHWM) of the process
+    FILE* fp = fopen("/proc/self/clear_refs", "w");
+    if (!fp)
+        return false;
+    const bool ok = fputs("5", fp) >= 0;
+    return (fclose(fp) == 0) && ok;
+
+#else
+    return false;
+#endif
+}
+
+size_t MemoryUsage::peak_size()
+{
+#if defined(__linux__)
+
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (fp)
+    {
+        char line[128];
+        long hwm = -1;
+        while (fgets(line, sizeof(line), fp))
+        {
+            if (strncmp(line, "VmHWM:", 6) == 0)
+            {
+                if (sscanf(line + 6, "%ld", &hwm) != 1)
+                    hwm = -1;
+                break;
+            }
+        }
+        fclose(fp);
+        if (hwm >= 0)
+            return (size_t)hwm * 1024;
+    }
+
+#endif
+    return max_size();
+}
+
+void MemoryUsage::record(const MemoryRecord& record)
+{
+    std::lock_guard<std::mutex> lock(records_mutex);
+    recent_records.push_back(record);
+    if (recent_records.size() > max_records)
+        recent_records.pop_front();
+}
+
+std::vector<MemoryRecord> MemoryUsage::records()
+{
+    std::lock_guard<std::mutex> lock(records_mutex);
+    return std::vector<MemoryRecord>(recent_records.begin(),
+                                     recent_records.end());
+}
+
+MemoryScope::MemoryScope(const char* name)
+{
+    if (n_active_scopes++ == 0)
+        MemoryUsage::reset_peak();
+    record_.operation = name;
+    record_.before = MemoryUsage::current_size();
+}
+
+MemoryScope::~MemoryScope()
+{
+    record_.after = MemoryUsage::current_size();
+    record_.peak = std::max(MemoryUsage::peak_size(),
+                            std::max(record_.before, record_.after));
+    --n_active_scopes;
+    MemoryUsage::record(record_);
+}
+
+} // namespace pmp
@@ -3,20 +3,32 @@
 
 #pragma once
 
-#if defined _WIN32
-#include <psapi.h>
-#include <windows.h>
-#elif defined __linux__
-#include <sys/resource.h>
-#include <unistd.h>
-#include <cstdio>
-#include <iostream>
-#elif defined __APPLE__
-#include <mach/mach.h>
-#endif
+#include <cstddef>
+#include <string>
+#include <vector>
 
 namespace pmp {
 
+//! Memory used by an operation, see MemoryUsage::records().
+//! \ingroup core
+struct MemoryRecord
+{
+    //! name of the operation
+    std::string operation;
+
+    //! resident set size before the operation, in bytes
+    size_t before = 0;
+
+    //! peak resident set size during the operation, in bytes
+    size_t peak = 0;
+
+    //! resident set size after the operation, in bytes
+    size_t after = 0;
+
+    //! bytes of GPU buffers held after the operation, if it manages any
+    size_t gpu = 0;
+};
+
 //! A simple class to retrieve memory usage information.
 //! \ingroup core
 class MemoryUsage
@@ -29,76 +41,46 @@ public:
     //! \brief Get the currently used memory.
     //! \return the current resident set size (RSS) in bytes
     static size_t current_size();
-};
 
-size_t MemoryUsage::max_size()
-{
-#if defined(_WIN32)
+    //! \brief Restart measuring the peak memory for peak_size().
+    //! \return false if the platform cannot reset the peak, then peak_size()
+    //! returns max_size()
+    static bool reset_peak();
 
-    PROCESS_MEMORY_COUNTERS info;
-    GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info));
-    return (size_t)info.PeakWorkingSetSize;
+    //! \brief Get the peak memory since the last reset_peak().
+    //! \return the peak resident set size (RSS) in bytes
+    static size_t peak_size();
 
-#elif defined(__linux__) || defined(__APPLE__)
+    //! Add \p record to the log of recent operations, the log keeps the
+    //! last 16 records.
+    static void record(const MemoryRecord& record);
 
-    struct rusage rusage;
-    getrusage(RUSAGE_SELF, &rusage);
+    //! The recent operations, oldest first.
+    static std::vector<MemoryRecord> records();
+};
 
-#if defined(__APPLE__)
-    return (size_t)rusage.ru_maxrss;
-#else
-    return (size_t)(rusage.ru_maxrss * 1024);
-#endif
+//! \brief Records the memory used from construction to destruction.
+//! \details Adds a MemoryRecord to MemoryUsage::records() when destroyed.
+//! Scopes running at the same time, nested or in other threads, share one
+//! peak measurement: only the first of them restarts it.
+//! \ingroup core
+class MemoryScope
+{
+public:
+    //! start measuring operation \p name
+    explicit MemoryScope(const char* name);
 
-#endif
-    return 0;
-}
+    //! record the operation
+    ~MemoryScope();
 
-size_t MemoryUsage::current_size()
-{
-#if defined(_WIN32)
-
-    PROCESS_MEMORY_COUNTERS info;
-    GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info));
-    return (size_t)info.WorkingSetSize;
-
-#elif defined(__linux__)
-
-    long rss = 0;
-    FILE* fp = nullptr;
-
-    if ((fp = fopen("/proc/self/statm", "r")) == nullptr)
-    {
-        std::cerr << "Failed to read process information file" << std::endl;
-        return 0;
-    }
-
-    if (fscanf(fp, "%*s%ld", &rss) != 1)
-    {
-        std::cerr << "Failed to retrieve RSS information" << std::endl;
-        fclose(fp);
-        return 0;
-    }
-
-    fclose(fp);
-    return (size_t)rss * (size_t)sysconf(_SC_PAGESIZE);
-
-#elif defined(__APPLE__)
-
-    struct mach_task_basic_info info;
-    mach_msg_type_number_t infoCount = MACH_TASK_BASIC_INFO_COUNT;
-    auto ret = task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
-                         (task_info_t)&info, &infoCount);
-    if (ret != KERN_SUCCESS)
-    {
-        std::cerr << "Failed to retrieve task information" << std::endl;
-        return 0;
-    }
-    return (size_t)info.resident_size;
-
-#else
-    return 0;
-#endif
-}
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+    //! set the bytes of GPU buffers held after the operation
+    void set_gpu(size_t bytes) { record_.gpu = bytes; }
+
+private:
+    MemoryRecord record_;
+};
 
 } // namespace pmp
@@ -0,0 +1,243 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#include "pmp/PointKernels.h"
+
+#include <cmath>
+#include <limits>
+
+#if !defined(PMP_SCALAR_TYPE_64) &&                                            \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define PMP_POINT_KERNELS_SSE
+#include <emmintrin.h>
+#endif
+
+namespace pmp {
+
+static_assert(sizeof(Point) == 3 * sizeof(Scalar),
+              "points have to be stored as packed (x,y,z) triples");
+
+#ifdef PMP_POINT_KERNELS_SSE
+
+namespace {
+
+// transpose four points, loaded as a=(x0,y0,z0,x1), b=(y1,z1,x2,y2),
+// c=(z2,x3,y3,z3), into x=(x0,x1,x2,x3), y=(y0,...), z=(z0,...)
+inline void transpose(__m128 a, __m128 b, __m128 c, __m128& x, __m128& y,
+                      __m128& z)
+{
+    x = _mm_shuffle_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 3, 0)),
+                       _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)),
+                       _MM_SHUFFLE(2, 0, 1, 0));
+    y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+                       _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),
+                       _MM_SHUFFLE(2, 0, 2, 0));
+    z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+                       _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 3, 0)),
+                       _MM_SHUFFLE(1, 0, 2, 0));
+}
+
+// inverse of transpose(), stores the four points to p
+inline void store(__m128 x, __m128 y, __m128 z, float* p)
+{
+    const __m128 a =
+        _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)),
+                       _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)),
+                       _MM_SHUFFLE(2, 0, 2, 0));
+    const __m128 b =
+        _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)),
+                       _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)),
+                       _MM_SHUFFLE(2, 0, 2, 0));
+    const __m128 c =
+        _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)),
+                       _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)),
+                       _MM_SHUFFLE(2, 0, 2, 0));
+    _mm_storeu_ps(p, a);
+    _mm_storeu_ps(p + 4, b);
+    _mm_storeu_ps(p + 8, c);
+}
+
+} // namespace
+
+#endif
+
+BoundingBox bounds(const Point* p, size_t n)
+{
+    BoundingBox bb;
+    size_t i = 0;
+
+#ifdef PMP_POINT_KERNELS_SSE
+    if (n >= 4)
+    {
+        // lane k of register r holds coordinate (4r+k) % 3
+        const float* f = reinterpret_cast<const float*>(p);
+        __m128 lo[3], hi[3];
+        for (int r = 0; r < 3; ++r)
+            lo[r] = hi[r] = _mm_loadu_ps(f + 4 * r);
+
+        for (i = 4; i + 4 <= n; i += 4)
+        {
+            f = reinterpret_cast<const float*>(p + i);
+            for (int r = 0; r < 3; ++r)
+            {
+                const __m128 v = _mm_loadu_ps(f + 4 * r);
+                lo[r] = _mm_min_ps(lo[r], v);
+                hi[r] = _mm_max_ps(hi[r], v);
+            }
+        }
+
+        float l[12], h[12];
+        for (int r = 0; r < 3; ++r)
+        {
+            _mm_storeu_ps(l + 4 * r, lo[r]);
+            _mm_storeu_ps(h + 4 * r, hi[r]);
+        }
+        for (int k = 0; k < 12; k += 3)
+            bb += BoundingBox(Point(l[k], l[k + 1], l[k + 2]),
+                              Point(h[k], h[k + 1], h[k + 2]));
+    }
+#endif
+
+    for (; i < n; ++i)
+        bb += p[i];
+
+    return bb;
+}
+
+Point centroid(const Point* p, size_t n)
+{
+    // accumulate in double precision to be robust for large meshes
+    double s[3] = {0.0, 0.0, 0.0};
+    size_t i = 0;
+
+#ifdef PMP_POINT_KERNELS_SSE
+    __m128d acc[6];
+    for (int r = 0; r < 6; ++r)
+        acc[r] = _mm_setzero_pd();
+
+    for (; i + 4 <= n; i += 4)
+    {
+        const float* f = reinterpret_cast<const float*>(p + i);
+        for (int r = 0; r < 3; ++r)
+        {
+            const __m128 v = _mm_loadu_ps(f + 4 * r);
+            acc[2 * r] = _mm_add_pd(acc[2 * r], _mm_cvtps_pd(v));
+            acc[2 * r + 1] =
+                _mm_add_pd(acc[2 * r + 1], _mm_cvtps_pd(_mm_movehl_ps(v, v)));
+        }
+    }
+
+    double t[12];
+    for (int r = 0; r < 6; ++r)
+        _mm_storeu_pd(t + 2 * r, acc[r]);
+    for (int k = 0; k < 12; ++k)
+        s[k % 3] += t[k];
+#endif
+
+    for (; i < n; ++i)
+        for (int j = 0; j < 3; ++j)
+            s[j] += p[i][j];
+
+    if (n == 0)
+        return Point(0, 0, 0);
+    return Point(s[0] / n, s[1] / n, s[2] / n);
+}
+
+void transform(const Mat4<Scalar>& m, Point* p, size_t n)
+{
+    size_t i = 0;
+
+#ifdef PMP_POINT_KERNELS_SSE
+    __m128 mm[3][4];
+    for (int r = 0; r < 3; ++r)
+        for (int c = 0; c < 4; ++c)
+            mm[r][c] = _mm_set1_ps(m(r, c));
+
+    const int nb = int(n / 4);
+#pragma omp parallel for
+    for (int b = 0; b < nb; ++b)
+    {
+        float* f = &p[4 * b][0];
+        __m128 v[3], t[3];
+        transpose(_mm_loadu_ps(f), _mm_loadu_ps(f + 4), _mm_loadu_ps(f + 8),
+                  v[0], v[1], v[2]);
+
+        // same order of operations as affine_transform()
+        for (int r = 0; r < 3; ++r)
+            t[r] = _mm_add_ps(
+                _mm_add_ps(_mm_add_ps(_mm_mul_ps(mm[r][0], v[0]),
+                                      _mm_mul_ps(mm[r][1], v[1])),
+                           _mm_mul_ps(mm[r][2], v[2])),
+                mm[r][3]);
+
+        store(t[0], t[1], t[2], f);
+    }
+    i = 4 * size_t(nb);
+#endif
+
+    for (; i < n; ++i)
+        p[i] = affine_transform(m, p[i]);
+}
+
+void triangle_normals(const Point* p, const IndexType* triangles, size_t n,
+                      Normal* normals)
+{
+    size_t i = 0;
+
+#ifdef PMP_POINT_KERNELS_SSE
+    const __m128 eps = _mm_set1_ps(std::numeric_limits<float>::min());
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    const int nb = int(n / 4);
+#pragma omp parallel for
+    for (int b = 0; b < nb; ++b)
+    {
+        const IndexType* t = triangles + 12 * b;
+
+        // gather the three corners of four triangles
+        __m128 c[3][3];
+        for (int j = 0; j < 3; ++j)
+            for (int k = 0; k < 3; ++k)
+                c[j][k] = _mm_setr_ps(p[t[j]][k], p[t[j + 3]][k],
+                                      p[t[j + 6]][k], p[t[j + 9]][k]);
+
+        // e1 = p2-p1, e2 = p0-p1
+        __m128 e1[3], e2[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            e1[k] = _mm_sub_ps(c[2][k], c[1][k]);
+            e2[k] = _mm_sub_ps(c[0][k], c[1][k]);
+        }
+
+        // cross(e1, e2)
+        const __m128 nx = _mm_sub_ps(_mm_mul_ps(e1[1], e2[2]),
+                                     _mm_mul_ps(e1[2], e2[1]));
+        const __m128 ny = _mm_sub_ps(_mm_mul_ps(e1[2], e2[0]),
+                                     _mm_mul_ps(e1[0], e2[2]));
+        const __m128 nz = _mm_sub_ps(_mm_mul_ps(e1[0], e2[1]),
+                                     _mm_mul_ps(e1[1], e2[0]));
+
+        // normalize, degenerate triangles get a zero normal
+        const __m128 len = _mm_sqrt_ps(
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)),
+                       _mm_mul_ps(nz, nz)));
+        const __m128 s =
+            _mm_and_ps(_mm_cmpgt_ps(len, eps), _mm_div_ps(one, len));
+
+        store(_mm_mul_ps(nx, s), _mm_mul_ps(ny, s), _mm_mul_ps(nz, s),
+              &normals[4 * b][0]);
+    }
+    i = 4 * size_t(nb);
+#endif
+
+    for (; i < n; ++i)
+    {
+        const Point& p0 = p[triangles[3 * i]];
+        const Point& p1 = p[triangles[3 * i + 1]];
+        const Point& p2 = p[triangles[3 * i + 2]];
+        normals[i] = normalize(cross(p2 - p1, p0 - p1));
+    }
+}
+
+} // namespace pmp
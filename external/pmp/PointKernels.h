@@ -0,0 +1,45 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#pragma once
+
+#include <cstddef>
+
+#include "pmp/Types.h"
+#include "pmp/BoundingBox.h"
+
+namespace pmp {
+
+//! \addtogroup core
+//!@{
+
+//! \name Point array kernels
+//! \details These functions process plain arrays of points, e.g., the vector
+//! returned by SurfaceMesh::positions(). Points are stored as contiguous
+//! (x,y,z) triples, such that four consecutive points span three 16-byte SIMD
+//! registers. Each block of four points is transposed into (xxxx, yyyy, zzzz)
+//! registers, processed, and transposed back. If SSE is not available (or
+//! Scalar is double) a scalar implementation is used instead.
+//!@{
+
+//! compute the bounding box of the \p n points \p p
+BoundingBox bounds(const Point* p, size_t n);
+
+//! compute the centroid (average) of the \p n points \p p
+Point centroid(const Point* p, size_t n);
+
+//! transform the \p n points \p p by the affine transformation \p m, i.e.,
+//! the last row of \p m is ignored. \sa affine_transform()
+void transform(const Mat4<Scalar>& m, Point* p, size_t n);
+
+//! compute the normals \p normals of the \p n triangles given by the vertex
+//! indices \p triangles (three per triangle) into the point array \p p.
+//! for triangle (i,j,k) the normal is normalize(cross(p[k]-p[j], p[i]-p[j])),
+//! which matches SurfaceNormals::compute_face_normal().
+void triangle_normals(const Point* p, const IndexType* triangles, size_t n,
+                      Normal* normals);
+
+//!@}
+//!@}
+
+} // namespace pmp
@@ -5,15 +5,39 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
 
+#include <atomic>
+#include <bitset>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <algorithm>
 #include <typeinfo>
 #include <iostream>
+#include <utility>
+
+#include "pmp/Types.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace pmp {
 
+//! Memory used by a property array, see PropertyContainer::memory_usage().
+//! Only counts the elements themselves, not memory they own (e.g., the
+//! characters of std::string elements).
+struct PropertyMemory
+{
+    std::string name;      //!< name of the property
+    size_t used = 0;       //!< bytes occupied by the elements
+    size_t reserved = 0;   //!< bytes allocated on the heap for the elements
+    bool shared = false;   //!< data is shared with a copy (copy-on-write)
+    bool mapped = false;   //!< data is external memory, see map()
+};
+
 class BasePropertyArray
 {
 public:
@@ -38,11 +62,21 @@ public:
     //! Let two elements swap their storage place.
     virtual void swap(size_t i0, size_t i1) = 0;
 
-    //! Return a deep copy of self.
+    //! Shrink storage to \p n elements. Element n+i is moved to the vacant
+    //! position map[i] < n, or dropped if map[i] is PMP_MAX_INDEX.
+    virtual void compact(size_t n, const std::vector<IndexType>& map) = 0;
+
+    //! Reorder the elements such that element i becomes old element perm[i].
+    virtual void permute(const std::vector<IndexType>& perm) = 0;
+
+    //! Return a copy of self, sharing the data until either is modified.
     virtual BasePropertyArray* clone() const = 0;
 
     //! Return the type_info of the property
-    virtual const std::type_info& type() = 0;
+    virtual const std::type_info& type() const = 0;
+
+    //! Return the memory used by the property
+    virtual PropertyMemory memory() const = 0;
 
     //! Return the name of the property
     const std::string& name() const { return name_; }
@@ -51,69 +85,449 @@ protected:
     std::string name_;
 };
 
+//! Storage of bool properties as packed 64-bit words. Implements the part
+//! of the std::vector interface used by PropertyArray, and additionally
+//! allows to skip runs of set bits one word at a time.
+class BitVector
+{
+public:
+    typedef std::uint64_t Word;
+
+    //! Proxy reference to a single bit.
+    class reference
+    {
+    public:
+        reference(Word* word, Word mask) : word_(word), mask_(mask) {}
+
+        operator bool() const { return (*word_ & mask_) != 0; }
+
+        reference& operator=(bool b)
+        {
+            if (b)
+                *word_ |= mask_;
+            else
+                *word_ &= ~mask_;
+            return *this;
+        }
+
+        reference& operator=(const reference& r) { return *this = bool(r); }
+
+    private:
+        Word* word_;
+        Word mask_;
+    };
+
+    typedef bool const_reference;
+
+    BitVector() : size_(0) {}
+
+    size_t size() const { return size_; }
+
+    size_t capacity() const { return words_.capacity() * 64; }
+
+    void reserve(size_t n) { words_.reserve(n_words(n)); }
+
+    void resize(size_t n, bool value = false)
+    {
+        // bits beyond size_ are always zero, see below
+        words_.resize(n_words(n), value ? ~Word(0) : Word(0));
+        if (value)
+            for (size_t i = size_; i < n && (i & 63); ++i)
+                (*this)[i] = true;
+        size_ = n;
+        if (size_ & 63)
+            words_.back() &= ~(~Word(0) << (size_ & 63));
+    }
+
+    void push_back(bool b)
+    {
+        if (!(size_ & 63))
+            words_.push_back(0);
+        if (b)
+            words_.back() |= Word(1) << (size_ & 63);
+        ++size_;
+    }
+
+    void swap(BitVector& rhs)
+    {
+        words_.swap(rhs.words_);
+        std::swap(size_, rhs.size_);
+    }
+
+    reference operator[](size_t i)
+    {
+        return reference(&words_[i >> 6], Word(1) << (i & 63));
+    }
+
+    const_reference operator[](size_t i) const
+    {
+        return (words_[i >> 6] >> (i & 63)) & 1;
+    }
+
+    //! number of set bits
+    size_t count() const
+    {
+        size_t n = 0;
+        for (size_t w = 0; w < words_.size(); ++w)
+            n += std::bitset<64>(words_[w]).count();
+        return n;
+    }
+
+    //! the packed bits, bits beyond size() are zero (used for file IO)
+    const std::vector<Word>& words() const { return words_; }
+
+    //! the packed bits, bits beyond size() have to stay zero
+    std::vector<Word>& words() { return words_; }
+
+    //! index of the first unset bit at or after \p i, or max(i, size()) if
+    //! there is none
+    size_t find_next_unset(size_t i) const
+    {
+        if (i >= size_)
+            return i;
+        size_t w = i >> 6;
+        Word bits = ~words_[w] & (~Word(0) << (i & 63));
+        while (!bits)
+        {
+            if (++w == words_.size())
+                return size_;
+            bits = ~words_[w];
+        }
+        return std::min(size_, (w << 6) + trailing_zeros(bits));
+    }
+
+private:
+    static size_t n_words(size_t n) { return (n + 63) >> 6; }
+
+    static unsigned int trailing_zeros(Word w)
+    {
+        assert(w != 0);
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(w);
+#elif defined(_MSC_VER) && defined(_WIN64)
+        unsigned long i;
+        _BitScanForward64(&i, w);
+        return i;
+#else
+        unsigned int i = 0;
+        for (; !(w & 1); w >>= 1)
+            ++i;
+        return i;
+#endif
+    }
+
+    std::vector<Word> words_;
+    size_t size_;
+};
+
+//! Selects the storage of a PropertyArray<T>, bool properties are bit-packed.
+//! Pointer gives direct element access without going through the vector.
+template <class T>
+struct PropertyStorage
+{
+    typedef std::vector<T> VectorType;
+    typedef T* Pointer;
+
+    static Pointer pointer(VectorType& v) { return v.data(); }
+    static VectorType copy(Pointer p, size_t n) { return VectorType(p, p + n); }
+    static size_t bytes(size_t n) { return n * sizeof(T); }
+    static T& at(Pointer p, size_t i) { return p[i]; }
+    static const T& const_at(Pointer p, size_t i) { return p[i]; }
+};
+
+template <>
+struct PropertyStorage<bool>
+{
+    typedef BitVector VectorType;
+    typedef BitVector* Pointer;
+
+    static Pointer pointer(VectorType& v) { return &v; }
+    static VectorType copy(Pointer p, size_t) { return *p; }
+    static size_t bytes(size_t n)
+    {
+        return (n + 63) / 64 * sizeof(BitVector::Word);
+    }
+    static BitVector::reference at(Pointer p, size_t i) { return (*p)[i]; }
+    static bool const_at(Pointer p, size_t i)
+    {
+        return static_cast<const BitVector&>(*p)[i];
+    }
+};
+
+//! Typed property array. Copies (by clone() or assignment) share their data
+//! until one of them is modified, at which point the modified array makes
+//! its own copy (copy-on-write). Const access never copies. The data can also
+//! be external memory, e.g., a memory-mapped file, see map().
 template <class T>
 class PropertyArray : public BasePropertyArray
 {
 public:
     typedef T ValueType;
-    typedef std::vector<ValueType> VectorType;
+    typedef PropertyStorage<T> Storage;
+    typedef typename Storage::VectorType VectorType;
     typedef typename VectorType::reference reference;
     typedef typename VectorType::const_reference const_reference;
 
     PropertyArray(const std::string& name, T t = T())
-        : BasePropertyArray(name), value_(t)
+        : BasePropertyArray(name),
+          data_(std::make_shared<VectorType>()),
+          ptr_(Storage::pointer(*data_)),
+          value_(t),
+          shared_(false),
+          mapped_(false),
+          mapped_size_(0)
     {
     }
 
+    //! Assign \p rhs, the data is shared until either array is modified.
+    PropertyArray& operator=(const PropertyArray& rhs)
+    {
+        if (this != &rhs)
+        {
+            name_ = rhs.name_;
+            value_ = rhs.value_;
+            share(rhs);
+        }
+        return *this;
+    }
+
 public: // virtual interface of BasePropertyArray
-    virtual void reserve(size_t n) { data_.reserve(n); }
+    virtual void reserve(size_t n)
+    {
+        write().reserve(n);
+        update();
+    }
 
-    virtual void resize(size_t n) { data_.resize(n, value_); }
+    virtual void resize(size_t n)
+    {
+        if (n != size())
+        {
+            write().resize(n, value_);
+            update();
+        }
+    }
 
-    virtual void push_back() { data_.push_back(value_); }
+    virtual void push_back()
+    {
+        write().push_back(value_);
+        update();
+    }
 
-    virtual void free_memory() { VectorType(data_).swap(data_); }
+    virtual void free_memory()
+    {
+        // a private copy made by detach() is already tight, and mapped data
+        // does not occupy heap memory
+        if (mapped_)
+            return;
+        if (!(shared_ && detach()))
+        {
+            VectorType(*data_).swap(*data_);
+            update();
+        }
+    }
 
     virtual void swap(size_t i0, size_t i1)
     {
-        T d(data_[i0]);
-        data_[i0] = data_[i1];
-        data_[i1] = d;
+        VectorType& data = write();
+        T d(data[i0]);
+        data[i0] = data[i1];
+        data[i1] = d;
+    }
+
+    virtual void compact(size_t n, const std::vector<IndexType>& map)
+    {
+        VectorType& data = write();
+        assert(n + map.size() == data.size());
+        for (size_t i = 0; i < map.size(); ++i)
+            if (map[i] != PMP_MAX_INDEX)
+                data[map[i]] = std::move(data[n + i]);
+        data.resize(n, value_);
+        update();
+    }
+
+    virtual void permute(const std::vector<IndexType>& perm)
+    {
+        VectorType& data = write();
+        assert(perm.size() == data.size());
+        VectorType tmp;
+        tmp.reserve(perm.size());
+        for (size_t i = 0; i < perm.size(); ++i)
+            tmp.push_back(std::move(data[perm[i]]));
+        data.swap(tmp);
+        update();
     }
 
     virtual BasePropertyArray* clone() const
     {
         PropertyArray<T>* p = new PropertyArray<T>(name_, value_);
-        p->data_ = data_;
+        p->share(*this);
         return p;
     }
 
-    virtual const std::type_info& type() { return typeid(T); }
+    virtual const std::type_info& type() const { return typeid(T); }
+
+    virtual PropertyMemory memory() const
+    {
+        PropertyMemory m;
+        m.name = name_;
+        m.used = Storage::bytes(size());
+        m.reserved = Storage::bytes(data_->capacity());
+        m.shared = is_shared();
+        m.mapped = is_mapped();
+        return m;
+    }
 
 public:
     //! Get pointer to array (does not work for T==bool)
-    const T* data() const { return &data_[0]; }
+    const T* data() const { return ptr_; }
+
+    //! Get reference to the underlying vector. Its size must not be changed
+    //! directly, use the PropertyContainer functions instead.
+    VectorType& vector() { return write(); }
+
+    //! Get const reference to the underlying vector. Mapped data is copied
+    //! to the heap first. Concurrent const access stays safe, since the
+    //! element pointer keeps pointing to the (identical) mapped data until
+    //! the next non-const access.
+    const VectorType& vector() const
+    {
+        if (mapped_.load(std::memory_order_acquire))
+            unmap();
+        return *data_;
+    }
+
+    //! Use the \p n elements at \p data as storage, without copying them.
+    //! \p owner keeps the memory alive as long as it is used. If
+    //! \p writable is false the data is copied on the first write access,
+    //! otherwise elements are modified in place. Resizing or accessing the
+    //! vector() always copies the data (does not work for T==bool).
+    void map(std::shared_ptr<const void> owner, T* data, size_t n,
+             bool writable)
+    {
+        data_ = std::make_shared<VectorType>();
+        mapping_ = std::move(owner);
+        ptr_ = data;
+        mapped_size_ = n;
+        mapped_ = true;
+        shared_ = !writable;
+    }
 
-    //! Get reference to the underlying vector
-    std::vector<T>& vector() { return data_; }
+    //! Does the array use external memory?
+    bool is_mapped() const { return mapped_; }
 
-    //! Access the i'th element. No range check is performed!
+    //! Access the i'th element. No range check is performed! Shared data is
+    //! copied on the first access, which costs a check per access: loops
+    //! over many elements should get the vector() once instead, which also
+    //! makes the copy before any threads are started.
     reference operator[](size_t idx)
     {
-        assert(idx < data_.size());
-        return data_[idx];
+        // acquire pairs with the release in detach(): a thread that sees
+        // the array as not shared also sees the data_ and ptr_ of the copy
+        if (shared_.load(std::memory_order_acquire))
+            detach();
+        assert(idx < size());
+        return Storage::at(ptr_, idx);
     }
 
     //! Const access to the i'th element. No range check is performed!
     const_reference operator[](size_t idx) const
     {
-        assert(idx < data_.size());
-        return data_[idx];
+        assert(idx < size());
+        return Storage::const_at(ptr_, idx);
     }
 
+    //! Is the data currently shared with a copy of this array?
+    bool is_shared() const { return shared_ && data_.use_count() > 1; }
+
 private:
-    VectorType data_;
+    // let this array and rhs share the data of rhs
+    void share(const PropertyArray& rhs)
+    {
+        data_ = rhs.data_;
+        ptr_ = rhs.ptr_;
+        mapping_ = rhs.mapping_;
+        mapped_size_ = rhs.mapped_size_;
+        mapped_ = rhs.mapped_.load();
+        shared_ = true;
+        rhs.shared_ = true;
+    }
+
+    // number of elements
+    size_t size() const
+    {
+        return mapped_.load(std::memory_order_acquire) ? mapped_size_
+                                                       : data_->size();
+    }
+
+    // non-const access to the data, makes a private copy if it is shared
+    // or mapped
+    VectorType& write()
+    {
+        if (mapped_.load(std::memory_order_acquire))
+            unmap();
+        if (shared_.load(std::memory_order_acquire))
+            detach();
+        return *data_;
+    }
+
+    // copy mapped data to the heap. ptr_ is left unchanged, since unmap()
+    // is called by const access while other threads might read elements
+    // through ptr_. instead the array is marked as shared, such that the
+    // next non-const access detaches and moves ptr_ to the copy. the mapping
+    // is kept alive for ptr_.
+    void unmap() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (mapped_.load(std::memory_order_relaxed))
+        {
+            data_ = std::make_shared<VectorType>(
+                Storage::copy(ptr_, mapped_size_));
+            shared_.store(true, std::memory_order_relaxed);
+            mapped_.store(false, std::memory_order_release);
+        }
+    }
+
+    // make a private copy of shared data, returns whether a copy was made.
+    // mapped data is copied to the heap, see map(). ptr_ is moved to the
+    // private data in any case, see unmap().
+    // guarded by a mutex since the first write access might come from
+    // several threads at once. the old data stays valid for concurrent
+    // readers, since it is still owned by the other array(s).
+    bool detach()
+    {
+        if (mapped_.load(std::memory_order_acquire))
+            unmap();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        bool copied = false;
+        if (shared_.load(std::memory_order_relaxed))
+        {
+            if (data_.use_count() > 1)
+            {
+                data_ = std::make_shared<VectorType>(*data_);
+                copied = true;
+            }
+            update();
+            shared_.store(false, std::memory_order_release);
+        }
+        return copied;
+    }
+
+    // update the element pointer after the vector might have reallocated
+    void update() { ptr_ = Storage::pointer(*data_); }
+
+    // data_ changes when const access copies mapped data, ptr_ only
+    // changes with non-const access
+    mutable std::shared_ptr<VectorType> data_;
+    typename Storage::Pointer ptr_;
     ValueType value_;
+    mutable std::atomic<bool> shared_;
+    mutable std::mutex mutex_;
+
+    // external storage, see map()
+    std::shared_ptr<const void> mapping_;
+    mutable std::atomic<bool> mapped_;
+    size_t mapped_size_;
 };
 
 // specialization for bool properties
@@ -150,7 +564,7 @@ public:
     const_reference operator[](size_t i) const
     {
         assert(parray_ != nullptr);
-        return (*parray_)[i];
+        return array()[i];
     }
 
     const T* data() const
@@ -159,12 +573,26 @@ public:
         return parray_->data();
     }
 
-    std::vector<T>& vector()
+    typename PropertyArray<T>::VectorType& vector()
     {
         assert(parray_ != nullptr);
         return parray_->vector();
     }
 
+    const typename PropertyArray<T>::VectorType& vector() const
+    {
+        assert(parray_ != nullptr);
+        return array().vector();
+    }
+
+    //! use external memory as storage, see PropertyArray::map()
+    void map(std::shared_ptr<const void> owner, T* data, size_t n,
+             bool writable)
+    {
+        assert(parray_ != nullptr);
+        parray_->map(std::move(owner), data, n, writable);
+    }
+
 private:
     PropertyArray<T>& array()
     {
@@ -191,10 +619,10 @@ public:
     // destructor (deletes all property arrays)
     virtual ~PropertyContainer() { clear(); }
 
-    // copy constructor: performs deep copy of property arrays
+    // copy constructor: copies the property arrays (copy-on-write)
     PropertyContainer(const PropertyContainer& rhs) { operator=(rhs); }
 
-    // assignment: performs deep copy of property arrays
+    // assignment: copies the property arrays (copy-on-write)
     PropertyContainer& operator=(const PropertyContainer& rhs)
     {
         if (this != &rhs)
@@ -223,6 +651,15 @@ public:
         return names;
     }
 
+    // returns the memory used by each property array
+    std::vector<PropertyMemory> memory_usage() const
+    {
+        std::vector<PropertyMemory> memory;
+        for (size_t i = 0; i < parrays_.size(); ++i)
+            memory.push_back(parrays_[i]->memory());
+        return memory;
+    }
+
     // add a property with name \p name and default value \p t
     template <class T>
     Property<T> add(const std::string& name, const T t = T())
@@ -277,7 +714,7 @@ public:
     }
 
     // get the type of property by its name. returns typeid(void) if it does not exist.
-    const std::type_info& get_type(const std::string& name)
+    const std::type_info& get_type(const std::string& name) const
     {
         for (size_t i = 0; i < parrays_.size(); ++i)
             if (parrays_[i]->name() == name)
@@ -349,6 +786,41 @@ public:
             parrays_[i]->swap(i0, i1);
     }
 
+    // exchange all arrays with those of \p rhs
+    void swap(PropertyContainer& rhs)
+    {
+        parrays_.swap(rhs.parrays_);
+        std::swap(size_, rhs.size_);
+    }
+
+    // shrink all arrays to n elements, moving element n+i to position
+    // map[i] (or dropping it if map[i] is PMP_MAX_INDEX). the arrays are
+    // processed in parallel, and optionally their unused memory is freed.
+    void compact(size_t n, const std::vector<IndexType>& map,
+                 bool release_memory)
+    {
+        assert(n + map.size() == size_);
+        const int np = int(parrays_.size());
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int i = 0; i < np; ++i)
+        {
+            parrays_[i]->compact(n, map);
+            if (release_memory)
+                parrays_[i]->free_memory();
+        }
+        size_ = n;
+    }
+
+    // reorder all arrays such that element i becomes old element perm[i]
+    void permute(const std::vector<IndexType>& perm)
+    {
+        assert(perm.size() == size_);
+        const int np = int(parrays_.size());
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int i = 0; i < np; ++i)
+            parrays_[i]->permute(perm);
+    }
+
 private:
     std::vector<BasePropertyArray*> parrays_;
     size_t size_;
@@ -4,6 +4,7 @@
 
 #include "pmp/SurfaceMesh.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "pmp/SurfaceMeshIO.h"
@@ -37,7 +38,7 @@ SurfaceMesh& SurfaceMesh::operator=(const SurfaceMesh& rhs)
 {
     if (this != &rhs)
     {
-        // deep copy of property containers
+        // copy property containers (the data is shared until modified)
         oprops_ = rhs.oprops_;
         vprops_ = rhs.vprops_;
         hprops_ = rhs.hprops_;
@@ -65,6 +66,30 @@ SurfaceMesh& SurfaceMesh::operator=(const SurfaceMesh& rhs)
     return *this;
 }
 
+void SurfaceMesh::swap(SurfaceMesh& rhs)
+{
+    // property handles point to the arrays, so they move along with them
+    oprops_.swap(rhs.oprops_);
+    vprops_.swap(rhs.vprops_);
+    hprops_.swap(rhs.hprops_);
+    eprops_.swap(rhs.eprops_);
+    fprops_.swap(rhs.fprops_);
+
+    std::swap(vpoint_, rhs.vpoint_);
+    std::swap(vconn_, rhs.vconn_);
+    std::swap(hconn_, rhs.hconn_);
+    std::swap(fconn_, rhs.fconn_);
+
+    std::swap(vdeleted_, rhs.vdeleted_);
+    std::swap(edeleted_, rhs.edeleted_);
+    std::swap(fdeleted_, rhs.fdeleted_);
+
+    std::swap(deleted_vertices_, rhs.deleted_vertices_);
+    std::swap(deleted_edges_, rhs.deleted_edges_);
+    std::swap(deleted_faces_, rhs.deleted_faces_);
+    std::swap(has_garbage_, rhs.has_garbage_);
+}
+
 SurfaceMesh& SurfaceMesh::assign(const SurfaceMesh& rhs)
 {
     if (this != &rhs)
@@ -174,27 +199,50 @@ void SurfaceMesh::reserve(size_t nvertices, size_t nedges, size_t nfaces)
 
 void SurfaceMesh::property_stats() const
 {
-    std::vector<std::string> props;
-
-    std::cout << "point properties:\n";
-    props = vertex_properties();
-    for (const auto& prop : props)
-        std::cout << "\t" << prop << std::endl;
-
-    std::cout << "halfedge properties:\n";
-    props = halfedge_properties();
-    for (const auto& prop : props)
-        std::cout << "\t" << prop << std::endl;
-
-    std::cout << "edge properties:\n";
-    props = edge_properties();
-    for (const auto& prop : props)
-        std::cout << "\t" << prop << std::endl;
-
-    std::cout << "face properties:\n";
-    props = face_properties();
-    for (const auto& prop : props)
-        std::cout << "\t" << prop << std::endl;
+    const MeshMemory memory = memory_usage();
+
+    auto print = [](const char* title, const ElementMemory& element) {
+        std::cout << title << " (" << element.n_elements << ", "
+                  << element.bytes_per_element() << " bytes each):\n";
+        for (const auto& prop : element.properties)
+        {
+            std::cout << "\t" << prop.name << ": " << prop.used << " bytes";
+            if (prop.reserved > prop.used)
+                std::cout << " (" << prop.reserved << " reserved)";
+            if (prop.shared)
+                std::cout << " shared";
+            if (prop.mapped)
+                std::cout << " mapped";
+            std::cout << std::endl;
+        }
+    };
+
+    print("point properties", memory.vertices);
+    print("halfedge properties", memory.halfedges);
+    print("edge properties", memory.edges);
+    print("face properties", memory.faces);
+}
+
+MeshMemory SurfaceMesh::memory_usage() const
+{
+    MeshMemory memory;
+
+    auto collect = [](const PropertyContainer& props, ElementMemory& element,
+                      const char* connectivity, const char* deleted) {
+        element.n_elements = props.size();
+        element.properties = props.memory_usage();
+        for (const auto& prop : element.properties)
+            if (prop.name == connectivity || prop.name == deleted)
+                element.connectivity += prop.used;
+    };
+
+    collect(vprops_, memory.vertices, "v:connectivity", "v:deleted");
+    collect(hprops_, memory.halfedges, "h:connectivity", "h:deleted");
+    collect(eprops_, memory.edges, "e:connectivity", "e:deleted");
+    collect(fprops_, memory.faces, "f:connectivity", "f:deleted");
+    collect(oprops_, memory.object, "", "");
+
+    return memory;
 }
 
 Halfedge SurfaceMesh::find_halfedge(Vertex start, Vertex end) const
@@ -450,6 +498,180 @@ Face SurfaceMesh::add_face(const std::vector<Vertex>& vertices)
     return f;
 }
 
+bool SurfaceMesh::add_faces(const std::vector<IndexType>& valences,
+                            const std::vector<IndexType>& indices)
+{
+    if (edges_size() > 0 || faces_size() > 0)
+        return false;
+
+    const size_t nv = vertices_size();
+    const size_t nf = valences.size();
+    const size_t nc = indices.size();
+    const IndexType invalid = PMP_MAX_INDEX;
+
+    // first corner of each face
+    std::vector<size_t> first(nf + 1, 0);
+    for (size_t f = 0; f < nf; ++f)
+    {
+        if (valences[f] < 3)
+            return false;
+        first[f + 1] = first[f] + valences[f];
+    }
+    if (first[nf] != nc || 2 * nc >= size_t(PMP_MAX_INDEX) - 1 ||
+        nf >= size_t(PMP_MAX_INDEX) - 1)
+        return false;
+
+    // corner c is the halfedge from vertex indices[c] to vertex target[c].
+    // faces must not use a vertex twice.
+    std::vector<IndexType> target(nc);
+    std::vector<IndexType> mark(nv, invalid);
+    for (size_t f = 0; f < nf; ++f)
+    {
+        for (size_t c = first[f]; c < first[f + 1]; ++c)
+        {
+            const IndexType v = indices[c];
+            if (v >= nv || mark[v] == f)
+                return false;
+            mark[v] = IndexType(f);
+            target[c] = indices[c + 1 < first[f + 1] ? c + 1 : first[f]];
+        }
+    }
+
+    // sort the corners into buckets by their smaller vertex index
+    std::vector<IndexType> bucket_start(nv + 1, 0);
+    for (size_t c = 0; c < nc; ++c)
+        ++bucket_start[std::min(indices[c], target[c]) + 1];
+    for (size_t v = 0; v < nv; ++v)
+        bucket_start[v + 1] += bucket_start[v];
+    std::vector<IndexType> bucket(nc);
+    std::vector<IndexType> bucket_end(bucket_start.begin(),
+                                      bucket_start.end() - 1);
+    for (size_t c = 0; c < nc; ++c)
+        bucket[bucket_end[std::min(indices[c], target[c])]++] = IndexType(c);
+
+    // pair opposite corners to edges. an edge has at most two corners,
+    // and they have to point in opposite directions.
+    std::vector<IndexType> hidx(nc, invalid);
+    std::vector<IndexType> edge_corner;
+    edge_corner.reserve(nc / 2 + 1);
+    for (size_t v = 0; v < nv; ++v)
+    {
+        for (IndexType i = bucket_start[v]; i < bucket_start[v + 1]; ++i)
+        {
+            const IndexType c = bucket[i];
+            if (hidx[c] != invalid)
+                continue;
+
+            const IndexType e = IndexType(edge_corner.size());
+            edge_corner.push_back(c);
+            hidx[c] = 2 * e;
+
+            const IndexType other = std::max(indices[c], target[c]);
+            bool paired = false;
+            for (IndexType j = i + 1; j < bucket_start[v + 1]; ++j)
+            {
+                const IndexType d = bucket[j];
+                if (std::max(indices[d], target[d]) != other)
+                    continue;
+                if (paired || indices[d] == indices[c])
+                    return false;
+                hidx[d] = 2 * e + 1;
+                paired = true;
+            }
+        }
+    }
+
+    // link the halfedges of the faces
+    const size_t nh = 2 * edge_corner.size();
+    std::vector<IndexType> hnext(nh, invalid);
+    std::vector<IndexType> degree(nv, 0);
+    std::vector<IndexType> vhalfedge(nv, invalid);
+    for (size_t f = 0; f < nf; ++f)
+    {
+        for (size_t c = first[f]; c < first[f + 1]; ++c)
+        {
+            const size_t cn = c + 1 < first[f + 1] ? c + 1 : first[f];
+            hnext[hidx[c]] = hidx[cn];
+            vhalfedge[indices[c]] = hidx[c];
+            ++degree[indices[c]];
+        }
+    }
+
+    // link the boundary halfedges, a vertex can have only one outgoing
+    // boundary halfedge
+    std::vector<IndexType> vboundary(nv, invalid);
+    for (size_t h = 0; h < nh; ++h)
+    {
+        if (hnext[h ^ 1] != invalid && hnext[h] == invalid)
+        {
+            const IndexType c = edge_corner[h >> 1];
+            const IndexType v = target[c];
+            if (vboundary[v] != invalid)
+                return false;
+            vboundary[v] = vhalfedge[v] = IndexType(h);
+            ++degree[v];
+        }
+    }
+    for (size_t h = 0; h < nh; ++h)
+    {
+        if (hnext[h] == invalid)
+            hnext[h] = vboundary[indices[edge_corner[h >> 1]]];
+    }
+
+    // all outgoing halfedges of a vertex have to form a single fan
+    for (size_t v = 0; v < nv; ++v)
+    {
+        if (vhalfedge[v] == invalid)
+            continue;
+
+        IndexType count = 0;
+        IndexType h = vhalfedge[v];
+        do
+        {
+            h = hnext[h ^ 1];
+        } while (h != vhalfedge[v] && ++count < degree[v]);
+        if (count + 1 != degree[v])
+            return false;
+    }
+
+    // everything is fine, create the elements
+    const size_t ne = edge_corner.size();
+    eprops_.resize(ne);
+    hprops_.resize(nh);
+    fprops_.resize(nf);
+    auto& vconn = vconn_.vector();
+    auto& hconn = hconn_.vector();
+    auto& fconn = fconn_.vector();
+#pragma omp parallel for
+    for (int e = 0; e < int(ne); ++e)
+    {
+        const IndexType c = edge_corner[e];
+        hconn[2 * e].vertex_ = Vertex(target[c]);
+        hconn[2 * e + 1].vertex_ = Vertex(indices[c]);
+    }
+#pragma omp parallel for
+    for (int h = 0; h < int(nh); ++h)
+    {
+        hconn[h].next_halfedge_ = Halfedge(hnext[h]);
+        hconn[hnext[h]].prev_halfedge_ = Halfedge(IndexType(h));
+    }
+#pragma omp parallel for
+    for (int f = 0; f < int(nf); ++f)
+    {
+        for (size_t c = first[f]; c < first[f + 1]; ++c)
+            hconn[hidx[c]].face_ = Face(IndexType(f));
+        fconn[f].halfedge_ = Halfedge(hidx[first[f + 1] - 1]);
+    }
+#pragma omp parallel for
+    for (int v = 0; v < int(nv); ++v)
+    {
+        if (vhalfedge[v] != invalid)
+            vconn[v].halfedge_ = Halfedge(vhalfedge[v]);
+    }
+
+    return true;
+}
+
 size_t SurfaceMesh::valence(Vertex v) const
 {
     size_t count(0);
@@ -1228,145 +1450,262 @@ void SurfaceMesh::delete_face(Face f)
     has_garbage_ = true;
 }
 
-void SurfaceMesh::garbage_collection()
+void SurfaceMesh::garbage_collection(bool release_memory)
 {
-    int i, i0, i1, nV(vertices_size()), nE(edges_size()), nH(halfedges_size()),
-        nF(faces_size());
-
-    Vertex v;
-    Halfedge h;
-    Face f;
-
-    // setup handle mapping
-    VertexProperty<Vertex> vmap =
-        add_vertex_property<Vertex>("v:garbage-collection");
-    HalfedgeProperty<Halfedge> hmap =
-        add_halfedge_property<Halfedge>("h:garbage-collection");
-    FaceProperty<Face> fmap = add_face_property<Face>("f:garbage-collection");
-    for (i = 0; i < nV; ++i)
-        vmap[Vertex(i)] = Vertex(i);
-    for (i = 0; i < nH; ++i)
-        hmap[Halfedge(i)] = Halfedge(i);
-    for (i = 0; i < nF; ++i)
-        fmap[Face(i)] = Face(i);
-
-    // remove deleted vertices
-    if (nV > 0)
+    // compute a permutation that fills the gaps left by deleted elements
+    // with the remaining elements from the end of the array. returns the new
+    // size n and stores the new index of element n+i in map[i].
+    auto compaction_map = [](const BitVector& deleted,
+                             std::vector<IndexType>& map) {
+        const size_t n = deleted.size() - deleted.count();
+        map.assign(deleted.size() - n, PMP_MAX_INDEX);
+        size_t gap = 0;
+        for (size_t i = deleted.find_next_unset(n); i < deleted.size();
+             i = deleted.find_next_unset(i + 1))
+        {
+            while (!deleted[gap])
+                ++gap;
+            map[i - n] = IndexType(gap++);
+        }
+        return n;
+    };
+
+    std::vector<IndexType> vmap, emap, fmap;
+    const size_t nV = compaction_map(vdeleted_.vector(), vmap);
+    const size_t nE = compaction_map(edeleted_.vector(), emap);
+    const size_t nF = compaction_map(fdeleted_.vector(), fmap);
+    const size_t nH = 2 * nE;
+
+    // halfedges move along with their edge
+    std::vector<IndexType> hmap(2 * emap.size(), PMP_MAX_INDEX);
+    for (size_t i = 0; i < emap.size(); ++i)
     {
-        i0 = 0;
-        i1 = nV - 1;
-
-        while (1)
+        if (emap[i] != PMP_MAX_INDEX)
         {
-            // find first deleted and last un-deleted
-            while (!vdeleted_[Vertex(i0)] && i0 < i1)
-                ++i0;
-            while (vdeleted_[Vertex(i1)] && i0 < i1)
-                --i1;
-            if (i0 >= i1)
-                break;
-
-            // swap
-            vprops_.swap(i0, i1);
-        };
+            hmap[2 * i] = 2 * emap[i];
+            hmap[2 * i + 1] = 2 * emap[i] + 1;
+        }
+    }
 
-        // remember new size
-        nV = vdeleted_[Vertex(i0)] ? i0 : i0 + 1;
+    // apply the permutations to all properties
+    vprops_.compact(nV, vmap, release_memory);
+    hprops_.compact(nH, hmap, release_memory);
+    eprops_.compact(nE, emap, release_memory);
+    fprops_.compact(nF, fmap, release_memory);
+
+    // map old handles to new ones
+    auto new_vertex = [&](Vertex v) {
+        return v.idx() < nV ? v : Vertex(vmap[v.idx() - nV]);
+    };
+    auto new_halfedge = [&](Halfedge h) {
+        return h.idx() < nH ? h : Halfedge(hmap[h.idx() - nH]);
+    };
+    auto new_face = [&](Face f) {
+        return f.idx() < nF ? f : Face(fmap[f.idx() - nF]);
+    };
+
+    // access connectivity directly, this detaches shared data only once
+    auto& vconn = vconn_.vector();
+    auto& hconn = hconn_.vector();
+    auto& fconn = fconn_.vector();
+
+    // update vertex connectivity
+#pragma omp parallel for
+    for (int i = 0; i < int(nV); ++i)
+    {
+        Halfedge& h = vconn[i].halfedge_;
+        if (h.is_valid())
+            h = new_halfedge(h);
     }
 
-    // remove deleted edges
-    if (nE > 0)
+    // update halfedge connectivity
+#pragma omp parallel for
+    for (int i = 0; i < int(nH); ++i)
     {
-        i0 = 0;
-        i1 = nE - 1;
+        HalfedgeConnectivity& hc = hconn[i];
+        hc.vertex_ = new_vertex(hc.vertex_);
+        hc.next_halfedge_ = new_halfedge(hc.next_halfedge_);
+        hc.prev_halfedge_ = new_halfedge(hc.prev_halfedge_);
+        if (hc.face_.is_valid())
+            hc.face_ = new_face(hc.face_);
+    }
 
-        while (1)
-        {
-            // find first deleted and last un-deleted
-            while (!edeleted_[Edge(i0)] && i0 < i1)
-                ++i0;
-            while (edeleted_[Edge(i1)] && i0 < i1)
-                --i1;
-            if (i0 >= i1)
-                break;
-
-            // swap
-            eprops_.swap(i0, i1);
-            hprops_.swap(2 * i0, 2 * i1);
-            hprops_.swap(2 * i0 + 1, 2 * i1 + 1);
-        };
+    // update handles of faces
+#pragma omp parallel for
+    for (int i = 0; i < int(nF); ++i)
+        fconn[i].halfedge_ = new_halfedge(fconn[i].halfedge_);
 
-        // remember new size
-        nE = edeleted_[Edge(i0)] ? i0 : i0 + 1;
-        nH = 2 * nE;
-    }
+    deleted_vertices_ = deleted_edges_ = deleted_faces_ = 0;
+    has_garbage_ = false;
+}
+
+void SurfaceMesh::reorder(Ordering ordering)
+{
+    if (has_garbage())
+        garbage_collection();
 
-    // remove deleted faces
-    if (nF > 0)
+    const size_t nV(vertices_size()), nE(edges_size()), nF(faces_size());
+
+    // new-to-old vertex permutation
+    std::vector<IndexType> vperm(nV);
+    std::iota(vperm.begin(), vperm.end(), 0);
+
+    if (ordering == MortonOrder)
     {
-        i0 = 0;
-        i1 = nF - 1;
+        // quantize x to 21 bits and spread them such that two zeros follow
+        // each bit
+        auto spread = [](Scalar s) {
+            uint64_t x = std::min(uint64_t(std::max(s, Scalar(0))),
+                                  uint64_t(0x1fffff));
+            x = (x | x << 32) & 0x1f00000000ffff;
+            x = (x | x << 16) & 0x1f0000ff0000ff;
+            x = (x | x << 8) & 0x100f00f00f00f00f;
+            x = (x | x << 4) & 0x10c30c30c30c30c3;
+            x = (x | x << 2) & 0x1249249249249249;
+            return x;
+        };
 
-        while (1)
+        // quantize positions to the largest extent of the bounding box
+        BoundingBox bb = bounds();
+        const Point bbmin = bb.min();
+        const Point ext = bb.max() - bbmin;
+        const Scalar maxext = std::max(ext[0], std::max(ext[1], ext[2]));
+        const Scalar scale = maxext > 0 ? Scalar(0x1fffff) / maxext : 0;
+
+        std::vector<uint64_t> code(nV);
+        const auto& points = positions();
+#pragma omp parallel for
+        for (int i = 0; i < int(nV); ++i)
         {
-            // find 1st deleted and last un-deleted
-            while (!fdeleted_[Face(i0)] && i0 < i1)
-                ++i0;
-            while (fdeleted_[Face(i1)] && i0 < i1)
-                --i1;
-            if (i0 >= i1)
-                break;
-
-            // swap
-            fprops_.swap(i0, i1);
-        };
+            const Point p = (points[i] - bbmin) * scale;
+            code[i] = spread(p[0]) | spread(p[1]) << 1 | spread(p[2]) << 2;
+        }
 
-        // remember new size
-        nF = fdeleted_[Face(i0)] ? i0 : i0 + 1;
+        std::stable_sort(vperm.begin(), vperm.end(),
+                         [&code](IndexType a, IndexType b) {
+                             return code[a] < code[b];
+                         });
+    }
+    else
+    {
+        // use the permutation as queue, start a new front at each unvisited
+        // vertex to cover all connected components
+        std::vector<bool> visited(nV, false);
+        size_t head(0), tail(0);
+        for (size_t seed = 0; seed < nV; ++seed)
+        {
+            if (visited[seed])
+                continue;
+            visited[seed] = true;
+            vperm[tail++] = IndexType(seed);
+            while (head < tail)
+            {
+                for (auto vv : vertices(Vertex(vperm[head++])))
+                {
+                    if (!visited[vv.idx()])
+                    {
+                        visited[vv.idx()] = true;
+                        vperm[tail++] = vv.idx();
+                    }
+                }
+            }
+        }
     }
 
-    // update vertex connectivity
-    for (i = 0; i < nV; ++i)
+    // old-to-new vertex map
+    std::vector<IndexType> vmap(nV);
+    for (size_t i = 0; i < nV; ++i)
+        vmap[vperm[i]] = IndexType(i);
+
+    // stable counting sort of elements by a key in [0, nV)
+    auto sort_by_key = [nV](const std::vector<IndexType>& key,
+                            std::vector<IndexType>& perm) {
+        std::vector<IndexType> offset(nV + 1, 0);
+        for (auto k : key)
+            ++offset[k + 1];
+        std::partial_sum(offset.begin(), offset.end(), offset.begin());
+        perm.resize(key.size());
+        for (size_t i = 0; i < key.size(); ++i)
+            perm[offset[key[i]]++] = IndexType(i);
+    };
+
+    // edges and faces follow their first vertex in the new order
+    std::vector<IndexType> key(nE), eperm, fperm;
+#pragma omp parallel for
+    for (int i = 0; i < int(nE); ++i)
     {
-        v = Vertex(i);
-        if (!is_isolated(v))
-            set_halfedge(v, hmap[halfedge(v)]);
+        const Edge e(i);
+        key[i] = std::min(vmap[vertex(e, 0).idx()], vmap[vertex(e, 1).idx()]);
     }
+    sort_by_key(key, eperm);
 
-    // update halfedge connectivity
-    for (i = 0; i < nH; ++i)
+    key.resize(nF);
+#pragma omp parallel for
+    for (int i = 0; i < int(nF); ++i)
     {
-        h = Halfedge(i);
-        set_vertex(h, vmap[to_vertex(h)]);
-        set_next_halfedge(h, hmap[next_halfedge(h)]);
-        if (!is_boundary(h))
-            set_face(h, fmap[face(h)]);
+        IndexType k = PMP_MAX_INDEX;
+        for (auto v : vertices(Face(i)))
+            k = std::min(k, vmap[v.idx()]);
+        key[i] = k;
     }
+    sort_by_key(key, fperm);
 
-    // update handles of faces
-    for (i = 0; i < nF; ++i)
+    // halfedges move along with their edge
+    std::vector<IndexType> hperm(2 * nE);
+    for (size_t i = 0; i < nE; ++i)
     {
-        f = Face(i);
-        set_halfedge(f, hmap[halfedge(f)]);
+        hperm[2 * i] = 2 * eperm[i];
+        hperm[2 * i + 1] = 2 * eperm[i] + 1;
     }
 
-    // remove handle maps
-    remove_vertex_property(vmap);
-    remove_halfedge_property(hmap);
-    remove_face_property(fmap);
+    // old-to-new edge and face maps
+    std::vector<IndexType> emap(nE), fmap(nF);
+    for (size_t i = 0; i < nE; ++i)
+        emap[eperm[i]] = IndexType(i);
+    for (size_t i = 0; i < nF; ++i)
+        fmap[fperm[i]] = IndexType(i);
+
+    // apply the permutations to all properties
+    vprops_.permute(vperm);
+    hprops_.permute(hperm);
+    eprops_.permute(eperm);
+    fprops_.permute(fperm);
+
+    // map old handles to new ones
+    auto new_halfedge = [&emap](Halfedge h) {
+        return Halfedge((emap[h.idx() >> 1] << 1) | (h.idx() & 1));
+    };
+
+    // access connectivity directly, this detaches shared data only once
+    auto& vconn = vconn_.vector();
+    auto& hconn = hconn_.vector();
+    auto& fconn = fconn_.vector();
 
-    // finally resize arrays
-    vprops_.resize(nV);
-    vprops_.free_memory();
-    hprops_.resize(nH);
-    hprops_.free_memory();
-    eprops_.resize(nE);
-    eprops_.free_memory();
-    fprops_.resize(nF);
-    fprops_.free_memory();
+    // update vertex connectivity
+#pragma omp parallel for
+    for (int i = 0; i < int(nV); ++i)
+    {
+        Halfedge& h = vconn[i].halfedge_;
+        if (h.is_valid())
+            h = new_halfedge(h);
+    }
 
-    deleted_vertices_ = deleted_edges_ = deleted_faces_ = 0;
-    has_garbage_ = false;
+    // update halfedge connectivity
+#pragma omp parallel for
+    for (int i = 0; i < int(2 * nE); ++i)
+    {
+        HalfedgeConnectivity& hc = hconn[i];
+        hc.vertex_ = Vertex(vmap[hc.vertex_.idx()]);
+        hc.next_halfedge_ = new_halfedge(hc.next_halfedge_);
+        hc.prev_halfedge_ = new_halfedge(hc.prev_halfedge_);
+        if (hc.face_.is_valid())
+            hc.face_ = Face(fmap[hc.face_.idx()]);
+    }
+
+    // update handles of faces
+#pragma omp parallel for
+    for (int i = 0; i < int(nF); ++i)
+        fconn[i].halfedge_ = new_halfedge(fconn[i].halfedge_);
 }
 
 } // namespace pmp
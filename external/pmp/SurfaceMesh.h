@@ -12,6 +12,7 @@
 #include "pmp/Types.h"
 #include "pmp/Properties.h"
 #include "pmp/BoundingBox.h"
+#include "pmp/PointKernels.h"
 
 namespace pmp {
 
@@ -215,6 +216,73 @@ public:
     }
 };
 
+//! Memory used by the properties of one kind of mesh element.
+struct ElementMemory
+{
+    //! number of elements, including deleted ones
+    size_t n_elements = 0;
+
+    //! bytes used by the connectivity and the deleted flags
+    size_t connectivity = 0;
+
+    //! memory of each property array, including the connectivity
+    std::vector<PropertyMemory> properties;
+
+    //! bytes used by all properties
+    size_t used() const
+    {
+        size_t bytes = 0;
+        for (const auto& p : properties)
+            bytes += p.used;
+        return bytes;
+    }
+
+    //! bytes allocated on the heap for all properties
+    size_t reserved() const
+    {
+        size_t bytes = 0;
+        for (const auto& p : properties)
+            bytes += p.reserved;
+        return bytes;
+    }
+
+    //! bytes used by all properties of a single element
+    double bytes_per_element() const
+    {
+        return n_elements ? double(used()) / n_elements : 0.0;
+    }
+
+    //! connectivity bytes of a single element
+    double connectivity_per_element() const
+    {
+        return n_elements ? double(connectivity) / n_elements : 0.0;
+    }
+};
+
+//! Memory used by a SurfaceMesh, see SurfaceMesh::memory_usage().
+struct MeshMemory
+{
+    ElementMemory vertices;  //!< vertex properties
+    ElementMemory halfedges; //!< halfedge properties
+    ElementMemory edges;     //!< edge properties
+    ElementMemory faces;     //!< face properties
+    ElementMemory object;    //!< object properties
+
+    //! bytes used by all properties
+    size_t used() const
+    {
+        return vertices.used() + halfedges.used() + edges.used() +
+               faces.used() + object.used();
+    }
+
+    //! bytes allocated on the heap for all properties
+    size_t reserved() const
+    {
+        return vertices.reserved() + halfedges.reserved() +
+               edges.reserved() + faces.reserved() + object.reserved();
+    }
+};
+
 //! A halfedge data structure for polygonal meshes.
 class SurfaceMesh
 {
@@ -231,8 +299,7 @@ public:
             : handle_(v), mesh_(m)
         {
             if (mesh_ && mesh_->has_garbage())
-                while (mesh_->is_valid(handle_) && mesh_->is_deleted(handle_))
-                    ++handle_.idx_;
+                handle_ = mesh_->next_undeleted(handle_);
         }
 
         //! get the vertex the iterator refers to
@@ -255,9 +322,8 @@ public:
         {
             ++handle_.idx_;
             assert(mesh_);
-            while (mesh_->has_garbage() && mesh_->is_valid(handle_) &&
-                   mesh_->is_deleted(handle_))
-                ++handle_.idx_;
+            if (mesh_->has_garbage())
+                handle_ = mesh_->next_undeleted(handle_);
             return *this;
         }
 
@@ -289,8 +355,7 @@ public:
             : handle_(h), mesh_(mesh)
         {
             if (mesh_ && mesh_->has_garbage())
-                while (mesh_->is_valid(handle_) && mesh_->is_deleted(handle_))
-                    ++handle_.idx_;
+                handle_ = mesh_->next_undeleted(handle_);
         }
 
         //! get the halfedge the iterator refers to
@@ -313,9 +378,8 @@ public:
         {
             ++handle_.idx_;
             assert(mesh_);
-            while (mesh_->has_garbage() && mesh_->is_valid(handle_) &&
-                   mesh_->is_deleted(handle_))
-                ++handle_.idx_;
+            if (mesh_->has_garbage())
+                handle_ = mesh_->next_undeleted(handle_);
             return *this;
         }
 
@@ -346,8 +410,7 @@ public:
             : handle_(e), mesh_(mesh)
         {
             if (mesh_ && mesh_->has_garbage())
-                while (mesh_->is_valid(handle_) && mesh_->is_deleted(handle_))
-                    ++handle_.idx_;
+                handle_ = mesh_->next_undeleted(handle_);
         }
 
         //! get the edge the iterator refers to
@@ -370,9 +433,8 @@ public:
         {
             ++handle_.idx_;
             assert(mesh_);
-            while (mesh_->has_garbage() && mesh_->is_valid(handle_) &&
-                   mesh_->is_deleted(handle_))
-                ++handle_.idx_;
+            if (mesh_->has_garbage())
+                handle_ = mesh_->next_undeleted(handle_);
             return *this;
         }
 
@@ -403,8 +465,7 @@ public:
             : handle_(f), mesh_(m)
         {
             if (mesh_ && mesh_->has_garbage())
-                while (mesh_->is_valid(handle_) && mesh_->is_deleted(handle_))
-                    ++handle_.idx_;
+                handle_ = mesh_->next_undeleted(handle_);
         }
 
         //! get the face the iterator refers to
@@ -427,9 +488,8 @@ public:
         {
             ++handle_.idx_;
             assert(mesh_);
-            while (mesh_->has_garbage() && mesh_->is_valid(handle_) &&
-                   mesh_->is_deleted(handle_))
-                ++handle_.idx_;
+            if (mesh_->has_garbage())
+                handle_ = mesh_->next_undeleted(handle_);
             return *this;
         }
 
@@ -904,13 +964,27 @@ public:
     //! destructor
     ~SurfaceMesh();
 
-    //! copy constructor: copies \p rhs to \p *this. performs a deep copy of all
-    //! properties.
+    //! copy constructor: copies \p rhs to \p *this. the property data is
+    //! shared with \p rhs until either mesh modifies it (copy-on-write), so
+    //! copying costs O(#properties).
     SurfaceMesh(const SurfaceMesh& rhs) { operator=(rhs); }
 
-    //! assign \p rhs to \p *this. performs a deep copy of all properties.
+    //! move constructor: takes over the data of \p rhs, which is left empty.
+    SurfaceMesh(SurfaceMesh&& rhs) : SurfaceMesh() { swap(rhs); }
+
+    //! assign \p rhs to \p *this. copies all properties (copy-on-write).
     SurfaceMesh& operator=(const SurfaceMesh& rhs);
 
+    //! move assignment: exchanges the data of \p *this and \p rhs.
+    SurfaceMesh& operator=(SurfaceMesh&& rhs)
+    {
+        swap(rhs);
+        return *this;
+    }
+
+    //! exchange the data of \p *this and \p rhs in constant time.
+    void swap(SurfaceMesh& rhs);
+
     //! assign \p rhs to \p *this. does not copy custom properties.
     SurfaceMesh& assign(const SurfaceMesh& rhs);
 
@@ -927,13 +1001,15 @@ public:
     //! OFF    | yes   | yes    | a / b   | a      | a / b
     //! OBJ    | yes   | no     | a       | no     | no
     //! STL    | yes   | yes    | no      | no     | no
-    //! PLY    | yes   | yes    | no      | no     | no
+    //! PLY    | yes   | yes    | a / b   | a / b  | a / b
     //! PMP    | no    | yes    | no      | no     | no
     //! XYZ    | yes   | no     | a       | no     | no
     //! AGI    | yes   | no     | a       | a      | no
     //!
-    //! In addition, the OBJ and PMP formats support reading per-halfedge
-    //! texture coordinates.
+    //! In addition, the OBJ, PLY, and PMP formats support reading per-halfedge
+    //! texture coordinates, and OBJ normals become the halfedge property
+    //! "h:normal". Other scalar vertex and face properties of PLY
+    //! files become properties "v:ply:name" and "f:ply:name".
     bool read(const std::string& filename, const IOFlags& flags = IOFlags());
 
     //! \brief Write mesh to file \p filename controlled by \p flags
@@ -945,12 +1021,15 @@ public:
     //! OFF    | yes   | yes    | a       | a      | a
     //! OBJ    | yes   | no     | a       | no     | no
     //! STL    | yes   | no     | no      | no     | no
-    //! PLY    | yes   | yes    | no      | no     | no
+    //! PLY    | yes   | yes    | a / b   | a / b  | a / b
     //! PMP    | no    | yes    | no      | no     | no
     //! XYZ    | yes   | no     | a       | no     | no
     //!
-    //! In addition, the OBJ and PMP formats support writing per-halfedge
-    //! texture coordinates.
+    //! In addition, the OBJ, PLY, and PMP formats support writing per-halfedge
+    //! texture coordinates. OBJ files store "h:normal" if there is no
+    //! "v:normal". PLY files also store face colors and all scalar
+    //! vertex and face properties, with the prefix "ply:" of properties read
+    //! from PLY files removed from their names.
     bool write(const std::string& filename,
                const IOFlags& flags = IOFlags()) const;
 
@@ -973,6 +1052,15 @@ public:
     //! \sa add_triangle, add_face
     Face add_quad(Vertex v0, Vertex v1, Vertex v2, Vertex v3);
 
+    //! add many faces at once (mainly used in file readers). face i uses
+    //! the next \p valences[i] entries of \p indices as vertex indices, the
+    //! halfedge of each face points to its first vertex as in add_face().
+    //! this only works for a mesh without edges and faces. returns false
+    //! without changing the mesh if the faces do not form a manifold, use
+    //! add_face() to add them one by one in this case.
+    bool add_faces(const std::vector<IndexType>& valences,
+                   const std::vector<IndexType>& indices);
+
     //!@}
     //! \name Memory Management
     //!@{
@@ -1013,8 +1101,23 @@ public:
     //! reserve memory (mainly used in file readers)
     void reserve(size_t nvertices, size_t nedges, size_t nfaces);
 
-    //! remove deleted elements
-    void garbage_collection();
+    //! remove deleted elements by moving the last remaining elements into
+    //! their slots. if \p release_memory is false, the property arrays keep
+    //! their capacity for subsequent insertions.
+    void garbage_collection(bool release_memory = true);
+
+    //! element orderings used by reorder()
+    enum Ordering
+    {
+        MortonOrder,      //!< vertices along a Morton curve through the bounds
+        BreadthFirstOrder //!< vertices in breadth-first order of the one-rings
+    };
+
+    //! reorder all elements (and their properties) to improve memory locality.
+    //! vertices are sorted according to \p ordering, edges and faces follow
+    //! their first vertex in the new order. deleted elements are removed
+    //! first. all handles into the mesh become invalid.
+    void reorder(Ordering ordering = MortonOrder);
 
     //! returns whether vertex \p v is deleted
     //! \sa garbage_collection()
@@ -1032,6 +1135,12 @@ public:
     //! \sa garbage_collection()
     bool is_deleted(Face f) const { return fdeleted_[f]; }
 
+    //! are there any deleted entities? if not, the vertices are exactly the
+    //! indices 0, ..., vertices_size()-1 (and likewise for the other
+    //! elements), such that plain index loops can be used, e.g. to be split
+    //! among threads.
+    bool has_garbage() const { return has_garbage_; }
+
     //! return whether vertex \p v is valid, i.e. the index is stores
     //! it within the array bounds.
     bool is_valid(Vertex v) const { return v.idx() < vertices_size(); }
@@ -1477,9 +1586,13 @@ public:
         return fprops_.properties();
     }
 
-    //! prints the names of all properties
+    //! prints the names and memory usage of all properties
     void property_stats() const;
 
+    //! returns the memory used by the properties of all elements. data
+    //! shared with copies of the mesh is counted for each of them.
+    MeshMemory memory_usage() const;
+
     //!@}
     //! \name Iterators and circulators
     //!@{
@@ -1739,13 +1852,14 @@ public:
     //! vector of point positions, re-implemented from \p GeometryObject
     std::vector<Point>& positions() { return vpoint_.vector(); }
 
+    //! vector of point positions (const version)
+    const std::vector<Point>& positions() const { return vpoint_.vector(); }
+
     //! compute the bounding box of the object
-    BoundingBox bounds()
+    BoundingBox bounds() const
     {
-        BoundingBox bb;
-        for (auto p : positions())
-            bb += p;
-        return bb;
+        const std::vector<Point>& p = vpoint_.vector();
+        return pmp::bounds(p.data(), p.size());
     }
 
     //! compute the length of edge \p e.
@@ -1855,8 +1969,32 @@ private:
     //! Helper for halfedge collapse
     void remove_loop_helper(Halfedge h);
 
-    //! are there any deleted entities?
-    inline bool has_garbage() const { return has_garbage_; }
+    //! first non-deleted vertex at or after \p v. the deletion flags are
+    //! scanned a word at a time, which lets the iterators skip long runs of
+    //! deleted elements quickly.
+    Vertex next_undeleted(Vertex v) const
+    {
+        return Vertex(IndexType(vdeleted_.vector().find_next_unset(v.idx())));
+    }
+
+    //! first non-deleted halfedge at or after \p h
+    Halfedge next_undeleted(Halfedge h) const
+    {
+        const size_t e = edeleted_.vector().find_next_unset(h.idx() >> 1);
+        return e == (h.idx() >> 1) ? h : Halfedge(IndexType(e << 1));
+    }
+
+    //! first non-deleted edge at or after \p e
+    Edge next_undeleted(Edge e) const
+    {
+        return Edge(IndexType(edeleted_.vector().find_next_unset(e.idx())));
+    }
+
+    //! first non-deleted face at or after \p f
+    Face next_undeleted(Face f) const
+    {
+        return Face(IndexType(fdeleted_.vector().find_next_unset(f.idx())));
+    }
 
     //!@}
     //! \name Private members
@@ -5,11 +5,23 @@
 #include "pmp/SurfaceMeshIO.h"
 
 #include <clocale>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <cctype>
+#include <cmath>
 
+#include <algorithm>
 #include <fstream>
 #include <limits>
+#include <memory>
+#include <sstream>
+#include <type_traits>
+
+#include "pmp/MappedFile.h"
+#include "pmp/MemoryUsage.h"
+#include "pmp/Trace.h"
 
 // helper function
 template <typename T>
@@ -29,8 +41,467 @@ void tfwrite(FILE* out, const T& t)
 
 namespace pmp {
 
+namespace {
+
+// helpers for parsing ASCII files in memory. they never read past end and do
+// not depend on the locale.
+
+inline bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+inline bool is_blank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+inline const char* skip_blanks(const char* p, const char* end)
+{
+    while (p != end && is_blank(*p))
+        ++p;
+    return p;
+}
+
+inline const char* skip_line(const char* p, const char* end)
+{
+    p = static_cast<const char*>(memchr(p, '\n', end - p));
+    return p ? p + 1 : end;
+}
+
+// parse the integer at p, returns the position behind it or nullptr
+const char* parse_int(const char* p, const char* end, long& value)
+{
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+'))
+        negative = (*p++ == '-');
+    if (p == end || !is_digit(*p))
+        return nullptr;
+
+    long v = 0;
+    for (; p != end && is_digit(*p); ++p)
+        v = 10 * v + (*p - '0');
+    value = negative ? -v : v;
+    return p;
+}
+
+// v * 10^exponent, powers up to 10^22 are exact in double precision
+inline double scale10(double v, int exponent)
+{
+    static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                    1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                    1e18, 1e19, 1e20, 1e21, 1e22};
+
+    if (exponent > 0)
+        v *= exponent <= 22 ? powers[exponent] : std::pow(10.0, exponent);
+    else if (exponent < 0)
+        v /= exponent >= -22 ? powers[-exponent] : std::pow(10.0, -exponent);
+    return v;
+}
+
+// parse the floating point number at p, returns the position behind it or
+// nullptr. the first 19 significant digits are accumulated exactly, which is
+// more than enough for float and double.
+const char* parse_scalar(const char* p, const char* end, Scalar& value)
+{
+    const char* start = p;
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+'))
+        negative = (*p++ == '-');
+
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool valid = false;
+    for (; p != end && is_digit(*p); ++p, valid = true)
+    {
+        if (digits < 19)
+        {
+            mantissa = 10 * mantissa + (*p - '0');
+            digits += (mantissa != 0);
+        }
+        else
+            ++exponent;
+    }
+    if (p != end && *p == '.')
+    {
+        for (++p; p != end && is_digit(*p); ++p, valid = true)
+        {
+            if (digits < 19)
+            {
+                mantissa = 10 * mantissa + (*p - '0');
+                digits += (mantissa != 0);
+                --exponent;
+            }
+        }
+    }
+
+    if (!valid)
+    {
+        // let strtod handle inf and nan
+        char buffer[64];
+        const size_t n = std::min(size_t(end - start), sizeof(buffer) - 1);
+        memcpy(buffer, start, n);
+        buffer[n] = '\0';
+        char* stop;
+        const double v = strtod(buffer, &stop);
+        if (stop == buffer)
+            return nullptr;
+        value = Scalar(v);
+        return start + (stop - buffer);
+    }
+
+    if (p != end && (*p == 'e' || *p == 'E'))
+    {
+        long e;
+        const char* q = parse_int(p + 1, end, e);
+        if (q)
+        {
+            exponent += int(std::max(-1000L, std::min(1000L, e)));
+            p = q;
+        }
+    }
+
+    double v = double(mantissa);
+    if (mantissa != 0)
+        v = scale10(v, exponent);
+    value = Scalar(negative ? -v : v);
+    return p;
+}
+
+// parse up to n numbers of a line, returns how many were read
+int parse_scalars(const char* p, const char* end, Scalar* values, int n)
+{
+    int i = 0;
+    for (; i < n; ++i)
+    {
+        p = skip_blanks(p, end);
+        p = parse_scalar(p, end, values[i]);
+        if (!p)
+            break;
+    }
+    return i;
+}
+
+// start of the next line at or after p that is neither empty nor a comment,
+// leading blanks are skipped
+const char* next_record(const char* p, const char* end)
+{
+    while (p != end)
+    {
+        p = skip_blanks(p, end);
+        if (p != end && *p != '\n' && *p != '\r' && *p != '#')
+            break;
+        p = skip_line(p, end);
+    }
+    return p;
+}
+
+// add the faces given by valences and vertex indices to mesh, all at once
+// if possible and one by one otherwise. faces receives the face of each
+// entry, which is invalid if it could not be added.
+void add_faces(SurfaceMesh& mesh, const std::vector<IndexType>& valences,
+               const std::vector<IndexType>& indices, std::vector<Face>& faces)
+{
+    PMP_TRACE_SCOPE("add faces");
+    faces.resize(valences.size());
+    if (mesh.add_faces(valences, indices))
+    {
+        for (size_t i = 0; i < faces.size(); ++i)
+            faces[i] = Face(IndexType(i));
+        return;
+    }
+
+    std::vector<Vertex> vertices;
+    size_t c = 0;
+    for (size_t i = 0; i < faces.size(); ++i)
+    {
+        vertices.clear();
+        for (IndexType j = 0; j < valences[i]; ++j)
+            vertices.emplace_back(indices[c + j]);
+        faces[i] = mesh.add_face(vertices);
+        c += valences[i];
+    }
+}
+
+// helpers for writing ASCII files. numbers are formatted without printf and
+// independent of the locale.
+
+// maximal length of a number written by format_scalar() or format_uint()
+const size_t max_number_length = 32;
+
+// write the decimal digits of value to p, returns the position behind them
+inline char* format_uint(char* p, uint64_t value)
+{
+    char digits[20];
+    int n = 0;
+    do
+    {
+        digits[n++] = char('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (n)
+        *p++ = digits[--n];
+    return p;
+}
+
+// write the shortest decimal representation of value that parse_scalar()
+// reads back as the same value, returns the position behind it. T is float
+// or double.
+template <class T>
+char* format_scalar(char* p, T value)
+{
+    static const uint64_t powers[] = {1ull,
+                                      10ull,
+                                      100ull,
+                                      1000ull,
+                                      10000ull,
+                                      100000ull,
+                                      1000000ull,
+                                      10000000ull,
+                                      100000000ull,
+                                      1000000000ull,
+                                      10000000000ull,
+                                      100000000000ull,
+                                      1000000000000ull,
+                                      10000000000000ull,
+                                      100000000000000ull,
+                                      1000000000000000ull,
+                                      10000000000000000ull,
+                                      100000000000000000ull};
+
+    if (std::isnan(value))
+    {
+        memcpy(p, "nan", 3);
+        return p + 3;
+    }
+    if (std::signbit(value))
+    {
+        *p++ = '-';
+        value = -value;
+    }
+    if (std::isinf(value))
+    {
+        memcpy(p, "inf", 3);
+        return p + 3;
+    }
+    if (value == 0)
+    {
+        *p++ = '0';
+        return p;
+    }
+
+    // max_digits significant digits always identify the value. scale it to
+    // an integer with that many digits, value ~ mantissa * 10^exponent.
+    // double precision suffices for float, double needs more.
+    typedef
+        typename std::conditional<sizeof(T) <= 4, double, long double>::type
+            Wide;
+    const int max_digits = std::numeric_limits<T>::max_digits10;
+    int exponent = int(std::floor(std::log10(Wide(value)))) - max_digits + 1;
+    uint64_t mantissa = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        const Wide scaled =
+            exponent < 0 ? Wide(value) * std::pow(Wide(10), -exponent)
+                         : Wide(value) / std::pow(Wide(10), exponent);
+        mantissa = uint64_t(scaled + Wide(0.5));
+        if (mantissa >= powers[max_digits])
+            ++exponent;
+        else if (mantissa < powers[max_digits - 1])
+            --exponent;
+        else
+            break;
+    }
+
+    // drop digits as long as the rounded number still reads back as value,
+    // the test does exactly what parse_scalar() does
+    uint64_t digits = mantissa;
+    int digits_exponent = exponent;
+    for (int k = 1; k < max_digits; ++k)
+    {
+        const uint64_t rounded = (mantissa + powers[k] / 2) / powers[k];
+        if (T(scale10(double(rounded), exponent + k)) != value)
+            break;
+        digits = rounded;
+        digits_exponent = exponent + k;
+    }
+    while (digits % 10 == 0)
+    {
+        digits /= 10;
+        ++digits_exponent;
+    }
+
+    char buffer[20];
+    const int n = int(format_uint(buffer, digits) - buffer);
+
+    // decimal exponent of the first digit, small numbers are written without
+    // exponent like printf("%g") does
+    int e = digits_exponent + n - 1;
+    if (e >= -5 && e < std::min(max_digits, 15))
+    {
+        if (e < 0)
+        {
+            *p++ = '0';
+            *p++ = '.';
+            for (int i = -1; i > e; --i)
+                *p++ = '0';
+            memcpy(p, buffer, n);
+            return p + n;
+        }
+
+        int i = 0;
+        for (; i <= e; ++i)
+            *p++ = i < n ? buffer[i] : '0';
+        if (i < n)
+        {
+            *p++ = '.';
+            memcpy(p, buffer + i, n - i);
+            p += n - i;
+        }
+        return p;
+    }
+
+    *p++ = buffer[0];
+    if (n > 1)
+    {
+        *p++ = '.';
+        memcpy(p, buffer + 1, n - 1);
+        p += n - 1;
+    }
+    *p++ = 'e';
+    if (e < 0)
+    {
+        *p++ = '-';
+        e = -e;
+    }
+    return format_uint(p, uint64_t(e));
+}
+
+// write the decimal digits of value to p, returns the position behind them
+inline char* format_int(char* p, int64_t value)
+{
+    if (value < 0)
+    {
+        *p++ = '-';
+        return format_uint(p, uint64_t(-(value + 1)) + 1);
+    }
+    return format_uint(p, uint64_t(value));
+}
+
+// write n numbers separated by blanks, returns the position behind them
+inline char* format_scalars(char* p, const Scalar* values, int n)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        if (i)
+            *p++ = ' ';
+        p = format_scalar(p, values[i]);
+    }
+    return p;
+}
+
+// growable buffer for the lines of one block of an ASCII file
+class TextBuffer
+{
+public:
+    TextBuffer() : size_(0), capacity_(0) {}
+
+    void clear() { size_ = 0; }
+
+    const char* data() const { return data_.get(); }
+
+    size_t size() const { return size_; }
+
+    // room for at least n more characters, returns where they go
+    char* reserve(size_t n)
+    {
+        if (size_ + n > capacity_)
+        {
+            const size_t capacity = std::max(2 * capacity_, size_ + n);
+            std::unique_ptr<char[]> data(new char[capacity]);
+            if (size_)
+                memcpy(data.get(), data_.get(), size_);
+            data_ = std::move(data);
+            capacity_ = capacity;
+        }
+        return data_.get() + size_;
+    }
+
+    // the characters up to end have been written
+    void commit(char* end) { size_ = size_t(end - data_.get()); }
+
+private:
+    std::unique_ptr<char[]> data_;
+    size_t size_, capacity_;
+};
+
+// counts the lines written by write_lines() and reports the fraction of all
+// lines of the file written so far
+class WriteProgress
+{
+public:
+    WriteProgress(const std::function<void(float)>& callback, size_t n_lines)
+        : callback_(callback), n_lines_(std::max(n_lines, size_t(1))), done_(0)
+    {
+    }
+
+    void advance(size_t n)
+    {
+        done_ += n;
+        if (callback_)
+            callback_(float(done_) / float(n_lines_));
+    }
+
+private:
+    const std::function<void(float)>& callback_;
+    size_t n_lines_, done_;
+};
+
+// write n lines, format(i, buffer) appends line i to buffer. blocks of lines
+// are formatted in parallel and written in order.
+template <class Format>
+bool write_lines(FILE* out, size_t n, const Format& format,
+                 WriteProgress& progress)
+{
+    const size_t block_size = 1 << 13;
+    const size_t batch_size = 64; // number of blocks formatted at once
+    const size_t n_blocks = (n + block_size - 1) / block_size;
+
+    std::vector<TextBuffer> blocks(std::min(n_blocks, batch_size));
+    for (size_t first = 0; first < n_blocks; first += batch_size)
+    {
+        const int n_batch = int(std::min(batch_size, n_blocks - first));
+#pragma omp parallel for schedule(dynamic)
+        for (int b = 0; b < n_batch; ++b)
+        {
+            PMP_TRACE_SCOPE("format lines");
+            TextBuffer& block = blocks[b];
+            block.clear();
+            const size_t begin = (first + b) * block_size;
+            const size_t end = std::min(n, begin + block_size);
+            for (size_t i = begin; i < end; ++i)
+                format(i, block);
+        }
+
+        for (int b = 0; b < n_batch; ++b)
+        {
+            const TextBuffer& block = blocks[b];
+            if (fwrite(block.data(), 1, block.size(), out) != block.size())
+                return false;
+        }
+        progress.advance(
+            std::min(n, (first + n_batch) * block_size) - first * block_size);
+    }
+    return true;
+}
+
+} // namespace
+
 bool SurfaceMeshIO::read(SurfaceMesh& mesh)
 {
+    MemoryScope memory("SurfaceMeshIO::read");
+
     std::setlocale(LC_NUMERIC, "C");
 
     // clear mesh before reading from file
@@ -56,6 +527,10 @@ bool SurfaceMeshIO::read(SurfaceMesh& mesh)
     {
         return read_stl(mesh);
     }
+    else if (ext == "ply")
+    {
+        return read_ply(mesh);
+    }
     else if (ext == "pmp")
     {
         return read_pmp(mesh);
@@ -95,6 +570,10 @@ bool SurfaceMeshIO::write(const SurfaceMesh& mesh)
     {
         return write_stl(mesh);
     }
+    else if (ext == "ply")
+    {
+        return write_ply(mesh);
+    }
     else if (ext == "pmp")
     {
         return write_pmp(mesh);
@@ -108,365 +587,596 @@ bool SurfaceMeshIO::write(const SurfaceMesh& mesh)
     return false;
 }
 
-bool SurfaceMeshIO::read_obj(SurfaceMesh& mesh)
+namespace {
+
+// the part of an OBJ file parsed by one thread
+struct ObjChunk
 {
-    char s[200];
-    float x, y, z;
-    std::vector<Vertex> vertices;
-    std::vector<TexCoord> all_tex_coords; //individual texture coordinates
-    std::vector<int>
-        halfedge_tex_idx; //texture coordinates sorted for halfedges
-    HalfedgeProperty<TexCoord> tex_coords =
-        mesh.halfedge_property<TexCoord>("h:tex");
-    bool with_tex_coord = false;
+    std::vector<Point> positions;
+    std::vector<TexCoord> tex_coords;
+    std::vector<Normal> normals;
 
-    // open file (in ASCII mode)
-    FILE* in = fopen(filename_.c_str(), "r");
-    if (!in)
-        return false;
+    // number of corners of each face
+    std::vector<IndexType> valences;
+
+    // vertex, texture coordinate and normal index of each corner (-1 if not
+    // given). indices are zero-based, relative indices are resolved against
+    // the start of the chunk and listed in relative[] to be offset later.
+    std::vector<long> corners[3];
+    std::vector<size_t> relative[3];
+
+    bool error = false;
+};
 
-    // clear line once
-    memset(&s, 0, 200);
+// parse the lines in [p, end) of an OBJ file
+void parse_obj_chunk(const char* p, const char* end, ObjChunk& chunk)
+{
+    Scalar x[3];
 
-    // parse line by line (currently only supports vertex positions & faces
-    while (in && !feof(in) && fgets(s, 200, in))
+    while (p != end)
     {
-        // comment
-        if (s[0] == '#' || isspace(s[0]))
-            continue;
+        const char* eol =
+            static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!eol)
+            eol = end;
 
-        // vertex
-        else if (strncmp(s, "v ", 2) == 0)
+        if (p[0] == 'v' && eol - p > 1 && is_blank(p[1]))
         {
-            if (sscanf(s, "v %f %f %f", &x, &y, &z))
-            {
-                mesh.add_vertex(Point(x, y, z));
-            }
+            if (parse_scalars(p + 2, eol, x, 3) == 3)
+                chunk.positions.emplace_back(x[0], x[1], x[2]);
+            else
+                chunk.error = true;
         }
-
-        // normal
-        else if (strncmp(s, "vn ", 3) == 0)
+        else if (p[0] == 'v' && eol - p > 2 && p[1] == 't' && is_blank(p[2]))
         {
-            if (sscanf(s, "vn %f %f %f", &x, &y, &z))
-            {
-                // problematic as it can be either a vertex property when interpolated
-                // or a halfedge property for hard edges
-            }
+            x[1] = 0;
+            if (parse_scalars(p + 3, eol, x, 2) >= 1)
+                chunk.tex_coords.emplace_back(x[0], x[1]);
+            else
+                chunk.error = true;
         }
-
-        // texture coordinate
-        else if (strncmp(s, "vt ", 3) == 0)
+        else if (p[0] == 'v' && eol - p > 2 && p[1] == 'n' && is_blank(p[2]))
+        {
+            if (parse_scalars(p + 3, eol, x, 3) == 3)
+                chunk.normals.emplace_back(x[0], x[1], x[2]);
+            else
+                chunk.error = true;
+        }
+        else if (p[0] == 'f' && eol - p > 1 && is_blank(p[1]))
         {
-            if (sscanf(s, "vt %f %f", &x, &y))
+            // corners are v, v/vt, v//vn, or v/vt/vn
+            const long counts[3] = {long(chunk.positions.size()),
+                                    long(chunk.tex_coords.size()),
+                                    long(chunk.normals.size())};
+            IndexType valence = 0;
+            const char* q = skip_blanks(p + 2, eol);
+            while (q != eol && !isspace(*q))
             {
-                all_tex_coords.emplace_back(x, y);
+                for (int k = 0; k < 3; ++k)
+                {
+                    long idx;
+                    const char* r = parse_int(q, eol, idx);
+                    if (r)
+                    {
+                        q = r;
+                        if (idx < 0)
+                        {
+                            chunk.relative[k].push_back(
+                                chunk.corners[k].size());
+                            idx += counts[k];
+                        }
+                        else
+                            idx -= 1;
+                    }
+                    else if (k == 0)
+                    {
+                        chunk.error = true;
+                        return;
+                    }
+                    else
+                        idx = -1;
+                    chunk.corners[k].push_back(idx);
+
+                    if (q == eol || *q != '/')
+                    {
+                        // fill missing components
+                        for (++k; k < 3; ++k)
+                            chunk.corners[k].push_back(-1);
+                        break;
+                    }
+                    ++q;
+                }
+                ++valence;
+                q = skip_blanks(q, eol);
             }
+            chunk.valences.push_back(valence);
         }
 
-        // face
-        else if (strncmp(s, "f ", 2) == 0)
-        {
-            int component(0), nv(0);
-            bool end_of_vertex(false);
-            char *p0, *p1(s + 1);
+        // skip comments, groups, materials, and everything else
+        p = eol == end ? end : eol + 1;
+    }
+}
 
-            vertices.clear();
-            halfedge_tex_idx.clear();
+} // namespace
 
-            // skip white-spaces
-            while (*p1 == ' ')
-                ++p1;
+bool SurfaceMeshIO::read_obj(SurfaceMesh& mesh)
+{
+    PMP_TRACE_SCOPE("SurfaceMeshIO::read_obj");
+    MappedFile file(filename_);
+    if (!file.is_open())
+        return false;
 
-            while (p1)
-            {
-                p0 = p1;
+    // split the file into chunks on line boundaries, the chunks do not
+    // depend on the number of threads
+    const size_t chunk_size = 1 << 22;
+    const int n_chunks = int(file.size() / chunk_size) + 1;
+    std::vector<const char*> bounds(n_chunks + 1);
+    bounds[0] = file.data();
+    for (int i = 1; i < n_chunks; ++i)
+        bounds[i] = std::max(bounds[i - 1],
+                             skip_line(file.data() + i * chunk_size - 1,
+                                       file.end()));
+    bounds[n_chunks] = file.end();
+
+    // parse the chunks in parallel
+    std::vector<ObjChunk> chunks(n_chunks);
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < n_chunks; ++i)
+    {
+        PMP_TRACE_SCOPE("parse OBJ chunk");
+        parse_obj_chunk(bounds[i], bounds[i + 1], chunks[i]);
+    }
 
-                // overwrite next separator
+    // resolve relative indices, count elements
+    size_t offsets[3] = {0, 0, 0};
+    size_t n_faces = 0, n_corners = 0;
+    for (auto& chunk : chunks)
+    {
+        if (chunk.error)
+            return false;
 
-                // skip '/', '\n', ' ', '\0', '\r' <-- don't forget Windows
-                while (*p1 != '/' && *p1 != '\r' && *p1 != '\n' && *p1 != ' ' &&
-                       *p1 != '\0')
-                    ++p1;
+        for (int k = 0; k < 3; ++k)
+            for (auto i : chunk.relative[k])
+                chunk.corners[k][i] += offsets[k];
 
-                // detect end of vertex
-                if (*p1 != '/')
-                {
-                    end_of_vertex = true;
-                }
+        offsets[0] += chunk.positions.size();
+        offsets[1] += chunk.tex_coords.size();
+        offsets[2] += chunk.normals.size();
+        n_faces += chunk.valences.size();
+        n_corners += chunk.corners[0].size();
+    }
 
-                // replace separator by '\0'
-                if (*p1 != '\0')
-                {
-                    *p1 = '\0';
-                    p1++; // point to next token
-                }
+    // add vertices
+    mesh.reserve(offsets[0], n_corners / 2, n_faces);
+    std::vector<TexCoord> tex_coords;
+    std::vector<Normal> normals;
+    tex_coords.reserve(offsets[1]);
+    normals.reserve(offsets[2]);
+    for (auto& chunk : chunks)
+    {
+        for (const auto& p : chunk.positions)
+            mesh.add_vertex(p);
+        tex_coords.insert(tex_coords.end(), chunk.tex_coords.begin(),
+                          chunk.tex_coords.end());
+        normals.insert(normals.end(), chunk.normals.begin(),
+                       chunk.normals.end());
+    }
 
-                // detect end of line and break
-                if (*p1 == '\0' || *p1 == '\n')
+    // gather the faces, faces with less than three corners are skipped
+    const long n_vertices = long(offsets[0]);
+    std::vector<IndexType> valences, indices;
+    std::vector<long> tex_indices, normal_indices;
+    valences.reserve(n_faces);
+    indices.reserve(n_corners);
+    if (!tex_coords.empty())
+        tex_indices.reserve(n_corners);
+    if (!normals.empty())
+        normal_indices.reserve(n_corners);
+    for (auto& chunk : chunks)
+    {
+        size_t c = 0;
+        for (auto valence : chunk.valences)
+        {
+            if (valence > 2)
+            {
+                for (IndexType i = 0; i < valence; ++i)
                 {
-                    p1 = nullptr;
+                    const long idx = chunk.corners[0][c + i];
+                    if (idx < 0 || idx >= n_vertices)
+                        return false;
+                    indices.push_back(IndexType(idx));
                 }
+                valences.push_back(valence);
+                if (!tex_coords.empty())
+                    tex_indices.insert(tex_indices.end(),
+                                       chunk.corners[1].begin() + c,
+                                       chunk.corners[1].begin() + c + valence);
+                if (!normals.empty())
+                    normal_indices.insert(
+                        normal_indices.end(), chunk.corners[2].begin() + c,
+                        chunk.corners[2].begin() + c + valence);
+            }
+            c += valence;
+        }
 
-                // read next vertex component
-                if (*p0 != '\0')
-                {
-                    switch (component)
-                    {
-                        case 0: // vertex
-                        {
-                            vertices.emplace_back(atoi(p0) - 1);
-                            break;
-                        }
-                        case 1: // texture coord
-                        {
-                            int idx = atoi(p0) - 1;
-                            halfedge_tex_idx.push_back(idx);
-                            with_tex_coord = true;
-                            break;
-                        }
-                        case 2: // normal
-                            break;
-                    }
-                }
+        // free memory early
+        chunk = ObjChunk();
+    }
 
-                ++component;
+    // build the connectivity
+    std::vector<Face> faces;
+    add_faces(mesh, valences, indices, faces);
 
-                if (end_of_vertex)
+    // keep texture coordinates and normals per halfedge
+    HalfedgeProperty<TexCoord> htex;
+    HalfedgeProperty<Normal> hnormal;
+    size_t c = 0;
+    for (size_t i = 0; i < faces.size(); ++i)
+    {
+        const Face f = faces[i];
+        const IndexType valence = valences[i];
+        if (f.is_valid() && (!tex_indices.empty() || !normal_indices.empty()))
+        {
+            // corner j is the target of the j-th halfedge of f
+            Halfedge h = mesh.halfedge(f);
+            for (IndexType j = 0; j < valence; ++j)
+            {
+                const long t = tex_indices.empty() ? -1 : tex_indices[c + j];
+                if (t >= 0 && t < long(tex_coords.size()))
                 {
-                    component = 0;
-                    nv++;
-                    end_of_vertex = false;
+                    if (!htex)
+                        htex = mesh.halfedge_property<TexCoord>("h:tex");
+                    htex[h] = tex_coords[t];
                 }
-            }
 
-            Face f = mesh.add_face(vertices);
-
-            // add texture coordinates
-            if (with_tex_coord)
-            {
-                SurfaceMesh::HalfedgeAroundFaceCirculator h_fit =
-                    mesh.halfedges(f);
-                SurfaceMesh::HalfedgeAroundFaceCirculator h_end = h_fit;
-                unsigned v_idx = 0;
-                do
+                const long n =
+                    normal_indices.empty() ? -1 : normal_indices[c + j];
+                if (n >= 0 && n < long(normals.size()))
                 {
-                    tex_coords[*h_fit] =
-                        all_tex_coords.at(halfedge_tex_idx.at(v_idx));
-                    ++v_idx;
-                    ++h_fit;
-                } while (h_fit != h_end);
+                    if (!hnormal)
+                        hnormal = mesh.halfedge_property<Normal>("h:normal");
+                    hnormal[h] = normals[n];
+                }
+
+                h = mesh.next_halfedge(h);
             }
         }
-        // clear line
-        memset(&s, 0, 200);
-    }
-
-    // if there are no textures, delete texture property!
-    if (!with_tex_coord)
-    {
-        mesh.remove_halfedge_property(tex_coords);
+        c += valence;
     }
 
-    fclose(in);
     return true;
 }
 
 bool SurfaceMeshIO::write_obj(const SurfaceMesh& mesh)
 {
+    PMP_TRACE_SCOPE("SurfaceMeshIO::write_obj");
+    // indices are written as they are, deleted elements have to go first
+    if (mesh.has_garbage())
+    {
+        SurfaceMesh compact(mesh);
+        compact.garbage_collection();
+        return write_obj(compact);
+    }
+
     FILE* out = fopen(filename_.c_str(), "w");
     if (!out)
         return false;
 
+    // vertex normals, or otherwise normals per halfedge as read from OBJ
+    auto normals = mesh.get_vertex_property<Normal>("v:normal");
+    auto hnormals = normals ? HalfedgeProperty<Normal>()
+                            : mesh.get_halfedge_property<Normal>("h:normal");
+    auto texcoords = mesh.get_halfedge_property<TexCoord>("h:tex");
+
+    const size_t nv = mesh.vertices_size();
+    const size_t nh = mesh.halfedges_size();
+    const size_t nf = mesh.faces_size();
+    WriteProgress progress(progress_, (normals ? 2 : 1) * nv +
+                                          (hnormals ? nh : 0) +
+                                          (texcoords ? nh : 0) + nf);
+
     // comment
     fprintf(out, "# OBJ export from SurfaceMesh\n");
 
-    //vertices
-    VertexProperty<Point> points = mesh.get_vertex_property<Point>("v:point");
-    for (SurfaceMesh::VertexIterator vit = mesh.vertices_begin();
-         vit != mesh.vertices_end(); ++vit)
+    // vertices
+    const Point* points = mesh.positions().data();
+    bool ok = write_lines(
+        out, nv,
+        [&](size_t i, TextBuffer& buffer) {
+            char* p = buffer.reserve(3 * max_number_length + 6);
+            *p++ = 'v';
+            *p++ = ' ';
+            p = format_scalars(p, points[i].data(), 3);
+            *p++ = '\n';
+            buffer.commit(p);
+        },
+        progress);
+
+    // normals, one per vertex or one per halfedge
+    if (normals || hnormals)
     {
-        const Point& p = points[*vit];
-        fprintf(out, "v %.10f %.10f %.10f\n", p[0], p[1], p[2]);
+        const Normal* n = normals ? normals.data() : hnormals.data();
+        ok = ok && write_lines(
+                       out, normals ? nv : nh,
+                       [&](size_t i, TextBuffer& buffer) {
+                           char* p = buffer.reserve(3 * max_number_length + 6);
+                           *p++ = 'v';
+                           *p++ = 'n';
+                           *p++ = ' ';
+                           p = format_scalars(p, n[i].data(), 3);
+                           *p++ = '\n';
+                           buffer.commit(p);
+                       },
+                       progress);
     }
 
-    //normals
-    VertexProperty<Point> normals = mesh.get_vertex_property<Point>("v:normal");
-    if (normals)
+    // texture coordinates, one per halfedge
+    if (texcoords)
     {
-        for (SurfaceMesh::VertexIterator vit = mesh.vertices_begin();
-             vit != mesh.vertices_end(); ++vit)
-        {
-            const Point& p = normals[*vit];
-            fprintf(out, "vn %.10f %.10f %.10f\n", p[0], p[1], p[2]);
-        }
+        const TexCoord* t = texcoords.data();
+        ok = ok && write_lines(
+                       out, nh,
+                       [&](size_t i, TextBuffer& buffer) {
+                           char* p = buffer.reserve(2 * max_number_length + 5);
+                           *p++ = 'v';
+                           *p++ = 't';
+                           *p++ = ' ';
+                           p = format_scalars(p, t[i].data(), 2);
+                           *p++ = '\n';
+                           buffer.commit(p);
+                       },
+                       progress);
     }
 
-    // optional texture coordinates
-    // do we have them?
-    std::vector<std::string> hprops = mesh.halfedge_properties();
-    bool with_tex_coord = false;
-    auto hpropEnd = hprops.end();
-    auto hpropStart = hprops.begin();
-    while (hpropStart != hpropEnd)
+    // faces, with texture coordinate and normal indices if available
+    ok = ok && write_lines(
+                   out, nf,
+                   [&](size_t i, TextBuffer& buffer) {
+                       const Face f = Face(IndexType(i));
+                       const size_t valence = mesh.valence(f);
+                       char* p = buffer.reserve(
+                           valence * (3 * max_number_length + 3) + 3);
+                       *p++ = 'f';
+                       for (auto h : mesh.halfedges(f))
+                       {
+                           const uint64_t v = mesh.to_vertex(h).idx() + 1;
+                           *p++ = ' ';
+                           p = format_uint(p, v);
+                           if (texcoords || normals || hnormals)
+                           {
+                               *p++ = '/';
+                               if (texcoords)
+                                   p = format_uint(p, h.idx() + 1);
+                           }
+                           if (normals || hnormals)
+                           {
+                               *p++ = '/';
+                               p = format_uint(p,
+                                               normals ? v : h.idx() + 1);
+                           }
+                       }
+                       *p++ = '\n';
+                       buffer.commit(p);
+                   },
+                   progress);
+
+    return fclose(out) == 0 && ok;
+}
+
+namespace {
+
+// number of vertices or faces of an OFF file parsed as one block
+const size_t off_block_size = 1 << 14;
+
+// parse the vertex lines of a block of an ASCII OFF file, values receives
+// n_values numbers per vertex. a color ending at value color_end may have an
+// alpha component, which is dropped. returns false on errors.
+bool parse_off_vertices(const char* p, const char* end, size_t n,
+                        int n_values, int color_end, Scalar* values)
+{
+    Scalar line[13];
+    for (size_t i = 0; i < n; ++i, values += n_values)
     {
-        if (0 == (*hpropStart).compare("h:tex"))
+        p = next_record(p, end);
+        const char* eol = skip_line(p, end);
+
+        const int k = parse_scalars(p, eol, line, n_values + 1);
+        if (k < 3)
+            return false;
+        const int alpha = (color_end && k > n_values) ? 1 : 0;
+        for (int j = 0; j < n_values; ++j)
         {
-            with_tex_coord = true;
+            const int l = j < color_end ? j : j + alpha;
+            values[j] = l < k ? line[l] : Scalar(0);
         }
-        ++hpropStart;
+
+        p = eol;
     }
+    return true;
+}
 
-    //if so then add
-    if (with_tex_coord)
+// parse the face lines of a block of an ASCII OFF file into indices, faces
+// have been counted before. returns false on errors.
+bool parse_off_faces(const char* p, const char* end, size_t n, long nv,
+                     IndexType* indices)
+{
+    for (size_t i = 0; i < n; ++i)
     {
-        HalfedgeProperty<TexCoord> texCoord =
-            mesh.get_halfedge_property<TexCoord>("h:tex");
-        for (SurfaceMesh::HalfedgeIterator hit = mesh.halfedges_begin();
-             hit != mesh.halfedges_end(); ++hit)
+        p = next_record(p, end);
+        const char* eol = skip_line(p, end);
+
+        long valence, idx;
+        p = parse_int(p, eol, valence);
+        for (long j = 0; j < valence; ++j)
         {
-            const TexCoord& pt = texCoord[*hit];
-            fprintf(out, "vt %.10f %.10f \n", pt[0], pt[1]);
+            p = parse_int(skip_blanks(p, eol), eol, idx);
+            if (!p || idx < 0 || idx >= nv)
+                return false;
+            *indices++ = IndexType(idx);
         }
-    }
 
-    //faces
-    for (SurfaceMesh::FaceIterator fit = mesh.faces_begin();
-         fit != mesh.faces_end(); ++fit)
-    {
-        fprintf(out, "f");
-        SurfaceMesh::VertexAroundFaceCirculator fvit = mesh.vertices(*fit),
-                                                fvend = fvit;
-        SurfaceMesh::HalfedgeAroundFaceCirculator fhit = mesh.halfedges(*fit);
-        do
-        {
-            if (with_tex_coord)
-            {
-                // write vertex index, texCoord index and normal index
-                fprintf(out, " %d/%d/%d", (*fvit).idx() + 1, (*fhit).idx() + 1,
-                        (*fvit).idx() + 1);
-                ++fhit;
-            }
-            else
-            {
-                // write vertex index and normal index
-                fprintf(out, " %d//%d", (*fvit).idx() + 1, (*fvit).idx() + 1);
-            }
-        } while (++fvit != fvend);
-        fprintf(out, "\n");
+        // per-face colors are ignored
+        p = eol;
     }
-
-    fclose(out);
     return true;
 }
 
-bool read_off_ascii(SurfaceMesh& mesh, FILE* in, const bool has_normals,
-                    const bool has_texcoords, const bool has_colors)
+bool read_off_ascii(SurfaceMesh& mesh, const char* p, const char* end,
+                    const bool has_normals, const bool has_texcoords,
+                    const bool has_colors)
 {
-    char line[1000], *lp;
-    int nc;
-    unsigned int i, j, items, idx;
-    unsigned int nv, nf, ne;
-    float x, y, z, r, g, b;
-    Vertex v;
-
-    // properties
-    VertexProperty<Normal> normals;
-    VertexProperty<TexCoord> texcoords;
-    VertexProperty<Color> colors;
-    if (has_normals)
-        normals = mesh.vertex_property<Normal>("v:normal");
-    if (has_texcoords)
-        texcoords = mesh.vertex_property<TexCoord>("v:tex");
-    if (has_colors)
-        colors = mesh.vertex_property<Color>("v:color");
+    // #Vertice, #Faces, #Edges (not used)
+    long nv, nf;
+    p = parse_int(next_record(p, end), end, nv);
+    if (!p || nv < 0)
+        return false;
+    p = parse_int(next_record(p, end), end, nf);
+    if (!p || nf < 0)
+        return false;
+    p = skip_line(p, end);
 
-    // #Vertice, #Faces, #Edges
-    items = fscanf(in, "%d %d %d\n", (int*)&nv, (int*)&nf, (int*)&ne);
-    PMP_ASSERT(items);
+    // values per vertex: pos [normal] [color] [texcoord]
+    const int color_end = has_colors ? (has_normals ? 9 : 6) : 0;
+    const int n_values =
+        3 + (has_normals ? 3 : 0) + (has_colors ? 3 : 0) + (has_texcoords ? 2 : 0);
 
-    mesh.reserve(nv, std::max(3 * nv, ne), nf);
+    // find the first vertex of each block
+    std::vector<const char*> vblocks;
+    for (long i = 0; i < nv; ++i)
+    {
+        p = next_record(p, end);
+        if (p == end)
+            return false;
+        if (i % off_block_size == 0)
+            vblocks.push_back(p);
+        p = skip_line(p, end);
+    }
 
-    // read vertices: pos [normal] [color] [texcoord]
-    for (i = 0; i < nv && !feof(in); ++i)
+    // count the corners of all faces, find the first face of each block
+    std::vector<IndexType> valences(nf);
+    std::vector<const char*> fblocks;
+    std::vector<size_t> fblock_corners;
+    size_t n_corners = 0;
+    bool degenerate = false;
+    for (long i = 0; i < nf; ++i)
     {
-        // read line
-        lp = fgets(line, 1000, in);
-        lp = line;
+        p = next_record(p, end);
+        if (i % off_block_size == 0)
+        {
+            fblocks.push_back(p);
+            fblock_corners.push_back(n_corners);
+        }
 
-        // position
-        items = sscanf(lp, "%f %f %f%n", &x, &y, &z, &nc);
-        assert(items == 3);
-        v = mesh.add_vertex(Point(x, y, z));
-        lp += nc;
+        long valence;
+        if (!parse_int(p, end, valence) || valence < 0)
+            return false;
+        valences[i] = IndexType(valence);
+        degenerate |= (valence < 3);
+        n_corners += valence;
+        p = skip_line(p, end);
+    }
 
-        // normal
-        if (has_normals)
+    // parse vertices and faces in parallel
+    std::vector<Scalar> values(nv * n_values);
+    std::vector<IndexType> indices(n_corners);
+    const int n_vblocks = int(vblocks.size());
+    const int n_blocks = n_vblocks + int(fblocks.size());
+    bool ok = true;
+#pragma omp parallel for schedule(dynamic) reduction(&& : ok)
+    for (int i = 0; i < n_blocks; ++i)
+    {
+        PMP_TRACE_SCOPE("parse OFF block");
+        if (i < n_vblocks)
         {
-            if (sscanf(lp, "%f %f %f%n", &x, &y, &z, &nc) == 3)
-            {
-                normals[v] = Normal(x, y, z);
-            }
-            lp += nc;
+            const size_t first = i * off_block_size;
+            const size_t n = std::min(off_block_size, size_t(nv) - first);
+            ok = ok && parse_off_vertices(vblocks[i], end, n, n_values,
+                                          color_end, &values[first * n_values]);
+        }
+        else
+        {
+            const size_t b = i - n_vblocks;
+            const size_t first = b * off_block_size;
+            const size_t n = std::min(off_block_size, size_t(nf) - first);
+            ok = ok && parse_off_faces(fblocks[b], end, n, nv,
+                                       indices.data() + fblock_corners[b]);
         }
+    }
+    if (!ok)
+        return false;
 
-        // color
-        if (has_colors)
+    // faces with less than three corners are skipped
+    if (degenerate)
+    {
+        size_t c = 0, cc = 0, ff = 0;
+        for (long i = 0; i < nf; ++i)
         {
-            if (sscanf(lp, "%f %f %f%n", &r, &g, &b, &nc) == 3)
+            const IndexType valence = valences[i];
+            if (valence > 2)
             {
-                if (r > 1.0f || g > 1.0f || b > 1.0f)
-                {
-                    r /= 255.0f;
-                    g /= 255.0f;
-                    b /= 255.0f;
-                }
-                colors[v] = Color(r, g, b);
+                std::copy(indices.begin() + c, indices.begin() + c + valence,
+                          indices.begin() + cc);
+                valences[ff++] = valence;
+                cc += valence;
             }
-            lp += nc;
+            c += valence;
         }
+        valences.resize(ff);
+        indices.resize(cc);
+    }
 
-        // tex coord
-        if (has_texcoords)
+    // add vertices and their properties
+    mesh.reserve(nv, n_corners / 2, valences.size());
+    for (long i = 0; i < nv; ++i)
+    {
+        const Scalar* x = &values[i * n_values];
+        mesh.add_vertex(Point(x[0], x[1], x[2]));
+    }
+
+    int k = 3;
+    if (has_normals)
+    {
+        auto normals = mesh.vertex_property<Normal>("v:normal");
+        for (auto v : mesh.vertices())
         {
-            items = sscanf(lp, "%f %f%n", &x, &y, &nc);
-            assert(items == 2);
-            texcoords[v][0] = x;
-            texcoords[v][1] = y;
-            lp += nc;
+            const Scalar* x = &values[v.idx() * n_values + k];
+            normals[v] = Normal(x[0], x[1], x[2]);
         }
+        k += 3;
     }
-
-    // read faces: #N v[1] v[2] ... v[n-1]
-    std::vector<Vertex> vertices;
-    for (i = 0; i < nf; ++i)
+    if (has_colors)
     {
-        // read line
-        lp = fgets(line, 1000, in);
-        lp = line;
-
-        // #vertices
-        items = sscanf(lp, "%d%n", (int*)&nv, &nc);
-        assert(items == 1);
-        vertices.resize(nv);
-        lp += nc;
-
-        // indices
-        for (j = 0; j < nv; ++j)
+        auto colors = mesh.vertex_property<Color>("v:color");
+        for (auto v : mesh.vertices())
         {
-            items = sscanf(lp, "%d%n", (int*)&idx, &nc);
-            assert(items == 1);
-            vertices[j] = Vertex(idx);
-            lp += nc;
+            const Scalar* x = &values[v.idx() * n_values + k];
+            Color c(x[0], x[1], x[2]);
+            if (c[0] > 1.0f || c[1] > 1.0f || c[2] > 1.0f)
+                c /= 255.0f;
+            colors[v] = c;
+        }
+        k += 3;
+    }
+    if (has_texcoords)
+    {
+        auto texcoords = mesh.vertex_property<TexCoord>("v:tex");
+        for (auto v : mesh.vertices())
+        {
+            const Scalar* x = &values[v.idx() * n_values + k];
+            texcoords[v] = TexCoord(x[0], x[1]);
         }
-        if (vertices.size() == nv)
-            mesh.add_face(vertices);
-        else
-            std::cerr << "OFF: fail to read face " << i << std::endl;
     }
+    values = std::vector<Scalar>();
+
+    // add faces
+    std::vector<Face> faces;
+    add_faces(mesh, valences, indices, faces);
 
     return true;
 }
 
+} // namespace
+
 bool read_off_binary(SurfaceMesh& mesh, FILE* in, const bool has_normals,
                      const bool has_texcoords, const bool has_colors)
 {
@@ -536,6 +1246,7 @@ bool read_off_binary(SurfaceMesh& mesh, FILE* in, const bool has_normals,
 
 bool SurfaceMeshIO::write_off_binary(const SurfaceMesh& mesh)
 {
+    PMP_TRACE_SCOPE("SurfaceMeshIO::write_off_binary");
     FILE* out = fopen(filename_.c_str(), "w");
     if (!out)
         return false;
@@ -571,7 +1282,7 @@ bool SurfaceMeshIO::write_off_binary(const SurfaceMesh& mesh)
 
 bool SurfaceMeshIO::read_off(SurfaceMesh& mesh)
 {
-    char line[200];
+    PMP_TRACE_SCOPE("SurfaceMeshIO::read_off");
     bool has_texcoords = false;
     bool has_normals = false;
     bool has_colors = false;
@@ -579,157 +1290,509 @@ bool SurfaceMeshIO::read_off(SurfaceMesh& mesh)
     bool has_dim = false;
     bool is_binary = false;
 
-    // open file (in ASCII mode)
-    FILE* in = fopen(filename_.c_str(), "r");
-    if (!in)
+    MappedFile file(filename_);
+    if (!file.is_open())
         return false;
 
     // read header: [ST][C][N][4][n]OFF BINARY
-    char* c = fgets(line, 200, in);
-    assert(c != nullptr);
-    c = line;
-    if (c[0] == 'S' && c[1] == 'T')
+    const char* c = file.data();
+    const char* end = file.end();
+    auto starts_with = [&](const char* s) {
+        const size_t n = strlen(s);
+        return size_t(end - c) >= n && strncmp(c, s, n) == 0;
+    };
+    if (starts_with("ST"))
     {
         has_texcoords = true;
         c += 2;
     }
-    if (c[0] == 'C')
+    if (starts_with("C"))
     {
         has_colors = true;
         ++c;
     }
-    if (c[0] == 'N')
+    if (starts_with("N"))
     {
         has_normals = true;
         ++c;
     }
-    if (c[0] == '4')
+    if (starts_with("4"))
     {
         has_hcoords = true;
         ++c;
     }
-    if (c[0] == 'n')
+    if (starts_with("n"))
     {
         has_dim = true;
         ++c;
     }
-    if (strncmp(c, "OFF", 3) != 0)
-    {
-        fclose(in);
-        return false;
-    } // no OFF
-    if (strncmp(c + 4, "BINARY", 6) == 0)
+    if (!starts_with("OFF"))
+        return false; // no OFF
+    c += 3;
+    if (starts_with(" BINARY"))
         is_binary = true;
 
     // homogeneous coords, and vertex dimension != 3 are not supported
     if (has_hcoords || has_dim)
-    {
-        fclose(in);
         return false;
-    }
-
-    // if binary: reopen file in binary mode
-    if (is_binary)
-    {
-        fclose(in);
-        in = fopen(filename_.c_str(), "rb");
-        c = fgets(line, 200, in);
-        assert(c != nullptr);
-    }
 
-    // read as ASCII or binary
-    bool ok = (is_binary ? read_off_binary(mesh, in, has_normals, has_texcoords,
-                                           has_colors)
-                         : read_off_ascii(mesh, in, has_normals, has_texcoords,
-                                          has_colors));
+    if (!is_binary)
+        return read_off_ascii(mesh, c, end, has_normals, has_texcoords,
+                              has_colors);
 
+    // binary: skip the header line
+    FILE* in = fopen(filename_.c_str(), "rb");
+    if (!in)
+        return false;
+    char line[200];
+    char* l = fgets(line, 200, in);
+    assert(l != nullptr);
+    (void)l;
+    bool ok =
+        read_off_binary(mesh, in, has_normals, has_texcoords, has_colors);
     fclose(in);
     return ok;
 }
 
 bool SurfaceMeshIO::write_off(const SurfaceMesh& mesh)
 {
+    PMP_TRACE_SCOPE("SurfaceMeshIO::write_off");
     if (flags_.use_binary)
         return write_off_binary(mesh);
 
+    // indices are written as they are, deleted elements have to go first
+    if (mesh.has_garbage())
+    {
+        SurfaceMesh compact(mesh);
+        compact.garbage_collection();
+        return write_off(compact);
+    }
+
     FILE* out = fopen(filename_.c_str(), "w");
     if (!out)
         return false;
 
-    bool has_normals = false;
-    bool has_texcoords = false;
-    bool has_colors = false;
-
     auto normals = mesh.get_vertex_property<Normal>("v:normal");
     auto texcoords = mesh.get_vertex_property<TexCoord>("v:tex");
     auto colors = mesh.get_vertex_property<Color>("v:color");
 
-    if (normals && flags_.use_vertex_normals)
-        has_normals = true;
-    if (texcoords && flags_.use_vertex_texcoords)
-        has_texcoords = true;
-    if (colors && flags_.use_vertex_colors)
-        has_colors = true;
+    const Normal* n = normals && flags_.use_vertex_normals ? normals.data()
+                                                            : nullptr;
+    const TexCoord* t =
+        texcoords && flags_.use_vertex_texcoords ? texcoords.data() : nullptr;
+    const Color* c = colors && flags_.use_vertex_colors ? colors.data() : nullptr;
 
     // header
-    if (has_texcoords)
+    if (t)
         fprintf(out, "ST");
-    if (has_colors)
+    if (c)
         fprintf(out, "C");
-    if (has_normals)
+    if (n)
         fprintf(out, "N");
     fprintf(out, "OFF\n%zu %zu 0\n", mesh.n_vertices(), mesh.n_faces());
 
-    // vertices, and optionally normals and texture coordinates
-    VertexProperty<Point> points = mesh.get_vertex_property<Point>("v:point");
-    for (SurfaceMesh::VertexIterator vit = mesh.vertices_begin();
-         vit != mesh.vertices_end(); ++vit)
+    const size_t nv = mesh.vertices_size();
+    const size_t nf = mesh.faces_size();
+    WriteProgress progress(progress_, nv + nf);
+
+    // vertices, and optionally normals, colors, and texture coordinates
+    const Point* points = mesh.positions().data();
+    bool ok = write_lines(
+        out, nv,
+        [&](size_t i, TextBuffer& buffer) {
+            char* p = buffer.reserve(11 * (max_number_length + 1) + 1);
+            p = format_scalars(p, points[i].data(), 3);
+            if (n)
+            {
+                *p++ = ' ';
+                p = format_scalars(p, n[i].data(), 3);
+            }
+            if (c)
+            {
+                *p++ = ' ';
+                p = format_scalars(p, c[i].data(), 3);
+            }
+            if (t)
+            {
+                *p++ = ' ';
+                p = format_scalars(p, t[i].data(), 2);
+            }
+            *p++ = '\n';
+            buffer.commit(p);
+        },
+        progress);
+
+    // faces
+    ok = ok && write_lines(
+                   out, nf,
+                   [&](size_t i, TextBuffer& buffer) {
+                       const Face f = Face(IndexType(i));
+                       const size_t valence = mesh.valence(f);
+                       char* p =
+                           buffer.reserve((valence + 1) * max_number_length + 1);
+                       p = format_uint(p, valence);
+                       for (auto v : mesh.vertices(f))
+                       {
+                           *p++ = ' ';
+                           p = format_uint(p, v.idx());
+                       }
+                       *p++ = '\n';
+                       buffer.commit(p);
+                   },
+                   progress);
+
+    return fclose(out) == 0 && ok;
+}
+
+namespace {
+
+// .pmp files since version 2 start with this tag. version 1 files start
+// with the number of vertices, which would have to be above 1.3 billion
+// to look like the tag.
+const char pmp_tag[8] = {'\x89', 'P', 'M', 'P', '\r', '\n', '\x1a', '\n'};
+const uint32_t pmp_version = 2;
+const uint32_t pmp_byte_order = 0x01020304;
+
+// property data is aligned to cache lines, which makes it suitable for
+// memory mapping
+const uint64_t pmp_alignment = 64;
+
+struct PmpHeader
+{
+    char tag[8];
+    uint32_t version;
+    uint32_t byte_order; // pmp_byte_order as written by the writer
+    uint32_t index_size; // sizeof(IndexType)
+    uint32_t n_sections;
+
+    // number of elements including deleted ones, and number of deleted ones
+    uint64_t n_vertices, n_edges, n_faces;
+    uint64_t deleted_vertices, deleted_edges, deleted_faces;
+};
+
+// one section per property, the header is followed by a table of all
+// sections and their names
+struct PmpSection
+{
+    uint32_t kind; // 0: object, 1: vertex, 2: halfedge, 3: edge, 4: face
+    uint32_t type; // see SurfaceMeshIO::dispatch_pmp_type()
+    uint64_t element_size;
+    uint64_t name_size;
+    uint64_t data_offset; // from the start of the file
+    uint64_t data_size;
+};
+
+const uint32_t n_pmp_types = 18;
+const uint32_t n_pmp_kinds = 5;
+
+uint64_t pmp_align(uint64_t offset)
+{
+    return (offset + pmp_alignment - 1) / pmp_alignment * pmp_alignment;
+}
+
+// size of the data of n elements of type T in a .pmp file
+template <class T>
+uint64_t pmp_data_size(uint64_t n)
+{
+    return n * sizeof(T);
+}
+
+template <>
+uint64_t pmp_data_size<bool>(uint64_t n)
+{
+    return (n + 63) / 64 * sizeof(BitVector::Word);
+}
+
+// raw data of a property, bool properties are stored bit-packed
+template <class T>
+const void* pmp_data(const Property<T>& p)
+{
+    return p.data();
+}
+
+const void* pmp_data(const Property<bool>& p)
+{
+    return p.vector().words().data();
+}
+
+// let p use the data in the mapped file, bool properties cannot be mapped
+template <class T>
+bool pmp_map(Property<T> p, const std::shared_ptr<MappedFile>& file,
+             char* data, size_t n, bool writable)
+{
+    if (reinterpret_cast<uintptr_t>(data) % alignof(T) != 0)
+        return false;
+    p.map(file, reinterpret_cast<T*>(data), n, writable);
+    return true;
+}
+
+bool pmp_map(Property<bool>, const std::shared_ptr<MappedFile>&, char*,
+             size_t, bool)
+{
+    return false;
+}
+
+// copy the data of the file to p, which has the right size already
+template <class T>
+void pmp_copy(Property<T> p, const char* data, size_t bytes)
+{
+    if (bytes)
+        memcpy(static_cast<void*>(p.vector().data()), data, bytes);
+}
+
+void pmp_copy(Property<bool> p, const char* data, size_t bytes)
+{
+    if (bytes)
+        memcpy(p.vector().words().data(), data, bytes);
+}
+
+// finds the type tag of a property type
+struct PmpTypeMatch
+{
+    const std::type_info& type;
+
+    template <class T>
+    bool apply()
     {
-        const Point& p = points[*vit];
-        fprintf(out, "%.10f %.10f %.10f", p[0], p[1], p[2]);
+        return typeid(T) == type;
+    }
+};
 
-        if (has_normals)
-        {
-            const Normal& n = normals[*vit];
-            fprintf(out, " %.10f %.10f %.10f", n[0], n[1], n[2]);
-        }
+// gathers the data of a property for writing
+struct PmpPropertyData
+{
+    const PropertyContainer& container;
+    const std::string& name;
+    const void* data;
+    uint64_t element_size;
+    uint64_t data_size;
+
+    template <class T>
+    bool apply()
+    {
+        const Property<T> p = container.get<T>(name);
+        data = pmp_data(p);
+        element_size = sizeof(T);
+        data_size = pmp_data_size<T>(container.size());
+        return true;
+    }
+};
 
-        if (has_colors)
-        {
-            const Color& c = colors[*vit];
-            fprintf(out, " %.10f %.10f %.10f", c[0], c[1], c[2]);
-        }
+// adds a property from a .pmp file to its container. the first pass maps
+// the data if requested, the second pass (after the container has been
+// resized) copies all data that has not been mapped.
+struct PmpPropertyReader
+{
+    PropertyContainer& container;
+    const std::string& name;
+    const PmpSection& section;
+    const std::shared_ptr<MappedFile>& file;
+    size_t n;
+    bool first_pass, map, writable, mapped;
+
+    template <class T>
+    bool apply()
+    {
+        if (section.element_size != sizeof(T) ||
+            section.data_size != pmp_data_size<T>(n))
+            return false;
 
-        if (has_texcoords)
+        Property<T> p = container.get<T>(name);
+        if (!p)
         {
-            const TexCoord& t = texcoords[*vit];
-            fprintf(out, " %.10f %.10f", t[0], t[1]);
+            if (container.exists(name))
+                return false;
+            p = container.add<T>(name);
         }
 
-        fprintf(out, "\n");
+        char* data = file->data() + section.data_offset;
+        if (first_pass && map)
+            mapped = pmp_map(p, file, data, n, writable);
+        else if (!first_pass && !mapped)
+            pmp_copy(p, data, section.data_size);
+        return true;
     }
+};
 
-    // faces
-    for (SurfaceMesh::FaceIterator fit = mesh.faces_begin();
-         fit != mesh.faces_end(); ++fit)
+} // namespace
+
+template <class F>
+bool SurfaceMeshIO::dispatch_pmp_type(unsigned int type, F& f)
+{
+    // the tags must never change, new types are added at the end
+    switch (type)
     {
-        int nv = mesh.valence(*fit);
-        fprintf(out, "%d", nv);
-        SurfaceMesh::VertexAroundFaceCirculator fvit = mesh.vertices(*fit),
-                                                fvend = fvit;
-        do
-        {
-            fprintf(out, " %d", (*fvit).idx());
-        } while (++fvit != fvend);
-        fprintf(out, "\n");
+        case 0:
+            return f.template apply<bool>();
+        case 1:
+            return f.template apply<int>();
+        case 2:
+            return f.template apply<unsigned int>();
+        case 3:
+            return f.template apply<float>();
+        case 4:
+            return f.template apply<double>();
+        case 5:
+            return f.template apply<vec2>();
+        case 6:
+            return f.template apply<vec3>();
+        case 7:
+            return f.template apply<vec4>();
+        case 8:
+            return f.template apply<dvec2>();
+        case 9:
+            return f.template apply<dvec3>();
+        case 10:
+            return f.template apply<dvec4>();
+        case 11:
+            return f.template apply<Vertex>();
+        case 12:
+            return f.template apply<Halfedge>();
+        case 13:
+            return f.template apply<Edge>();
+        case 14:
+            return f.template apply<Face>();
+        case 15:
+            return f.template apply<SurfaceMesh::VertexConnectivity>();
+        case 16:
+            return f.template apply<SurfaceMesh::HalfedgeConnectivity>();
+        case 17:
+            return f.template apply<SurfaceMesh::FaceConnectivity>();
     }
-
-    fclose(out);
-    return true;
+    return false;
 }
 
 bool SurfaceMeshIO::read_pmp(SurfaceMesh& mesh)
 {
+    PMP_TRACE_SCOPE("SurfaceMeshIO::read_pmp");
+    const bool map = flags_.use_memory_mapping;
+    const bool writable = map && !flags_.map_read_only;
+    auto file = std::make_shared<MappedFile>(filename_, writable);
+    if (!file->is_open())
+        return false;
+
+    PmpHeader header;
+    if (file->size() >= sizeof(header) &&
+        memcmp(file->data(), pmp_tag, sizeof(pmp_tag)) == 0)
+    {
+        memcpy(&header, file->data(), sizeof(header));
+        if (header.version != pmp_version)
+        {
+            std::cerr << "read_pmp: unsupported version " << header.version
+                      << std::endl;
+            return false;
+        }
+        if (header.byte_order != pmp_byte_order ||
+            header.index_size != sizeof(IndexType))
+        {
+            std::cerr << "read_pmp: byte order or index size differ"
+                      << std::endl;
+            return false;
+        }
+
+        // the element counts have to fit IndexType, also for the halfedges
+        const uint64_t max_index = std::numeric_limits<IndexType>::max();
+        if (header.n_vertices > max_index || header.n_edges > max_index / 2 ||
+            header.n_faces > max_index ||
+            header.deleted_vertices > header.n_vertices ||
+            header.deleted_edges > header.n_edges ||
+            header.deleted_faces > header.n_faces)
+        {
+            std::cerr << "read_pmp: invalid element counts" << std::endl;
+            return false;
+        }
+
+        // read the section table, its size is checked before allocating it
+        uint64_t offset = sizeof(header);
+        if (header.n_sections > (file->size() - offset) / sizeof(PmpSection))
+            return false;
+        std::vector<PmpSection> sections(header.n_sections);
+        std::vector<std::string> names(header.n_sections);
+        if (!sections.empty())
+            memcpy(sections.data(), file->data() + offset,
+                   sections.size() * sizeof(PmpSection));
+        offset += sections.size() * sizeof(PmpSection);
+        for (size_t i = 0; i < sections.size(); ++i)
+        {
+            const PmpSection& section = sections[i];
+            if (section.kind >= n_pmp_kinds ||
+                section.name_size > file->size() - offset ||
+                section.data_offset % pmp_alignment != 0 ||
+                section.data_offset > file->size() ||
+                section.data_size > file->size() - section.data_offset)
+                return false;
+            names[i].assign(file->data() + offset, section.name_size);
+            offset += section.name_size;
+        }
+
+        // the connectivity and the positions have to be present. as the
+        // size of each section is checked against the element counts, this
+        // also bounds the counts by the size of the file.
+        const std::pair<uint32_t, const char*> required[] = {
+            {1, "v:connectivity"},
+            {2, "h:connectivity"},
+            {4, "f:connectivity"},
+            {1, "v:point"}};
+        for (const auto& r : required)
+        {
+            bool found = false;
+            for (size_t i = 0; i < sections.size() && !found; ++i)
+                found = sections[i].kind == r.first && names[i] == r.second;
+            if (!found)
+            {
+                std::cerr << "read_pmp: missing property " << r.second
+                          << std::endl;
+                return false;
+            }
+        }
+
+        PropertyContainer* containers[n_pmp_kinds] = {
+            &mesh.oprops_, &mesh.vprops_, &mesh.hprops_, &mesh.eprops_,
+            &mesh.fprops_};
+        const size_t sizes[n_pmp_kinds] = {
+            1, size_t(header.n_vertices), size_t(2 * header.n_edges),
+            size_t(header.n_edges), size_t(header.n_faces)};
+
+        // map (or just add) the properties, resize the containers, and
+        // copy what has not been mapped
+        std::vector<char> mapped(sections.size(), false);
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            if (pass == 1)
+                for (uint32_t k = 1; k < n_pmp_kinds; ++k)
+                    containers[k]->resize(sizes[k]);
+
+            for (size_t i = 0; i < sections.size(); ++i)
+            {
+                const PmpSection& section = sections[i];
+                PmpPropertyReader reader{*containers[section.kind],
+                                         names[i],
+                                         section,
+                                         file,
+                                         sizes[section.kind],
+                                         pass == 0,
+                                         map,
+                                         writable,
+                                         bool(mapped[i])};
+                if (!dispatch_pmp_type(section.type, reader))
+                {
+                    std::cerr << "read_pmp: cannot read property " << names[i]
+                              << std::endl;
+                    return false;
+                }
+                mapped[i] = reader.mapped;
+            }
+        }
+
+        mesh.deleted_vertices_ = IndexType(header.deleted_vertices);
+        mesh.deleted_edges_ = IndexType(header.deleted_edges);
+        mesh.deleted_faces_ = IndexType(header.deleted_faces);
+        mesh.has_garbage_ = header.deleted_vertices ||
+                            header.deleted_edges || header.deleted_faces;
+        return true;
+    }
+
+    // version 1: connectivity, positions, and halfedge texture coordinates
     // open file (in binary mode)
     FILE* in = fopen(filename_.c_str(), "rb");
     if (!in)
@@ -746,6 +1809,20 @@ bool SurfaceMeshIO::read_pmp(SurfaceMesh& mesh)
     bool has_htex(false);
     tfread(in, has_htex);
 
+    // do the counts fit the size of the file?
+    const uint64_t v1_bytes =
+        uint64_t(nv) * (sizeof(SurfaceMesh::VertexConnectivity) +
+                        sizeof(Point)) +
+        uint64_t(ne) * 2 *
+            (sizeof(SurfaceMesh::HalfedgeConnectivity) +
+             (has_htex ? sizeof(TexCoord) : 0)) +
+        uint64_t(nf) * sizeof(SurfaceMesh::FaceConnectivity);
+    if (ferror(in) || feof(in) || v1_bytes > file->size())
+    {
+        fclose(in);
+        return false;
+    }
+
     // resize containers
     mesh.vprops_.resize(nv);
     mesh.hprops_.resize(nh);
@@ -788,6 +1865,7 @@ bool SurfaceMeshIO::read_pmp(SurfaceMesh& mesh)
 
 bool SurfaceMeshIO::read_xyz(SurfaceMesh& mesh)
 {
+    PMP_TRACE_SCOPE("SurfaceMeshIO::read_xyz");
     // open file (in ASCII mode)
     FILE* in = fopen(filename_.c_str(), "r");
     if (!in)
@@ -824,6 +1902,7 @@ bool SurfaceMeshIO::read_xyz(SurfaceMesh& mesh)
 // \todo remove duplication with read_xyz
 bool SurfaceMeshIO::read_agi(SurfaceMesh& mesh)
 {
+    PMP_TRACE_SCOPE("SurfaceMeshIO::read_agi");
     // open file (in ASCII mode)
     FILE* in = fopen(filename_.c_str(), "r");
     if (!in)
@@ -859,211 +1938,338 @@ bool SurfaceMeshIO::read_agi(SurfaceMesh& mesh)
 
 bool SurfaceMeshIO::write_pmp(const SurfaceMesh& mesh)
 {
-    // open file (in binary mode)
-    FILE* out = fopen(filename_.c_str(), "wb");
-    if (!out)
-        return false;
-
-    // get properties
-    auto vconn = mesh.get_vertex_property<SurfaceMesh::VertexConnectivity>(
-        "v:connectivity");
-    auto hconn = mesh.get_halfedge_property<SurfaceMesh::HalfedgeConnectivity>(
-        "h:connectivity");
-    auto fconn =
-        mesh.get_face_property<SurfaceMesh::FaceConnectivity>("f:connectivity");
-    auto point = mesh.get_vertex_property<Point>("v:point");
-    auto htex = mesh.get_halfedge_property<TexCoord>("h:tex");
+    PMP_TRACE_SCOPE("SurfaceMeshIO::write_pmp");
+    // gather all properties of supported types
+    const PropertyContainer* containers[n_pmp_kinds] = {
+        &mesh.oprops_, &mesh.vprops_, &mesh.hprops_, &mesh.eprops_,
+        &mesh.fprops_};
+    std::vector<PmpSection> sections;
+    std::vector<std::string> names;
+    std::vector<const void*> data;
+    for (uint32_t k = 0; k < n_pmp_kinds; ++k)
+    {
+        for (const auto& name : containers[k]->properties())
+        {
+            PmpTypeMatch match{containers[k]->get_type(name)};
+            uint32_t type = 0;
+            while (type < n_pmp_types && !dispatch_pmp_type(type, match))
+                ++type;
+            if (type == n_pmp_types)
+            {
+                std::cerr << "write_pmp: skipping property " << name
+                          << " of unsupported type" << std::endl;
+                continue;
+            }
 
-    // how many elements?
-    unsigned int nv, ne, nh, nf;
-    nv = mesh.n_vertices();
-    ne = mesh.n_edges();
-    nh = mesh.n_halfedges();
-    nf = mesh.n_faces();
+            PmpPropertyData property{*containers[k], name, nullptr, 0, 0};
+            dispatch_pmp_type(type, property);
+
+            PmpSection section;
+            section.kind = k;
+            section.type = type;
+            section.element_size = property.element_size;
+            section.name_size = name.size();
+            section.data_offset = 0;
+            section.data_size = property.data_size;
+            sections.push_back(section);
+            names.push_back(name);
+            data.push_back(property.data);
+        }
+    }
 
-    // write header
-    tfwrite(out, nv);
-    tfwrite(out, ne);
-    tfwrite(out, nf);
-    tfwrite(out, (bool)htex);
+    // the data follows the section table and the names
+    uint64_t offset = sizeof(PmpHeader) + sections.size() * sizeof(PmpSection);
+    for (const auto& name : names)
+        offset += name.size();
+    for (auto& section : sections)
+    {
+        section.data_offset = pmp_align(offset);
+        offset = section.data_offset + section.data_size;
+    }
 
-    // write properties to file
-    fwrite((char*)vconn.data(), sizeof(SurfaceMesh::VertexConnectivity), nv,
-           out);
-    fwrite((char*)hconn.data(), sizeof(SurfaceMesh::HalfedgeConnectivity), nh,
-           out);
-    fwrite((char*)fconn.data(), sizeof(SurfaceMesh::FaceConnectivity), nf, out);
-    fwrite((char*)point.data(), sizeof(Point), nv, out);
+    PmpHeader header;
+    memcpy(header.tag, pmp_tag, sizeof(pmp_tag));
+    header.version = pmp_version;
+    header.byte_order = pmp_byte_order;
+    header.index_size = sizeof(IndexType);
+    header.n_sections = uint32_t(sections.size());
+    header.n_vertices = mesh.vertices_size();
+    header.n_edges = mesh.edges_size();
+    header.n_faces = mesh.faces_size();
+    header.deleted_vertices = mesh.deleted_vertices_;
+    header.deleted_edges = mesh.deleted_edges_;
+    header.deleted_faces = mesh.deleted_faces_;
+
+    // write to a temporary file first, since the mesh might use the file
+    // we are about to replace as storage
+    const std::string filename = filename_ + ".tmp";
+    FILE* out = fopen(filename.c_str(), "wb");
+    if (!out)
+        return false;
 
-    // texture coordinates
-    if (htex)
-        fwrite((char*)htex.data(), sizeof(TexCoord), nh, out);
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+    if (!sections.empty())
+        ok &= fwrite(sections.data(), sizeof(PmpSection), sections.size(),
+                     out) == sections.size();
+    for (const auto& name : names)
+        ok &= fwrite(name.data(), 1, name.size(), out) == name.size();
+
+    const char padding[pmp_alignment] = {0};
+    offset = sizeof(PmpHeader) + sections.size() * sizeof(PmpSection);
+    for (const auto& name : names)
+        offset += name.size();
+    for (size_t i = 0; i < sections.size(); ++i)
+    {
+        const size_t n = size_t(sections[i].data_offset - offset);
+        ok &= fwrite(padding, 1, n, out) == n;
+        const size_t m = size_t(sections[i].data_size);
+        if (m)
+            ok &= fwrite(data[i], 1, m, out) == m;
+        offset = sections[i].data_offset + m;
+    }
+    ok &= fclose(out) == 0;
 
-    fclose(out);
-    return true;
+    if (ok && std::rename(filename.c_str(), filename_.c_str()) != 0)
+    {
+        // some platforms do not replace existing files
+        std::remove(filename_.c_str());
+        ok = std::rename(filename.c_str(), filename_.c_str()) == 0;
+    }
+    if (!ok)
+        std::remove(filename.c_str());
+    return ok;
 }
 
-// helper class for STL reader
-class CmpVec
+namespace {
+
+// merges vertices of a triangle soup. vertices are hashed by their grid cell
+// (twice the tolerance wide) into an open addressing table, a new vertex is
+// merged with the first vertex within tolerance in its own or a neighboring
+// cell. for zero tolerance only identical positions are merged.
+class VertexWelder
 {
 public:
-    CmpVec(Scalar eps = std::numeric_limits<Scalar>::min()) : eps_(eps) {}
-
-    bool operator()(const vec3& v0, const vec3& v1) const
+    VertexWelder(Scalar tolerance, size_t n_vertices_hint)
+        : tolerance_(tolerance), mask_(0)
     {
-        if (fabs(v0[0] - v1[0]) <= eps_)
+        size_t size = 1024;
+        while (size < n_vertices_hint)
+            size *= 2;
+        resize(size);
+    }
+
+    // index of the vertex at p, p is added if there is no such vertex yet
+    IndexType insert(const Point& p)
+    {
+        int64_t c[3];
+        cell(p, c);
+
+        if (tolerance_ > 0)
         {
-            if (fabs(v0[1] - v1[1]) <= eps_)
+            // cells are twice as large as the tolerance, in each direction
+            // only the neighbor on the closer side has to be checked
+            int64_t side[3];
+            for (int k = 0; k < 3; ++k)
             {
-                return (v0[2] < v1[2] - eps_);
+                const double x = double(p[k]) / (2 * tolerance_);
+                side[k] = x - std::floor(x) < 0.5 ? -1 : 1;
+            }
+
+            for (int n = 0; n < 8; ++n)
+            {
+                const int64_t nc[3] = {c[0] + ((n & 1) ? side[0] : 0),
+                                       c[1] + ((n & 2) ? side[1] : 0),
+                                       c[2] + ((n & 4) ? side[2] : 0)};
+                for (size_t i = hash(nc);; i = (i + 1) & mask_)
+                {
+                    const Entry& e = table_[i];
+                    if (e.vertex == PMP_MAX_INDEX)
+                        break;
+                    if (norm(e.point - p) <= tolerance_)
+                        return e.vertex;
+                }
             }
-            else
-                return (v0[1] < v1[1] - eps_);
         }
-        else
-            return (v0[0] < v1[0] - eps_);
+
+        size_t i = hash(c);
+        for (; table_[i].vertex != PMP_MAX_INDEX; i = (i + 1) & mask_)
+        {
+            if (tolerance_ == 0 && table_[i].point == p)
+                return table_[i].vertex;
+        }
+
+        const IndexType v = IndexType(points_.size());
+        table_[i].point = p;
+        table_[i].vertex = v;
+        points_.push_back(p);
+
+        // keep the table at most half full
+        if (2 * points_.size() > table_.size())
+            resize(2 * table_.size());
+
+        return v;
     }
 
+    // the positions of all vertices
+    std::vector<Point>& points() { return points_; }
+
 private:
-    Scalar eps_;
+    // grid cell of p, the bit pattern of p for zero tolerance
+    void cell(const Point& p, int64_t c[3]) const
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            if (tolerance_ > 0)
+            {
+                c[i] = int64_t(std::floor(double(p[i]) / (2 * tolerance_)));
+            }
+            else
+            {
+                const Scalar x = p[i] + Scalar(0); // -0 becomes 0
+                c[i] = 0;
+                memcpy(&c[i], &x, sizeof(x));
+            }
+        }
+    }
+
+    size_t hash(const int64_t c[3]) const
+    {
+        // combine with the murmur3 finalizer, the low bits of float bit
+        // patterns are often zero
+        uint64_t h = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            h = (h ^ uint64_t(c[i])) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 33;
+        }
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return size_t(h) & mask_;
+    }
+
+    void resize(size_t size)
+    {
+        table_.assign(size, Entry());
+        mask_ = size - 1;
+
+        int64_t c[3];
+        for (size_t v = 0; v < points_.size(); ++v)
+        {
+            cell(points_[v], c);
+            size_t i = hash(c);
+            while (table_[i].vertex != PMP_MAX_INDEX)
+                i = (i + 1) & mask_;
+            table_[i].point = points_[v];
+            table_[i].vertex = IndexType(v);
+        }
+    }
+
+    // positions are stored in the table to avoid cache misses in lookups
+    struct Entry
+    {
+        Point point;
+        IndexType vertex = PMP_MAX_INDEX;
+    };
+
+    Scalar tolerance_;
+    std::vector<Point> points_;
+    std::vector<Entry> table_;
+    size_t mask_;
 };
 
+} // namespace
+
 bool SurfaceMeshIO::read_stl(SurfaceMesh& mesh)
 {
-    char line[100], *c;
-    unsigned int i, nT(0);
-    vec3 p;
-    Vertex v;
-    std::vector<Vertex> vertices(3);
-    size_t n_items(0);
-
-    CmpVec comp(std::numeric_limits<Scalar>::min());
-    std::map<vec3, Vertex, CmpVec> vMap(comp);
-    std::map<vec3, Vertex, CmpVec>::iterator vMapIt;
-
-    // open file (in ASCII mode)
-    FILE* in = fopen(filename_.c_str(), "r");
-    if (!in)
+    PMP_TRACE_SCOPE("SurfaceMeshIO::read_stl");
+    MappedFile file(filename_);
+    if (!file.is_open())
         return false;
 
-    // ASCII or binary STL?
-    c = fgets(line, 6, in);
-    PMP_ASSERT(c != nullptr);
+    // a binary STL has an 80 byte header, the number of triangles, and
+    // 50 bytes per triangle. ASCII files start with "solid", but so do some
+    // binary files.
+    const char* data = file.data();
+    uint32_t n_triangles = 0;
+    if (file.size() >= 84)
+        memcpy(&n_triangles, data + 80, 4);
     const bool binary =
-        ((strncmp(line, "SOLID", 5) != 0) && (strncmp(line, "solid", 5) != 0));
+        (file.size() >= 84 &&
+         file.size() == 84 + 50 * uint64_t(n_triangles)) ||
+        !(file.size() >= 5 && (strncmp(data, "solid", 5) == 0 ||
+                               strncmp(data, "SOLID", 5) == 0));
 
-    // parse binary STL
+    // gather the triangle corners
+    std::vector<Point> corners;
     if (binary)
     {
-        // re-open file in binary mode
-        fclose(in);
-        in = fopen(filename_.c_str(), "rb");
-        if (!in)
+        if (file.size() < 84 + 50 * uint64_t(n_triangles))
             return false;
 
-        // skip dummy header
-        n_items = fread(line, 1, 80, in);
-        PMP_ASSERT(n_items > 0);
-
-        // read number of triangles
-        tfread(in, nT);
-
-        // read triangles
-        while (nT)
+        corners.resize(3 * size_t(n_triangles));
+        for (size_t i = 0; i < n_triangles; ++i)
         {
-            // skip triangle normal
-            n_items = fread(line, 1, 12, in);
-            PMP_ASSERT(n_items > 0);
-            // triangle's vertices
-            for (i = 0; i < 3; ++i)
-            {
-                tfread(in, p);
-
-                // has vector been referenced before?
-                if ((vMapIt = vMap.find(p)) == vMap.end())
-                {
-                    // No : add vertex and remember idx/vector mapping
-                    v = mesh.add_vertex((Point)p);
-                    vertices[i] = v;
-                    vMap[p] = v;
-                }
-                else
-                {
-                    // Yes : get index from map
-                    vertices[i] = vMapIt->second;
-                }
-            }
-
-            // Add face only if it is not degenerated
-            if ((vertices[0] != vertices[1]) && (vertices[0] != vertices[2]) &&
-                (vertices[1] != vertices[2]))
-                mesh.add_face(vertices);
-
-            n_items = fread(line, 1, 2, in);
-            PMP_ASSERT(n_items > 0);
-            --nT;
+            // skip the triangle normal and the attribute byte count
+            float x[9];
+            memcpy(x, data + 84 + 50 * i + 12, sizeof(x));
+            for (int j = 0; j < 3; ++j)
+                corners[3 * i + j] = Point(x[3 * j], x[3 * j + 1], x[3 * j + 2]);
         }
     }
-
-    // parse ASCII STL
     else
     {
-        // parse line by line
-        while (in && !feof(in) && fgets(line, 100, in))
+        // read the positions of all "vertex" lines, three make a triangle
+        Scalar x[3];
+        for (const char* p = data; p != file.end();)
         {
-            // skip white-space
-            for (c = line; isspace(*c) && *c != '\0'; ++c)
+            p = next_record(p, file.end());
+            const char* eol = skip_line(p, file.end());
+            if (eol - p > 6 && (strncmp(p, "vertex", 6) == 0 ||
+                                strncmp(p, "VERTEX", 6) == 0))
             {
-            };
-
-            // face begins
-            if ((strncmp(c, "outer", 5) == 0) || (strncmp(c, "OUTER", 5) == 0))
-            {
-                // read three vertices
-                for (i = 0; i < 3; ++i)
-                {
-                    // read line
-                    c = fgets(line, 100, in);
-                    PMP_ASSERT(c != nullptr);
-
-                    // skip white-space
-                    for (c = line; isspace(*c) && *c != '\0'; ++c)
-                    {
-                    };
-
-                    // read x, y, z
-                    sscanf(c + 6, "%f %f %f", &p[0], &p[1], &p[2]);
-
-                    // has vector been referenced before?
-                    if ((vMapIt = vMap.find(p)) == vMap.end())
-                    {
-                        // No : add vertex and remember idx/vector mapping
-                        v = mesh.add_vertex((Point)p);
-                        vertices[i] = v;
-                        vMap[p] = v;
-                    }
-                    else
-                    {
-                        // Yes : get index from map
-                        vertices[i] = vMapIt->second;
-                    }
-                }
-
-                // Add face only if it is not degenerated
-                if ((vertices[0] != vertices[1]) &&
-                    (vertices[0] != vertices[2]) &&
-                    (vertices[1] != vertices[2]))
-                    mesh.add_face(vertices);
+                if (parse_scalars(p + 6, eol, x, 3) != 3)
+                    return false;
+                corners.emplace_back(x[0], x[1], x[2]);
             }
+            p = eol;
         }
+        corners.resize(corners.size() / 3 * 3);
     }
 
-    fclose(in);
+    // merge vertices, skip degenerate triangles
+    VertexWelder welder(flags_.weld_tolerance, corners.size() / 2);
+    std::vector<IndexType> indices;
+    indices.reserve(corners.size());
+    for (size_t i = 0; i < corners.size(); i += 3)
+    {
+        const IndexType v0 = welder.insert(corners[i]);
+        const IndexType v1 = welder.insert(corners[i + 1]);
+        const IndexType v2 = welder.insert(corners[i + 2]);
+        if (v0 != v1 && v0 != v2 && v1 != v2)
+        {
+            indices.push_back(v0);
+            indices.push_back(v1);
+            indices.push_back(v2);
+        }
+    }
+    corners = std::vector<Point>();
+
+    // add vertices and faces
+    const auto& points = welder.points();
+    mesh.reserve(points.size(), indices.size() / 2, indices.size() / 3);
+    for (const auto& p : points)
+        mesh.add_vertex(p);
+
+    std::vector<IndexType> valences(indices.size() / 3, 3);
+    std::vector<Face> faces;
+    add_faces(mesh, valences, indices, faces);
+
     return true;
 }
 
 bool SurfaceMeshIO::write_stl(const SurfaceMesh& mesh)
 {
+    PMP_TRACE_SCOPE("SurfaceMeshIO::write_stl");
     if (!mesh.is_triangle_mesh())
     {
         std::cerr << "write_stl: not a triangle mesh!" << std::endl;
@@ -1106,6 +2312,7 @@ bool SurfaceMeshIO::write_stl(const SurfaceMesh& mesh)
 
 bool SurfaceMeshIO::write_xyz(const SurfaceMesh& mesh)
 {
+    PMP_TRACE_SCOPE("SurfaceMeshIO::write_xyz");
     std::ofstream ofs(filename_);
     if (!ofs)
         return false;
@@ -1126,4 +2333,1200 @@ bool SurfaceMeshIO::write_xyz(const SurfaceMesh& mesh)
     return true;
 }
 
+namespace {
+
+// scalar types of PLY properties
+enum PlyType
+{
+    PlyInt8,
+    PlyUInt8,
+    PlyInt16,
+    PlyUInt16,
+    PlyInt32,
+    PlyUInt32,
+    PlyFloat32,
+    PlyFloat64,
+    PlyInvalid
+};
+
+const char* const ply_type_names[] = {"char",  "uchar", "short", "ushort",
+                                      "int",   "uint",  "float", "double"};
+
+// size of the values of type in binary files
+const size_t ply_type_sizes[] = {1, 1, 2, 2, 4, 4, 4, 8};
+
+// type with name, including the alternative names of PLY 1.0
+PlyType ply_type(const std::string& name)
+{
+    static const char* const alternatives[] = {
+        "int8", "uint8", "int16", "uint16", "int32", "uint32", "float32",
+        "float64"};
+    for (int i = 0; i < PlyInvalid; ++i)
+        if (name == ply_type_names[i] || name == alternatives[i])
+            return PlyType(i);
+    return PlyInvalid;
+}
+
+// PLY type of Scalar
+const PlyType ply_scalar_type =
+    sizeof(Scalar) == sizeof(float) ? PlyFloat32 : PlyFloat64;
+
+// prefix of the properties holding the generic columns of a PLY file, such
+// that they cannot collide with the properties of the mesh itself
+const std::string ply_prefix = "ply:";
+
+struct PlyProperty
+{
+    std::string name;
+    PlyType type;
+    PlyType count_type; // type of the size of lists, PlyInvalid for scalars
+};
+
+struct PlyElement
+{
+    std::string name;
+    size_t count;
+    std::vector<PlyProperty> properties;
+
+    // index of the property called name, -1 if there is none
+    int find(const std::string& property) const
+    {
+        for (size_t i = 0; i < properties.size(); ++i)
+            if (properties[i].name == property)
+                return int(i);
+        return -1;
+    }
+
+    // size of the records in binary files, 0 if they contain lists
+    size_t record_size() const
+    {
+        size_t size = 0;
+        for (const auto& property : properties)
+        {
+            if (property.count_type != PlyInvalid)
+                return 0;
+            size += ply_type_sizes[property.type];
+        }
+        return size;
+    }
+};
+
+struct PlyHeader
+{
+    enum Format
+    {
+        Ascii,
+        BinaryLittleEndian,
+        BinaryBigEndian
+    } format;
+    std::vector<PlyElement> elements;
+};
+
+bool is_little_endian()
+{
+    const uint16_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+// parse the header at p, returns the position of the data behind it or
+// nullptr
+const char* parse_ply_header(const char* p, const char* end, PlyHeader& header)
+{
+    bool has_format = false;
+    for (int line = 0; p != end; ++line)
+    {
+        const char* eol = skip_line(p, end);
+        std::istringstream tokens(std::string(p, eol));
+        p = eol;
+
+        std::string keyword;
+        tokens >> keyword;
+        if (line == 0)
+        {
+            if (keyword != "ply")
+                return nullptr;
+        }
+        else if (keyword == "format")
+        {
+            std::string format;
+            tokens >> format;
+            if (format == "ascii")
+                header.format = PlyHeader::Ascii;
+            else if (format == "binary_little_endian")
+                header.format = PlyHeader::BinaryLittleEndian;
+            else if (format == "binary_big_endian")
+                header.format = PlyHeader::BinaryBigEndian;
+            else
+                return nullptr;
+            has_format = true;
+        }
+        else if (keyword == "element")
+        {
+            PlyElement element;
+            if (!(tokens >> element.name >> element.count))
+                return nullptr;
+            header.elements.push_back(element);
+        }
+        else if (keyword == "property")
+        {
+            if (header.elements.empty())
+                return nullptr;
+            PlyProperty property;
+            std::string type;
+            tokens >> type;
+            if (type == "list")
+            {
+                std::string count_type;
+                tokens >> count_type >> type;
+                property.count_type = ply_type(count_type);
+                if (property.count_type == PlyInvalid ||
+                    property.count_type >= PlyFloat32)
+                    return nullptr;
+            }
+            else
+                property.count_type = PlyInvalid;
+            property.type = ply_type(type);
+            if (property.type == PlyInvalid || !(tokens >> property.name))
+                return nullptr;
+            header.elements.back().properties.push_back(property);
+        }
+        else if (keyword == "end_header")
+        {
+            return has_format ? p : nullptr;
+        }
+        else if (keyword != "comment" && keyword != "obj_info" &&
+                 !keyword.empty())
+        {
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+// value of type T at p in a binary file, the bytes are reversed if the file
+// does not have the byte order of the machine
+template <class T>
+inline T ply_load(const char* p, bool swap)
+{
+    T value;
+    if (swap)
+    {
+        char bytes[sizeof(T)];
+        for (size_t i = 0; i < sizeof(T); ++i)
+            bytes[i] = p[sizeof(T) - 1 - i];
+        memcpy(&value, bytes, sizeof(T));
+    }
+    else
+        memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+double ply_load(const char* p, PlyType type, bool swap)
+{
+    switch (type)
+    {
+        case PlyInt8:
+            return ply_load<int8_t>(p, swap);
+        case PlyUInt8:
+            return ply_load<uint8_t>(p, swap);
+        case PlyInt16:
+            return ply_load<int16_t>(p, swap);
+        case PlyUInt16:
+            return ply_load<uint16_t>(p, swap);
+        case PlyInt32:
+            return ply_load<int32_t>(p, swap);
+        case PlyUInt32:
+            return ply_load<uint32_t>(p, swap);
+        case PlyFloat32:
+            return ply_load<float>(p, swap);
+        default:
+            return ply_load<double>(p, swap);
+    }
+}
+
+// value converted to T, integers are rounded and clamped to their range
+template <class T>
+inline T ply_cast(double value)
+{
+    if (std::numeric_limits<T>::is_integer)
+    {
+        value = std::round(value);
+        value = std::max(value, double(std::numeric_limits<T>::lowest()));
+        value = std::min(value, double(std::numeric_limits<T>::max()));
+    }
+    return T(value);
+}
+
+// store value as type at p in the byte order of the machine, returns the
+// position behind it
+char* ply_store(char* p, PlyType type, double value)
+{
+    switch (type)
+    {
+        case PlyInt8:
+            *p = char(ply_cast<int8_t>(value));
+            return p + 1;
+        case PlyUInt8:
+            *p = char(ply_cast<uint8_t>(value));
+            return p + 1;
+        case PlyInt16:
+        {
+            const int16_t v = ply_cast<int16_t>(value);
+            memcpy(p, &v, 2);
+            return p + 2;
+        }
+        case PlyUInt16:
+        {
+            const uint16_t v = ply_cast<uint16_t>(value);
+            memcpy(p, &v, 2);
+            return p + 2;
+        }
+        case PlyInt32:
+        {
+            const int32_t v = ply_cast<int32_t>(value);
+            memcpy(p, &v, 4);
+            return p + 4;
+        }
+        case PlyUInt32:
+        {
+            const uint32_t v = ply_cast<uint32_t>(value);
+            memcpy(p, &v, 4);
+            return p + 4;
+        }
+        case PlyFloat32:
+        {
+            const float v = float(value);
+            memcpy(p, &v, 4);
+            return p + 4;
+        }
+        default:
+            memcpy(p, &value, 8);
+            return p + 8;
+    }
+}
+
+// write value as type in ASCII, returns the position behind it
+char* ply_format(char* p, PlyType type, double value)
+{
+    switch (type)
+    {
+        case PlyFloat32:
+            return format_scalar(p, float(value));
+        case PlyFloat64:
+            return format_scalar(p, value);
+        case PlyInt8:
+            return format_int(p, ply_cast<int8_t>(value));
+        case PlyUInt8:
+            return format_int(p, ply_cast<uint8_t>(value));
+        case PlyInt16:
+            return format_int(p, ply_cast<int16_t>(value));
+        case PlyUInt16:
+            return format_int(p, ply_cast<uint16_t>(value));
+        case PlyInt32:
+            return format_int(p, ply_cast<int32_t>(value));
+        default:
+            return format_int(p, ply_cast<uint32_t>(value));
+    }
+}
+
+// reads the values of the records of an element one by one, from a binary
+// file or from an ASCII file
+class PlyReader
+{
+public:
+    PlyReader(const char* p, const char* end, PlyHeader::Format format)
+        : p_(p),
+          end_(end),
+          ascii_(format == PlyHeader::Ascii),
+          swap_(format != PlyHeader::Ascii &&
+                (format == PlyHeader::BinaryLittleEndian) !=
+                    is_little_endian())
+    {
+    }
+
+    const char* position() const { return p_; }
+    void set_position(const char* p) { p_ = p; }
+
+    bool is_ascii() const { return ascii_; }
+    bool swap() const { return swap_; }
+
+    // read the next value, which has the given type
+    bool read(PlyType type, double& value)
+    {
+        if (ascii_)
+        {
+            while (p_ != end_ && (is_blank(*p_) || *p_ == '\r' || *p_ == '\n'))
+                ++p_;
+            const char* q;
+            if (type < PlyFloat32)
+            {
+                long v;
+                q = parse_int(p_, end_, v);
+                value = double(v);
+            }
+            else
+            {
+                Scalar v;
+                q = parse_scalar(p_, end_, v);
+                value = double(v);
+            }
+            if (!q)
+                return false;
+            p_ = q;
+            return true;
+        }
+
+        const size_t size = ply_type_sizes[type];
+        if (size_t(end_ - p_) < size)
+            return false;
+        value = ply_load(p_, type, swap_);
+        p_ += size;
+        return true;
+    }
+
+    // skip a record of element
+    bool skip(const PlyElement& element)
+    {
+        double value;
+        for (const auto& property : element.properties)
+        {
+            size_t n = 1;
+            if (property.count_type != PlyInvalid)
+            {
+                if (!read(property.count_type, value) || value < 0)
+                    return false;
+                n = size_t(value);
+            }
+            for (size_t i = 0; i < n; ++i)
+                if (!read(property.type, value))
+                    return false;
+        }
+        return true;
+    }
+
+private:
+    const char* p_;
+    const char* end_;
+    bool ascii_;
+    bool swap_;
+};
+
+// where the values of a scalar PLY property go, the value of element i is
+// stored at scalars[i * stride] or at integers[i * stride]
+struct PlyTarget
+{
+    PlyTarget() : scalars(nullptr), integers(nullptr), stride(1), scale(1) {}
+
+    void set(size_t i, double value) const
+    {
+        if (scalars)
+            scalars[i * stride] = Scalar(value * scale);
+        else if (integers)
+            integers[i * stride] = int(value);
+    }
+
+    Scalar* scalars;
+    int* integers;
+    size_t stride;
+    double scale;
+};
+
+// targets of the scalar PLY properties of an element, which receive the
+// values of a group of properties such as x, y, z
+void set_ply_targets(const PlyElement& element,
+                     const std::vector<std::string>& names, Scalar* values,
+                     std::vector<PlyTarget>& targets)
+{
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        const int j = element.find(names[i]);
+        targets[j].scalars = values + i;
+        targets[j].stride = names.size();
+        // colors stored as integers range from 0 to 255
+        if (element.properties[j].type < PlyFloat32 &&
+            (names[i] == "red" || names[i] == "green" || names[i] == "blue"))
+            targets[j].scale = 1.0 / 255.0;
+    }
+}
+
+// does element have all the scalar properties in names?
+bool has_ply_properties(const PlyElement& element,
+                        const std::vector<std::string>& names)
+{
+    for (const auto& name : names)
+    {
+        const int j = element.find(name);
+        if (j < 0 || element.properties[j].count_type != PlyInvalid)
+            return false;
+    }
+    return true;
+}
+
+// read the values of property j of all records of a binary element with
+// records of fixed size
+template <class T>
+void read_ply_column(const char* data, const PlyElement& element,
+                     size_t offset, size_t record_size, bool swap,
+                     const PlyTarget& target)
+{
+    const long n = long(element.count);
+#pragma omp parallel for
+    for (long i = 0; i < n; ++i)
+        target.set(i, double(ply_load<T>(data + i * record_size + offset,
+                                         swap)));
+}
+
+void read_ply_column(const char* data, const PlyElement& element,
+                     size_t offset, size_t record_size, bool swap,
+                     PlyType type, const PlyTarget& target)
+{
+    switch (type)
+    {
+        case PlyInt8:
+            return read_ply_column<int8_t>(data, element, offset, record_size,
+                                           swap, target);
+        case PlyUInt8:
+            return read_ply_column<uint8_t>(data, element, offset,
+                                            record_size, swap, target);
+        case PlyInt16:
+            return read_ply_column<int16_t>(data, element, offset,
+                                            record_size, swap, target);
+        case PlyUInt16:
+            return read_ply_column<uint16_t>(data, element, offset,
+                                             record_size, swap, target);
+        case PlyInt32:
+            return read_ply_column<int32_t>(data, element, offset,
+                                            record_size, swap, target);
+        case PlyUInt32:
+            return read_ply_column<uint32_t>(data, element, offset,
+                                             record_size, swap, target);
+        case PlyFloat32:
+            return read_ply_column<float>(data, element, offset, record_size,
+                                          swap, target);
+        default:
+            return read_ply_column<double>(data, element, offset, record_size,
+                                           swap, target);
+    }
+}
+
+// read the scalar properties of all records of element to targets
+bool read_ply_scalars(PlyReader& reader, const char* end,
+                      const PlyElement& element,
+                      const std::vector<PlyTarget>& targets)
+{
+    // binary records of fixed size are read column by column
+    const size_t record_size = element.record_size();
+    if (!reader.is_ascii() && record_size)
+    {
+        const char* data = reader.position();
+        if (size_t(end - data) / record_size < element.count)
+            return false;
+
+        size_t offset = 0;
+        for (size_t j = 0; j < targets.size(); ++j)
+        {
+            const PlyType type = element.properties[j].type;
+            if (targets[j].scalars || targets[j].integers)
+                read_ply_column(data, element, offset, record_size,
+                                reader.swap(), type, targets[j]);
+            offset += ply_type_sizes[type];
+        }
+        reader.set_position(data + element.count * record_size);
+        return true;
+    }
+
+    double value;
+    for (size_t i = 0; i < element.count; ++i)
+    {
+        for (size_t j = 0; j < targets.size(); ++j)
+        {
+            const PlyProperty& property = element.properties[j];
+            if (property.count_type != PlyInvalid)
+            {
+                // lists are skipped
+                size_t n;
+                if (!reader.read(property.count_type, value) || value < 0)
+                    return false;
+                n = size_t(value);
+                for (size_t k = 0; k < n; ++k)
+                    if (!reader.read(property.type, value))
+                        return false;
+            }
+            else
+            {
+                if (!reader.read(property.type, value))
+                    return false;
+                targets[j].set(i, value);
+            }
+        }
+    }
+    return true;
+}
+
+// the faces of a PLY file as read, before they are added to the mesh
+struct PlyFaces
+{
+    std::vector<IndexType> valences, indices;
+    std::vector<TexCoord> texcoords; // per corner, if the file has them
+};
+
+// read the faces of a binary file in which all faces have the same valence
+// and no lists other than the vertex indices, returns false without reading
+// anything if the faces do not qualify
+bool read_ply_fixed_faces(PlyReader& reader, const char* end,
+                          const PlyElement& element, int indices,
+                          const std::vector<PlyTarget>& targets,
+                          PlyFaces& faces)
+{
+    const std::vector<PlyProperty>& properties = element.properties;
+    if (reader.is_ascii() || element.count == 0)
+        return false;
+    for (size_t j = 0; j < properties.size(); ++j)
+        if (int(j) != indices && properties[j].count_type != PlyInvalid)
+            return false;
+
+    // the size of the list is at the same position in all records
+    size_t list_offset = 0;
+    for (int j = 0; j < indices; ++j)
+        list_offset += ply_type_sizes[properties[j].type];
+    const PlyType count_type = properties[indices].count_type;
+    const PlyType index_type = properties[indices].type;
+    const size_t count_size = ply_type_sizes[count_type];
+    const size_t index_size = ply_type_sizes[index_type];
+
+    const char* data = reader.position();
+    if (size_t(end - data) < list_offset + count_size)
+        return false;
+    const double first = ply_load(data + list_offset, count_type, reader.swap());
+    if (first < 3)
+        return false;
+    const size_t valence = size_t(first);
+
+    size_t record_size = valence * index_size;
+    for (const auto& property : properties)
+        record_size += ply_type_sizes[property.count_type != PlyInvalid
+                                          ? property.count_type
+                                          : property.type];
+    if (size_t(end - data) / record_size < element.count)
+        return false;
+
+    // check that all faces have the same valence
+    const long n = long(element.count);
+    bool fixed = true;
+#pragma omp parallel for reduction(&& : fixed)
+    for (long i = 0; i < n; ++i)
+        fixed = fixed && ply_load(data + i * record_size + list_offset,
+                                  count_type, reader.swap()) == first;
+    if (!fixed)
+        return false;
+
+    faces.valences.assign(element.count, IndexType(valence));
+    faces.indices.resize(element.count * valence);
+    const size_t index_offset = list_offset + count_size;
+#pragma omp parallel for
+    for (long i = 0; i < n; ++i)
+    {
+        const char* record = data + i * record_size;
+        for (size_t k = 0; k < valence; ++k)
+            faces.indices[i * valence + k] = IndexType(ply_load(
+                record + index_offset + k * index_size, index_type,
+                reader.swap()));
+    }
+
+    size_t offset = 0;
+    for (size_t j = 0; j < properties.size(); ++j)
+    {
+        if (int(j) == indices)
+        {
+            offset += count_size + valence * index_size;
+            continue;
+        }
+        if (targets[j].scalars || targets[j].integers)
+            read_ply_column(data, element, offset, record_size, reader.swap(),
+                            properties[j].type, targets[j]);
+        offset += ply_type_sizes[properties[j].type];
+    }
+
+    reader.set_position(data + element.count * record_size);
+    return true;
+}
+
+bool read_ply_faces(PlyReader& reader, const char* end,
+                    const PlyElement& element,
+                    const std::vector<PlyTarget>& targets, PlyFaces& faces)
+{
+    int indices = element.find("vertex_indices");
+    if (indices < 0)
+        indices = element.find("vertex_index");
+    if (indices < 0 || element.properties[indices].count_type == PlyInvalid)
+        return false;
+    const int texcoords = element.find("texcoord");
+
+    if (read_ply_fixed_faces(reader, end, element, indices, targets, faces))
+        return true;
+
+    faces.valences.resize(element.count);
+    faces.indices.reserve(3 * element.count);
+    double value;
+    for (size_t i = 0; i < element.count; ++i)
+    {
+        for (size_t j = 0; j < targets.size(); ++j)
+        {
+            const PlyProperty& property = element.properties[j];
+            if (property.count_type == PlyInvalid)
+            {
+                if (!reader.read(property.type, value))
+                    return false;
+                targets[j].set(i, value);
+                continue;
+            }
+
+            if (!reader.read(property.count_type, value) || value < 0)
+                return false;
+            const size_t n = size_t(value);
+            if (int(j) == indices)
+                faces.valences[i] = IndexType(n);
+            for (size_t k = 0; k < n; ++k)
+            {
+                if (!reader.read(property.type, value))
+                    return false;
+                if (int(j) == indices)
+                    faces.indices.push_back(IndexType(value));
+                else if (int(j) == texcoords && k % 2 == 0)
+                    faces.texcoords.emplace_back(Scalar(value), 0);
+                else if (int(j) == texcoords)
+                    faces.texcoords.back()[1] = Scalar(value);
+            }
+        }
+    }
+    return true;
+}
+
+// a column of a PLY element written from a property of the mesh, the value
+// of element i is at data + i * stride, scaled by scale
+struct PlyColumn
+{
+    std::string name;
+    PlyType type;   // type in the file
+    PlyType source; // type of the values at data
+    const char* data;
+    size_t stride;
+    double scale;
+};
+
+// columns for the n components of a property of type Vector<Scalar, n>
+template <int n>
+void add_ply_columns(std::vector<PlyColumn>& columns,
+                     const Vector<Scalar, n>* values,
+                     const std::vector<std::string>& names, PlyType type,
+                     double scale = 1)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        PlyColumn column;
+        column.name = names[i];
+        column.type = type;
+        column.source = ply_scalar_type;
+        column.data = reinterpret_cast<const char*>(
+            reinterpret_cast<const Scalar*>(values) + i);
+        column.stride = sizeof(Vector<Scalar, n>);
+        column.scale = scale;
+        columns.push_back(column);
+    }
+}
+
+// property of type T of vertices or faces
+template <class T>
+VertexProperty<T> get_mesh_property(const SurfaceMesh& mesh,
+                                    const std::string& name, Vertex)
+{
+    return mesh.get_vertex_property<T>(name);
+}
+
+template <class T>
+FaceProperty<T> get_mesh_property(const SurfaceMesh& mesh,
+                                  const std::string& name, Face)
+{
+    return mesh.get_face_property<T>(name);
+}
+
+// columns for the scalar properties of a mesh element that are not written
+// otherwise, their names are given without prefix such as "v:"
+template <class Handle>
+void add_ply_scalar_columns(const SurfaceMesh& mesh,
+                            const std::vector<std::string>& names,
+                            const std::vector<std::string>& skip,
+                            std::vector<PlyColumn>& columns)
+{
+    for (const auto& name : names)
+    {
+        if (std::find(skip.begin(), skip.end(), name) != skip.end())
+            continue;
+
+        PlyColumn column;
+        column.name = name.size() > 2 && name[1] == ':' ? name.substr(2) : name;
+        if (column.name.compare(0, ply_prefix.size(), ply_prefix) == 0)
+            column.name = column.name.substr(ply_prefix.size());
+        column.stride = 0;
+        column.scale = 1;
+        if (auto p = get_mesh_property<float>(mesh, name, Handle()))
+        {
+            column.source = PlyFloat32;
+            column.data = reinterpret_cast<const char*>(p.data());
+            column.stride = sizeof(float);
+        }
+        else if (auto p = get_mesh_property<double>(mesh, name, Handle()))
+        {
+            column.source = PlyFloat64;
+            column.data = reinterpret_cast<const char*>(p.data());
+            column.stride = sizeof(double);
+        }
+        else if (auto p = get_mesh_property<int>(mesh, name, Handle()))
+        {
+            column.source = PlyInt32;
+            column.data = reinterpret_cast<const char*>(p.data());
+            column.stride = sizeof(int);
+        }
+        else if (auto p =
+                     get_mesh_property<unsigned int>(mesh, name, Handle()))
+        {
+            column.source = PlyUInt32;
+            column.data = reinterpret_cast<const char*>(p.data());
+            column.stride = sizeof(unsigned int);
+        }
+        if (column.stride)
+        {
+            column.type = column.source;
+            columns.push_back(column);
+        }
+    }
+}
+
+// write a column of element i
+inline char* write_ply_column(char* p, const PlyColumn& column, size_t i,
+                              bool binary)
+{
+    const double value =
+        ply_load(column.data + i * column.stride, column.source, false) *
+        column.scale;
+    return binary ? ply_store(p, column.type, value)
+                  : ply_format(p, column.type, value);
+}
+
+void write_ply_header(FILE* out, const std::vector<PlyColumn>& columns)
+{
+    for (const auto& column : columns)
+        fprintf(out, "property %s %s\n", ply_type_names[column.type],
+                column.name.c_str());
+}
+
+} // namespace
+
+bool SurfaceMeshIO::read_ply(SurfaceMesh& mesh)
+{
+    PMP_TRACE_SCOPE("SurfaceMeshIO::read_ply");
+    MappedFile file(filename_);
+    if (!file.is_open())
+        return false;
+    const char* end = file.end();
+
+    PlyHeader header;
+    const char* data = parse_ply_header(file.data(), end, header);
+    if (!data)
+        return false;
+
+    const PlyElement* vertex_element = nullptr;
+    const PlyElement* face_element = nullptr;
+    for (const auto& element : header.elements)
+    {
+        if (element.name == "vertex" && !vertex_element)
+            vertex_element = &element;
+        else if (element.name == "face" && !face_element)
+            face_element = &element;
+    }
+    if (!vertex_element || !has_ply_properties(*vertex_element, {"x", "y", "z"}))
+        return false;
+
+    // add the vertices first, their properties are read in place
+    const size_t nv = vertex_element->count;
+    const size_t nf = face_element ? face_element->count : 0;
+    mesh.reserve(nv, 2 * nf, nf);
+    for (size_t i = 0; i < nv; ++i)
+        mesh.add_vertex(Point(0, 0, 0));
+
+    std::vector<PlyTarget> vtargets(vertex_element->properties.size());
+    std::vector<std::string> used;
+    const std::vector<std::vector<std::string>> texcoord_names = {
+        {"s", "t"}, {"u", "v"}, {"texture_u", "texture_v"},
+        {"texture_s", "texture_t"}};
+    const std::vector<std::string> color_names = {"red", "green", "blue"};
+    const std::vector<std::string> normal_names = {"nx", "ny", "nz"};
+
+    set_ply_targets(*vertex_element, {"x", "y", "z"},
+                    reinterpret_cast<Scalar*>(mesh.positions().data()),
+                    vtargets);
+    used = {"x", "y", "z"};
+    if (has_ply_properties(*vertex_element, normal_names))
+    {
+        auto normals = mesh.vertex_property<Normal>("v:normal");
+        set_ply_targets(*vertex_element, normal_names,
+                        reinterpret_cast<Scalar*>(normals.vector().data()),
+                        vtargets);
+        used.insert(used.end(), normal_names.begin(), normal_names.end());
+    }
+    if (has_ply_properties(*vertex_element, color_names))
+    {
+        auto colors = mesh.vertex_property<Color>("v:color");
+        set_ply_targets(*vertex_element, color_names,
+                        reinterpret_cast<Scalar*>(colors.vector().data()),
+                        vtargets);
+        used.insert(used.end(), color_names.begin(), color_names.end());
+        used.push_back("alpha");
+    }
+    for (const auto& names : texcoord_names)
+    {
+        if (has_ply_properties(*vertex_element, names))
+        {
+            auto texcoords = mesh.vertex_property<TexCoord>("v:tex");
+            set_ply_targets(*vertex_element, names,
+                            reinterpret_cast<Scalar*>(texcoords.vector().data()),
+                            vtargets);
+            used.insert(used.end(), names.begin(), names.end());
+            break;
+        }
+    }
+
+    // all other scalars become vertex properties of their own. columns
+    // whose name was taken already (by a previous column) are skipped.
+    for (size_t j = 0; j < vtargets.size(); ++j)
+    {
+        const PlyProperty& property = vertex_element->properties[j];
+        const std::string name = "v:" + ply_prefix + property.name;
+        if (property.count_type != PlyInvalid ||
+            std::find(used.begin(), used.end(), property.name) != used.end() ||
+            mesh.has_vertex_property(name))
+            continue;
+        if (property.type < PlyFloat32)
+        {
+            auto values = mesh.add_vertex_property<int>(name);
+            if (!values)
+                return false;
+            vtargets[j].integers = values.vector().data();
+        }
+        else
+        {
+            auto values = mesh.add_vertex_property<Scalar>(name);
+            if (!values)
+                return false;
+            vtargets[j].scalars = values.vector().data();
+        }
+    }
+
+    // face properties are stored per face of the file until the faces are
+    // added to the mesh
+    std::vector<PlyTarget> ftargets;
+    std::vector<Color> fcolors;
+    std::vector<std::vector<Scalar>> fscalars;
+    std::vector<std::vector<int>> fintegers;
+    std::vector<std::string> fscalar_names, finteger_names;
+    if (face_element)
+    {
+        ftargets.resize(face_element->properties.size());
+        if (has_ply_properties(*face_element, color_names))
+        {
+            fcolors.resize(nf);
+            set_ply_targets(*face_element, color_names,
+                            reinterpret_cast<Scalar*>(fcolors.data()), ftargets);
+        }
+
+        // reserve first, the targets point into the vectors
+        fscalars.reserve(ftargets.size());
+        fintegers.reserve(ftargets.size());
+        for (size_t j = 0; j < ftargets.size(); ++j)
+        {
+            const PlyProperty& property = face_element->properties[j];
+            const std::string name = "f:" + ply_prefix + property.name;
+            if (property.count_type != PlyInvalid ||
+                (!fcolors.empty() &&
+                 (std::find(color_names.begin(), color_names.end(),
+                            property.name) != color_names.end() ||
+                  property.name == "alpha")) ||
+                std::find(fscalar_names.begin(), fscalar_names.end(), name) !=
+                    fscalar_names.end() ||
+                std::find(finteger_names.begin(), finteger_names.end(),
+                          name) != finteger_names.end())
+                continue;
+            if (property.type < PlyFloat32)
+            {
+                fintegers.emplace_back(nf);
+                finteger_names.push_back(name);
+                ftargets[j].integers = fintegers.back().data();
+            }
+            else
+            {
+                fscalars.emplace_back(nf);
+                fscalar_names.push_back(name);
+                ftargets[j].scalars = fscalars.back().data();
+            }
+        }
+    }
+
+    // read the elements in the order of the file
+    PlyReader reader(data, end, header.format);
+    PlyFaces faces;
+    for (const auto& element : header.elements)
+    {
+        bool ok = true;
+        if (&element == vertex_element)
+            ok = read_ply_scalars(reader, end, element, vtargets);
+        else if (&element == face_element)
+            ok = read_ply_faces(reader, end, element, ftargets, faces);
+        else if (!reader.is_ascii() && element.record_size())
+        {
+            if (size_t(end - reader.position()) / element.record_size() <
+                element.count)
+                return false;
+            reader.set_position(reader.position() +
+                                element.count * element.record_size());
+        }
+        else
+        {
+            for (size_t i = 0; ok && i < element.count; ++i)
+                ok = reader.skip(element);
+        }
+        if (!ok)
+            return false;
+    }
+
+    // faces with less than three corners are skipped
+    std::vector<IndexType>& valences = faces.valences;
+    std::vector<IndexType>& indices = faces.indices;
+    std::vector<size_t> file_faces(valences.size());
+    size_t c = 0, cc = 0, ff = 0;
+    for (size_t i = 0; i < valences.size(); ++i)
+    {
+        const IndexType valence = valences[i];
+        for (size_t k = 0; k < valence; ++k)
+            if (indices[c + k] >= nv)
+                return false;
+        if (valence > 2)
+        {
+            std::copy(indices.begin() + c, indices.begin() + c + valence,
+                      indices.begin() + cc);
+            if (!faces.texcoords.empty())
+                std::copy(faces.texcoords.begin() + c,
+                          faces.texcoords.begin() + c + valence,
+                          faces.texcoords.begin() + cc);
+            valences[ff] = valence;
+            file_faces[ff++] = i;
+            cc += valence;
+        }
+        c += valence;
+    }
+    valences.resize(ff);
+    indices.resize(cc);
+    if (faces.texcoords.size() != c)
+        faces.texcoords.clear();
+
+    std::vector<Face> mesh_faces;
+    add_faces(mesh, valences, indices, mesh_faces);
+
+    // face properties, and texture coordinates per halfedge
+    auto fcolor = fcolors.empty() ? FaceProperty<Color>()
+                                  : mesh.face_property<Color>("f:color");
+    std::vector<FaceProperty<Scalar>> fscalar;
+    for (const auto& name : fscalar_names)
+    {
+        fscalar.push_back(mesh.add_face_property<Scalar>(name));
+        if (!fscalar.back())
+            return false;
+    }
+    std::vector<FaceProperty<int>> finteger;
+    for (const auto& name : finteger_names)
+    {
+        finteger.push_back(mesh.add_face_property<int>(name));
+        if (!finteger.back())
+            return false;
+    }
+    auto htex = faces.texcoords.empty()
+                    ? HalfedgeProperty<TexCoord>()
+                    : mesh.halfedge_property<TexCoord>("h:tex");
+
+    c = 0;
+    for (size_t i = 0; i < mesh_faces.size(); ++i)
+    {
+        const Face f = mesh_faces[i];
+        if (f.is_valid())
+        {
+            const size_t file_face = file_faces[i];
+            if (fcolor)
+                fcolor[f] = fcolors[file_face];
+            for (size_t k = 0; k < fscalar.size(); ++k)
+                fscalar[k][f] = fscalars[k][file_face];
+            for (size_t k = 0; k < finteger.size(); ++k)
+                finteger[k][f] = fintegers[k][file_face];
+
+            // corner k is the target of the k-th halfedge of f
+            if (htex)
+            {
+                Halfedge h = mesh.halfedge(f);
+                for (IndexType k = 0; k < valences[i]; ++k)
+                {
+                    htex[h] = faces.texcoords[c + k];
+                    h = mesh.next_halfedge(h);
+                }
+            }
+        }
+        c += valences[i];
+    }
+
+    return true;
+}
+
+bool SurfaceMeshIO::write_ply(const SurfaceMesh& mesh)
+{
+    PMP_TRACE_SCOPE("SurfaceMeshIO::write_ply");
+    // indices are written as they are, deleted elements have to go first
+    if (mesh.has_garbage())
+    {
+        SurfaceMesh compact(mesh);
+        compact.garbage_collection();
+        return write_ply(compact);
+    }
+
+    FILE* out = fopen(filename_.c_str(), "wb");
+    if (!out)
+        return false;
+
+    const bool binary = flags_.use_binary;
+    const PlyType scalar_type = ply_scalar_type;
+
+    // vertex properties
+    std::vector<PlyColumn> vcolumns;
+    std::vector<std::string> skip = {"v:point", "v:normal", "v:color",
+                                     "v:tex"};
+    add_ply_columns(vcolumns, mesh.positions().data(), {"x", "y", "z"},
+                    scalar_type);
+    auto normals = mesh.get_vertex_property<Normal>("v:normal");
+    if (normals && flags_.use_vertex_normals)
+        add_ply_columns(vcolumns, normals.data(), {"nx", "ny", "nz"},
+                        scalar_type);
+    auto colors = mesh.get_vertex_property<Color>("v:color");
+    if (colors && flags_.use_vertex_colors)
+        add_ply_columns(vcolumns, colors.data(), {"red", "green", "blue"},
+                        PlyUInt8, 255);
+    auto texcoords = mesh.get_vertex_property<TexCoord>("v:tex");
+    if (texcoords && flags_.use_vertex_texcoords)
+        add_ply_columns(vcolumns, texcoords.data(), {"texture_u", "texture_v"},
+                        scalar_type);
+    add_ply_scalar_columns<Vertex>(mesh, mesh.vertex_properties(), skip,
+                                   vcolumns);
+
+    // face properties, the vertex indices come first
+    std::vector<PlyColumn> fcolumns;
+    auto fcolors = mesh.get_face_property<Color>("f:color");
+    if (fcolors)
+        add_ply_columns(fcolumns, fcolors.data(), {"red", "green", "blue"},
+                        PlyUInt8, 255);
+    add_ply_scalar_columns<Face>(mesh, mesh.face_properties(), {"f:color"},
+                                 fcolumns);
+    auto htex = mesh.get_halfedge_property<TexCoord>("h:tex");
+
+    size_t max_valence = 0;
+    for (auto f : mesh.faces())
+        max_valence = std::max(max_valence, size_t(mesh.valence(f)));
+    const PlyType count_type =
+        2 * max_valence <= std::numeric_limits<uint8_t>::max() ? PlyUInt8
+                                                               : PlyUInt32;
+
+    // header
+    fprintf(out, "ply\nformat %s 1.0\n",
+            !binary ? "ascii"
+                    : is_little_endian() ? "binary_little_endian"
+                                         : "binary_big_endian");
+    fprintf(out, "comment PLY export from SurfaceMesh\n");
+    fprintf(out, "element vertex %zu\n", mesh.n_vertices());
+    write_ply_header(out, vcolumns);
+    fprintf(out, "element face %zu\n", mesh.n_faces());
+    fprintf(out, "property list %s int vertex_indices\n",
+            ply_type_names[count_type]);
+    if (htex)
+        fprintf(out, "property list %s %s texcoord\n",
+                ply_type_names[count_type], ply_type_names[scalar_type]);
+    write_ply_header(out, fcolumns);
+    fprintf(out, "end_header\n");
+
+    const size_t nv = mesh.vertices_size();
+    const size_t nf = mesh.faces_size();
+    WriteProgress progress(progress_, nv + nf);
+    const char separator = binary ? '\0' : ' ';
+
+    bool ok = write_lines(
+        out, nv,
+        [&](size_t i, TextBuffer& buffer) {
+            char* p = buffer.reserve(vcolumns.size() * (max_number_length + 1) +
+                                     1);
+            for (size_t j = 0; j < vcolumns.size(); ++j)
+            {
+                if (j && !binary)
+                    *p++ = separator;
+                p = write_ply_column(p, vcolumns[j], i, binary);
+            }
+            if (!binary)
+                *p++ = '\n';
+            buffer.commit(p);
+        },
+        progress);
+
+    ok = ok && write_lines(
+                   out, nf,
+                   [&](size_t i, TextBuffer& buffer) {
+                       const Face f = Face(IndexType(i));
+                       const size_t valence = mesh.valence(f);
+                       char* p = buffer.reserve(
+                           (3 * valence + fcolumns.size() + 2) *
+                               (max_number_length + 1) +
+                           1);
+                       auto list = [&](size_t n) {
+                           if (binary)
+                               p = ply_store(p, count_type, double(n));
+                           else
+                               p = format_uint(p, n);
+                       };
+                       auto value = [&](PlyType type, double v) {
+                           if (!binary)
+                               *p++ = separator;
+                           p = binary ? ply_store(p, type, v)
+                                      : ply_format(p, type, v);
+                       };
+
+                       list(valence);
+                       for (auto v : mesh.vertices(f))
+                           value(PlyInt32, v.idx());
+                       if (htex)
+                       {
+                           if (!binary)
+                               *p++ = separator;
+                           list(2 * valence);
+                           for (auto h : mesh.halfedges(f))
+                           {
+                               value(scalar_type, htex[h][0]);
+                               value(scalar_type, htex[h][1]);
+                           }
+                       }
+                       for (const auto& column : fcolumns)
+                       {
+                           if (!binary)
+                               *p++ = separator;
+                           p = write_ply_column(p, column, i, binary);
+                       }
+                       if (!binary)
+                           *p++ = '\n';
+                       buffer.commit(p);
+                   },
+                   progress);
+
+    return fclose(out) == 0 && ok;
+}
+
 } // namespace pmp
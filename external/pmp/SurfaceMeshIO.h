@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
 
 #include "pmp/Types.h"
@@ -23,10 +24,18 @@ public:
 
     bool write(const SurfaceMesh& mesh);
 
+    // the ASCII writers report the fraction of the file written so far to
+    // callback, from the thread that called write()
+    void set_progress_callback(const std::function<void(float)>& callback)
+    {
+        progress_ = callback;
+    }
+
 private:
     bool read_off(SurfaceMesh& mesh);
     bool read_obj(SurfaceMesh& mesh);
     bool read_stl(SurfaceMesh& mesh);
+    bool read_ply(SurfaceMesh& mesh);
     bool read_pmp(SurfaceMesh& mesh);
     bool read_xyz(SurfaceMesh& mesh);
     bool read_agi(SurfaceMesh& mesh);
@@ -35,12 +44,19 @@ private:
     bool write_off_binary(const SurfaceMesh& mesh);
     bool write_obj(const SurfaceMesh& mesh);
     bool write_stl(const SurfaceMesh& mesh);
+    bool write_ply(const SurfaceMesh& mesh);
     bool write_pmp(const SurfaceMesh& mesh);
     bool write_xyz(const SurfaceMesh& mesh);
 
+    // calls f.apply<T>() for the property type T with tag \p type in .pmp
+    // files, returns false for unknown tags
+    template <class F>
+    static bool dispatch_pmp_type(unsigned int type, F& f);
+
 private:
     std::string filename_;
     IOFlags flags_;
+    std::function<void(float)> progress_;
 };
 
 } // namespace pmp
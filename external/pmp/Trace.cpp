@@ -0,0 +1,154 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#include "pmp/Trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace pmp {
+
+namespace {
+
+struct TraceEvent
+{
+    const char* name;
+    int64_t begin, end;
+};
+
+// the zones of one thread. the mutex is only contended while the zones are
+// written or cleared.
+struct TraceBuffer
+{
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    size_t n_dropped = 0;
+    int thread = 0;
+};
+
+// zones beyond this number per thread are dropped
+const size_t max_trace_events = 1 << 22;
+
+// buffers of all threads that recorded zones, they stay alive after their
+// threads ended
+std::mutex buffers_mutex;
+std::vector<std::shared_ptr<TraceBuffer>> buffers;
+
+// times are given relative to the start of the program
+const std::chrono::steady_clock::time_point start_time =
+    std::chrono::steady_clock::now();
+
+TraceBuffer& thread_buffer()
+{
+    thread_local std::shared_ptr<TraceBuffer> buffer;
+    if (!buffer)
+    {
+        buffer = std::make_shared<TraceBuffer>();
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        buffer->thread = int(buffers.size()) + 1;
+        buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+// write s as JSON string
+void write_json_string(FILE* out, const char* s)
+{
+    fputc('"', out);
+    for (; *s; ++s)
+    {
+        if (*s == '"' || *s == '\\')
+            fputc('\\', out);
+        if (static_cast<unsigned char>(*s) >= 0x20)
+            fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+} // namespace
+
+bool Trace::is_enabled()
+{
+#ifdef PMP_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+int64_t Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start_time)
+        .count();
+}
+
+void Trace::record(const char* name, int64_t begin, int64_t end)
+{
+    TraceBuffer& buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    if (buffer.events.size() < max_trace_events)
+        buffer.events.push_back(TraceEvent{name, begin, end});
+    else
+        ++buffer.n_dropped;
+}
+
+bool Trace::write(const std::string& filename)
+{
+    FILE* out = fopen(filename.c_str(), "w");
+    if (!out)
+        return false;
+
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    size_t n_dropped = 0;
+    for (const auto& buffer : buffers)
+    {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+
+        // name the timeline of the thread
+        fprintf(out,
+                "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                first ? "" : ",\n", buffer->thread, buffer->thread);
+        first = false;
+
+        // complete events with times in microseconds
+        for (const auto& event : buffer->events)
+        {
+            fprintf(out, ",\n{\"name\":");
+            write_json_string(out, event.name);
+            fprintf(out,
+                    ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,"
+                    "\"dur\":%.3f}",
+                    buffer->thread, event.begin * 1e-3,
+                    (event.end - event.begin) * 1e-3);
+        }
+        n_dropped += buffer->n_dropped;
+    }
+    fprintf(out, "\n]}\n");
+
+    if (n_dropped)
+        std::cerr << "Trace::write: " << n_dropped
+                  << " zones were dropped, the buffers are full" << std::endl;
+
+    return fclose(out) == 0;
+}
+
+void Trace::clear()
+{
+    std::lock_guard<std::mutex> lock(buffers_mutex);
+    for (const auto& buffer : buffers)
+    {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->events.clear();
+        buffer->n_dropped = 0;
+    }
+}
+
+} // namespace pmp
@@ -0,0 +1,92 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace pmp {
+
+//! \brief Records the time spent in zones of code, per thread.
+//! \details Zones are marked by the macros PMP_TRACE_SCOPE(),
+//! PMP_TRACE_STAGES() and PMP_TRACE_NEXT(), which only record anything if
+//! PMP_TRACING is defined, and expand to nothing otherwise. Zone names have
+//! to be string literals. The recorded zones are written in the Chrome trace
+//! format, which can be viewed in chrome://tracing or ui.perfetto.dev.
+//! \ingroup core
+class Trace
+{
+public:
+    //! is tracing compiled in?
+    static bool is_enabled();
+
+    //! write all zones recorded so far to \p filename as Chrome trace JSON,
+    //! returns false if the file could not be written
+    static bool write(const std::string& filename);
+
+    //! discard all zones recorded so far
+    static void clear();
+
+    //! current time in nanoseconds
+    static int64_t now();
+
+    //! record a zone of the calling thread from \p begin to \p end
+    static void record(const char* name, int64_t begin, int64_t end);
+};
+
+//! A zone from its construction to its destruction, or to the next stage.
+//! \ingroup core
+class TraceScope
+{
+public:
+    //! start zone \p name
+    explicit TraceScope(const char* name) : name_(name), begin_(Trace::now())
+    {
+    }
+
+    //! end the current zone
+    ~TraceScope() { Trace::record(name_, begin_, Trace::now()); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    //! end the current zone and start zone \p name
+    void next(const char* name)
+    {
+        const int64_t now = Trace::now();
+        Trace::record(name_, begin_, now);
+        name_ = name;
+        begin_ = now;
+    }
+
+private:
+    const char* name_;
+    int64_t begin_;
+};
+
+} // namespace pmp
+
+#define PMP_TRACE_CONCAT_(a, b) a##b
+#define PMP_TRACE_CONCAT(a, b) PMP_TRACE_CONCAT_(a, b)
+
+#ifdef PMP_TRACING
+
+//! record the time until the end of the enclosing scope as zone \p name
+#define PMP_TRACE_SCOPE(name)                                                  \
+    ::pmp::TraceScope PMP_TRACE_CONCAT(pmp_trace_scope_, __LINE__)(name)
+
+//! record consecutive stages of a scope, starting with zone \p name. the
+//! next stage is started by PMP_TRACE_NEXT(\p stages, ...).
+#define PMP_TRACE_STAGES(stages, name) ::pmp::TraceScope stages(name)
+
+//! end the current stage of \p stages and start zone \p name
+#define PMP_TRACE_NEXT(stages, name) stages.next(name)
+
+#else
+
+#define PMP_TRACE_SCOPE(name) (void)0
+#define PMP_TRACE_STAGES(stages, name) (void)0
+#define PMP_TRACE_NEXT(stages, name) (void)0
+
+#endif
@@ -71,6 +71,9 @@ struct IOFlags
     bool use_face_normals = false;       //!< read / write face normals
     bool use_face_colors = false;        //!< read / write face colors
     bool use_halfedge_texcoords = false; //!< read / write halfedge texcoords
+    Scalar weld_tolerance = 0;           //!< merge STL vertices closer than this
+    bool use_memory_mapping = false;     //!< .pmp: use the file as storage
+    bool map_read_only = false;          //!< .pmp: copy mapped data on write
 };
 
 //! @}
@@ -2,25 +2,28 @@
 // Distributed under a MIT-style license, see LICENSE.txt for details.
 
 #include "pmp/algorithms/SurfaceNormals.h"
+#include "pmp/Trace.h"
 
 namespace pmp {
 
-Normal SurfaceNormals::compute_face_normal(const SurfaceMesh& mesh, Face f)
+namespace {
+
+// unnormalized normal of face f, its length is twice the face area
+Normal face_vector(const SurfaceMesh& mesh, const std::vector<Point>& vpoint,
+                   Face f)
 {
     Halfedge h = mesh.halfedge(f);
     Halfedge hend = h;
 
-    auto vpoint = mesh.get_vertex_property<Point>("v:point");
-
-    Point p0 = vpoint[mesh.to_vertex(h)];
+    Point p0 = vpoint[mesh.to_vertex(h).idx()];
     h = mesh.next_halfedge(h);
-    Point p1 = vpoint[mesh.to_vertex(h)];
+    Point p1 = vpoint[mesh.to_vertex(h).idx()];
     h = mesh.next_halfedge(h);
-    Point p2 = vpoint[mesh.to_vertex(h)];
+    Point p2 = vpoint[mesh.to_vertex(h).idx()];
 
     if (mesh.next_halfedge(h) == hend) // face is a triangle
     {
-        return normalize(cross(p2 -= p1, p0 -= p1));
+        return cross(p2 -= p1, p0 -= p1);
     }
     else // face is a general polygon
     {
@@ -31,50 +34,113 @@ Normal SurfaceNormals::compute_face_normal(const SurfaceMesh& mesh, Face f)
         //   sum_i (p_{i} - c) x (p_{i+1} - c)
         // The point c cancels out, leading to
         //   sum_i (p_{i} x p_{i+1}
-        // This vector then has to be normalized.
         for (auto h : mesh.halfedges(f))
         {
-            n += cross(vpoint[mesh.from_vertex(h)], vpoint[mesh.to_vertex(h)]);
+            n += cross(vpoint[mesh.from_vertex(h).idx()],
+                       vpoint[mesh.to_vertex(h).idx()]);
+        }
+
+        return n;
+    }
+}
+
+// angle between the edge vectors p1 and p2 of a corner,
+// zero if it cannot be computed robustly
+Scalar corner_angle(const Point& p1, const Point& p2)
+{
+    const Scalar denom = sqrt(dot(p1, p1) * dot(p2, p2));
+    if (denom > std::numeric_limits<Scalar>::min())
+    {
+        Scalar cosine = dot(p1, p2) / denom;
+        if (cosine < -1.0)
+            cosine = -1.0;
+        else if (cosine > 1.0)
+            cosine = 1.0;
+        return acos(cosine);
+    }
+    return 0.0;
+}
+
+// compute the (normalized or area-weighted) normals of all faces of mesh,
+// normals has to be of size mesh.faces_size(), deleted faces are skipped
+void face_normals(const SurfaceMesh& mesh, std::vector<Normal>& normals,
+                  bool normalized)
+{
+    PMP_TRACE_SCOPE("face normals");
+    const auto& vpoint = mesh.positions();
+    const int nf = int(mesh.faces_size());
+    const bool garbage = mesh.has_garbage();
+
+    // for triangle meshes gather the vertex indices of all faces and
+    // let the point kernel compute the normals
+    if (normalized && !garbage)
+    {
+        std::vector<IndexType> triangles(3 * nf);
+        bool is_triangle_mesh = true;
+#pragma omp parallel for reduction(&& : is_triangle_mesh)
+        for (int i = 0; i < nf; ++i)
+        {
+            const Halfedge h0 = mesh.halfedge(Face(i));
+            Halfedge h = h0;
+            for (int j = 0; j < 3; ++j, h = mesh.next_halfedge(h))
+                triangles[3 * i + j] = mesh.to_vertex(h).idx();
+            if (h != h0)
+                is_triangle_mesh = false;
+        }
+
+        if (is_triangle_mesh)
+        {
+            triangle_normals(vpoint.data(), triangles.data(), nf,
+                             normals.data());
+            return;
         }
+    }
 
-        return normalize(n);
+#pragma omp parallel for
+    for (int i = 0; i < nf; ++i)
+    {
+        const Face f(i);
+        if (!garbage || !mesh.is_deleted(f))
+        {
+            const Normal n = face_vector(mesh, vpoint, f);
+            normals[i] = normalized ? normalize(n) : n;
+        }
     }
 }
 
+} // namespace
+
+Normal SurfaceNormals::compute_face_normal(const SurfaceMesh& mesh, Face f)
+{
+    return normalize(face_vector(mesh, mesh.positions(), f));
+}
+
 Normal SurfaceNormals::compute_vertex_normal(const SurfaceMesh& mesh, Vertex v)
 {
     Point nn(0, 0, 0);
 
     if (!mesh.is_isolated(v))
     {
-        auto vpoint = mesh.get_vertex_property<Point>("v:point");
-        const Point p0 = vpoint[v];
+        const auto& vpoint = mesh.positions();
+        const Point p0 = vpoint[v.idx()];
 
         Normal n;
         Point p1, p2;
-        Scalar cosine, angle, denom;
+        Scalar angle;
         bool is_triangle;
 
         for (auto h : mesh.halfedges(v))
         {
             if (!mesh.is_boundary(h))
             {
-                p1 = vpoint[mesh.to_vertex(h)];
+                p1 = vpoint[mesh.to_vertex(h).idx()];
                 p1 -= p0;
-                p2 = vpoint[mesh.from_vertex(mesh.prev_halfedge(h))];
+                p2 = vpoint[mesh.from_vertex(mesh.prev_halfedge(h)).idx()];
                 p2 -= p0;
 
-                // check whether we can robustly compute angle
-                denom = sqrt(dot(p1, p1) * dot(p2, p2));
-                if (denom > std::numeric_limits<Scalar>::min())
+                angle = corner_angle(p1, p2);
+                if (angle > 0.0)
                 {
-                    cosine = dot(p1, p2) / denom;
-                    if (cosine < -1.0)
-                        cosine = -1.0;
-                    else if (cosine > 1.0)
-                        cosine = 1.0;
-                    angle = acos(cosine);
-
                     // compute triangle or polygon normal
                     is_triangle = (mesh.next_halfedge(mesh.next_halfedge(
                                        mesh.next_halfedge(h))) == h);
@@ -111,14 +177,13 @@ Normal SurfaceNormals::compute_corner_normal(const SurfaceMesh& mesh,
 
     if (!mesh.is_boundary(h))
     {
-        auto vpoint = mesh.get_vertex_property<Point>("v:point");
+        const auto& vpoint = mesh.positions();
 
         const Halfedge hend = h;
         const Vertex v0 = mesh.to_vertex(h);
-        const Point p0 = vpoint[v0];
+        const Point p0 = vpoint[v0.idx()];
 
         Point n, p1, p2;
-        Scalar cosine, angle, denom;
         bool is_triangle;
 
         // compute normal of h's face
@@ -129,9 +194,9 @@ Normal SurfaceNormals::compute_corner_normal(const SurfaceMesh& mesh,
         {
             if (!mesh.is_boundary(h))
             {
-                p1 = vpoint[mesh.to_vertex(mesh.next_halfedge(h))];
+                p1 = vpoint[mesh.to_vertex(mesh.next_halfedge(h)).idx()];
                 p1 -= p0;
-                p2 = vpoint[mesh.from_vertex(h)];
+                p2 = vpoint[mesh.from_vertex(h).idx()];
                 p2 -= p0;
 
                 // compute triangle or polygon normal
@@ -143,20 +208,8 @@ Normal SurfaceNormals::compute_corner_normal(const SurfaceMesh& mesh,
                 // check whether normal is withing crease_angle bound
                 if (dot(n, nf) >= cos_crease_angle)
                 {
-                    // check whether we can robustly compute angle
-                    denom = sqrt(dot(p1, p1) * dot(p2, p2));
-                    if (denom > std::numeric_limits<Scalar>::min())
-                    {
-                        cosine = dot(p1, p2) / denom;
-                        if (cosine < -1.0)
-                            cosine = -1.0;
-                        else if (cosine > 1.0)
-                            cosine = 1.0;
-                        angle = acos(cosine);
-
-                        n *= angle;
-                        nn += n;
-                    }
+                    n *= corner_angle(p1, p2);
+                    nn += n;
                 }
             }
 
@@ -169,18 +222,152 @@ Normal SurfaceNormals::compute_corner_normal(const SurfaceMesh& mesh,
     return nn;
 }
 
-void SurfaceNormals::compute_vertex_normals(SurfaceMesh& mesh)
+void SurfaceNormals::compute_vertex_normals(SurfaceMesh& mesh,
+                                            Weighting weighting)
 {
-    auto vnormal = mesh.vertex_property<Normal>("v:normal");
-    for (auto v : mesh.vertices())
-        vnormal[v] = compute_vertex_normal(mesh, v);
+    PMP_TRACE_SCOPE("SurfaceNormals::compute_vertex_normals");
+    auto& vnormal = mesh.vertex_property<Normal>("v:normal").vector();
+
+    // compute face normals only once, unnormalized for area weighting
+    std::vector<Normal> fnormal(mesh.faces_size());
+    face_normals(mesh, fnormal, weighting != AreaWeighting);
+
+    // each vertex gathers the normals of its incident faces in a fixed
+    // order, hence the result does not depend on the number of threads
+    const auto& vpoint = mesh.positions();
+    const int nv = int(mesh.vertices_size());
+    const bool garbage = mesh.has_garbage();
+#pragma omp parallel for
+    for (int i = 0; i < nv; ++i)
+    {
+        const Vertex v(i);
+        if ((garbage && mesh.is_deleted(v)) || mesh.is_isolated(v))
+        {
+            vnormal[i] = Normal(0, 0, 0);
+            continue;
+        }
+
+        Normal nn(0, 0, 0);
+        for (auto h : mesh.halfedges(v))
+        {
+            if (mesh.is_boundary(h))
+                continue;
+
+            const Normal& n = fnormal[mesh.face(h).idx()];
+            if (weighting == AngleWeighting)
+            {
+                const Point& p0 = vpoint[i];
+                const Point p1 = vpoint[mesh.to_vertex(h).idx()] - p0;
+                const Point p2 =
+                    vpoint[mesh.from_vertex(mesh.prev_halfedge(h)).idx()] - p0;
+                nn += corner_angle(p1, p2) * n;
+            }
+            else
+            {
+                nn += n;
+            }
+        }
+
+        vnormal[i] = normalize(nn);
+    }
 }
 
 void SurfaceNormals::compute_face_normals(SurfaceMesh& mesh)
 {
+    PMP_TRACE_SCOPE("SurfaceNormals::compute_face_normals");
     auto fnormal = mesh.face_property<Normal>("f:normal");
-    for (auto f : mesh.faces())
-        fnormal[f] = compute_face_normal(mesh, f);
+    face_normals(mesh, fnormal.vector(), true);
+}
+
+void SurfaceNormals::compute_corner_normals(SurfaceMesh& mesh,
+                                            Scalar crease_angle)
+{
+    auto hnormal = mesh.halfedge_property<Normal>("h:normal");
+    compute_corner_normals(mesh, crease_angle, hnormal);
+}
+
+void SurfaceNormals::compute_corner_normals(const SurfaceMesh& mesh,
+                                            Scalar crease_angle,
+                                            HalfedgeProperty<Normal> hnormal)
+{
+    PMP_TRACE_SCOPE("SurfaceNormals::compute_corner_normals");
+    const bool garbage = mesh.has_garbage();
+
+    // compute face normals only once
+    std::vector<Normal> fnormal(mesh.faces_size());
+    face_normals(mesh, fnormal, true);
+
+    // mark sharp edges only once
+    const Scalar cos_crease_angle = cos(crease_angle);
+    const int ne = int(mesh.edges_size());
+    std::vector<unsigned char> sharp(ne);
+#pragma omp parallel for
+    for (int i = 0; i < ne; ++i)
+    {
+        const Edge e(i);
+        if (garbage && mesh.is_deleted(e))
+            continue;
+        const Face f0 = mesh.face(e, 0);
+        const Face f1 = mesh.face(e, 1);
+        sharp[i] = !f0.is_valid() || !f1.is_valid() ||
+                   dot(fnormal[f0.idx()], fnormal[f1.idx()]) < cos_crease_angle;
+    }
+
+    // sweep once around each vertex. the outgoing halfedge h starts a new
+    // smooth group if its edge is sharp, the corner of h's face at the vertex
+    // is given by the incoming halfedge prev(h).
+    // the normals are written through the vector, which is detached from
+    // copies of hnormal once here
+    const auto& vpoint = mesh.positions();
+    auto& hn = hnormal.vector();
+    const int nv = int(mesh.vertices_size());
+#pragma omp parallel for
+    for (int i = 0; i < nv; ++i)
+    {
+        const Vertex v(i);
+        if ((garbage && mesh.is_deleted(v)) || mesh.is_isolated(v))
+            continue;
+
+        // start at a sharp edge, if there is none all faces form one group
+        Halfedge start = mesh.halfedge(v);
+        for (auto h : mesh.halfedges(v))
+        {
+            if (sharp[mesh.edge(h).idx()])
+            {
+                start = h;
+                break;
+            }
+        }
+
+        const Point& p0 = vpoint[i];
+        Halfedge group = start, h = start;
+        Normal nn(0, 0, 0);
+        do
+        {
+            if (!mesh.is_boundary(h))
+            {
+                const Point p1 = vpoint[mesh.to_vertex(h).idx()] - p0;
+                const Point p2 =
+                    vpoint[mesh.from_vertex(mesh.prev_halfedge(h)).idx()] - p0;
+                nn += corner_angle(p1, p2) * fnormal[mesh.face(h).idx()];
+            }
+
+            h = mesh.ccw_rotated_halfedge(h);
+
+            // close the group at the next sharp edge
+            if (h == start || sharp[mesh.edge(h).idx()])
+            {
+                nn = normalize(nn);
+                do
+                {
+                    if (!mesh.is_boundary(group))
+                        hn[mesh.prev_halfedge(group).idx()] = nn;
+                    group = mesh.ccw_rotated_halfedge(group);
+                } while (group != h);
+                nn = Normal(0, 0, 0);
+            }
+        } while (h != start);
+    }
 }
 
 } // namespace pmp
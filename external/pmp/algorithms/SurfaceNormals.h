@@ -26,16 +26,44 @@ public:
     SurfaceNormals() = delete;
     SurfaceNormals(const SurfaceNormals&) = delete;
 
+    //! weighting of the incident face normals in compute_vertex_normals()
+    enum Weighting
+    {
+        UniformWeighting, //!< plain average of the face normals
+        AreaWeighting,    //!< weighted by face area (fastest)
+        AngleWeighting    //!< weighted by the corner angle (most accurate)
+    };
+
     //! \brief Compute vertex normals for the whole \p mesh.
-    //! \details Calls compute_vertex_normal() for each vertex and adds a new
-    //! vertex property of type Normal named "v:normal".
-    static void compute_vertex_normals(SurfaceMesh& mesh);
+    //! \details Adds a new vertex property of type Normal named "v:normal".
+    //! Face normals are computed once and then averaged around each vertex
+    //! using the given \p weighting. AngleWeighting gives the same result as
+    //! compute_vertex_normal(). Runs in parallel; the result does not depend
+    //! on the number of threads.
+    static void compute_vertex_normals(SurfaceMesh& mesh,
+                                       Weighting weighting = AngleWeighting);
 
     //! \brief Compute face normals for the whole \p mesh.
     //! \details Calls compute_face_normal() for each face and adds a new face
-    //! property of type Normal named "f:normal".
+    //! property of type Normal named "f:normal". Runs in parallel.
     static void compute_face_normals(SurfaceMesh& mesh);
 
+    //! \brief Compute corner normals for the whole \p mesh.
+    //! \details Adds a halfedge property of type Normal named "h:normal"
+    //! holding for each halfedge h the normal of the corner at to_vertex(h)
+    //! in face(h). Edges whose dihedral angle exceeds \p crease_angle (in
+    //! radians) and boundary edges are sharp. They split the faces around a
+    //! vertex into smooth groups, all corners of a group share the
+    //! angle-weighted average of the group's face normals. Takes linear time
+    //! and runs in parallel.
+    static void compute_corner_normals(SurfaceMesh& mesh, Scalar crease_angle);
+
+    //! \brief Compute corner normals for the whole \p mesh into the given
+    //! halfedge property \p normals. \sa compute_corner_normals()
+    static void compute_corner_normals(const SurfaceMesh& mesh,
+                                       Scalar crease_angle,
+                                       HalfedgeProperty<Normal> normals);
+
     //! \brief Compute the normal vector of vertex \p v.
     static Normal compute_vertex_normal(const SurfaceMesh& mesh, Vertex v);
 
@@ -0,0 +1,82 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#include "pmp/visualization/Culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pmp {
+
+Frustum::Frustum(const mat4& m)
+{
+    // a point x is inside if -w <= x_i <= w for its clip coordinates
+    // (x_0, x_1, x_2, w) = m * x, which gives the planes w + x_i >= 0 and
+    // w - x_i >= 0
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+        {
+            planes_[2 * i][j] = m(3, j) + m(i, j);
+            planes_[2 * i + 1][j] = m(3, j) - m(i, j);
+        }
+    }
+}
+
+bool Frustum::is_outside(const vec3& bbmin, const vec3& bbmax) const
+{
+    for (const vec4& plane : planes_)
+    {
+        // the corner of the box farthest inside the plane
+        float d = plane[3];
+        for (int j = 0; j < 3; ++j)
+            d += plane[j] * (plane[j] > 0 ? bbmax[j] : bbmin[j]);
+        if (d < 0)
+            return true;
+    }
+    return false;
+}
+
+NormalCone::NormalCone(const vec3* normals, size_t n) : NormalCone()
+{
+    vec3 axis(0, 0, 0);
+    for (size_t i = 0; i < n; ++i)
+        axis += normals[i];
+    const float length = norm(axis);
+    if (length < 1e-6f)
+        return;
+    axis /= length;
+
+    float cos_angle = 1;
+    for (size_t i = 0; i < n; ++i)
+        if (normals[i] != vec3(0, 0, 0))
+            cos_angle = std::min(cos_angle, dot(axis, normals[i]));
+
+    axis_ = axis;
+    cos_angle_ = cos_angle;
+    sin_angle_ = std::sqrt(std::max(0.0f, 1.0f - cos_angle * cos_angle));
+}
+
+bool NormalCone::is_backfacing(const vec3& eye, const vec3& center,
+                               float radius) const
+{
+    // cones wider than a half-space always contain front-facing normals
+    if (cos_angle_ <= 0)
+        return false;
+
+    const vec3 view = center - eye;
+    const float distance = norm(view);
+    if (distance <= radius)
+        return false;
+
+    // a triangle at p with normal n is back-facing if dot(n, p - eye) > 0.
+    // since |p - center| <= radius and n deviates by at most the cone angle
+    // from the axis, dot(n, p - eye) >= dot(n, view) - radius
+    // >= distance * cos(angle(view, axis) + cone angle) - radius.
+    const float cos_view = dot(view, axis_) / distance;
+    const float sin_view =
+        std::sqrt(std::max(0.0f, 1.0f - cos_view * cos_view));
+    return cos_view * cos_angle_ - sin_view * sin_angle_ > radius / distance;
+}
+
+} // namespace pmp
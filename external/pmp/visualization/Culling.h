@@ -0,0 +1,61 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#pragma once
+
+#include "pmp/MatVec.h"
+
+namespace pmp {
+
+//! \brief The view frustum of a modelview-projection matrix.
+//! \details The planes are given in the coordinate system the matrix maps
+//! from, so that bounding boxes can be tested without transforming them.
+//! \ingroup visualization
+class Frustum
+{
+public:
+    //! extract the six clipping planes of \p modelview_projection
+    explicit Frustum(const mat4& modelview_projection);
+
+    //! is the box from \p bbmin to \p bbmax completely outside? boxes that
+    //! are close to a corner of the frustum might not be detected.
+    bool is_outside(const vec3& bbmin, const vec3& bbmax) const;
+
+private:
+    vec4 planes_[6];
+};
+
+//! \brief A cone containing the normals of a set of triangles.
+//! \details Used to detect sets of triangles that face away from the viewer
+//! from all points of their bounding sphere.
+//! \ingroup visualization
+class NormalCone
+{
+public:
+    //! cone of all directions, never back-facing
+    NormalCone() : axis_(0, 0, 0), cos_angle_(-1), sin_angle_(0) {}
+
+    //! smallest cone around the average of the \p n unit normals \p normals,
+    //! zero normals (of degenerate triangles) are ignored
+    NormalCone(const vec3* normals, size_t n);
+
+    //! are the triangles inside the sphere around \p center with radius
+    //! \p radius back-facing as seen from \p eye?
+    bool is_backfacing(const vec3& eye, const vec3& center,
+                       float radius) const;
+
+private:
+    vec3 axis_;
+    float cos_angle_, sin_angle_;
+};
+
+//! Number of objects drawn and skipped by culling in the last frame.
+//! \ingroup visualization
+struct CullingStats
+{
+    unsigned int visible = 0;  //!< drawn
+    unsigned int outside = 0;  //!< outside the view frustum
+    unsigned int backface = 0; //!< facing away from the viewer
+};
+
+} // namespace pmp
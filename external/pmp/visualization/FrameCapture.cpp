@@ -0,0 +1,244 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#include "pmp/visualization/FrameCapture.h"
+#include "pmp/Trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include <stb_image_write.h>
+
+namespace pmp {
+
+namespace {
+
+// reads in flight and images waiting for a worker beyond these numbers make
+// read() wait, which bounds the memory used if the workers fall behind
+const size_t max_readbacks = 4;
+const size_t max_jobs_per_thread = 4;
+
+// write the RGBA pixels of an OpenGL framebuffer, bottom row first, as RGB
+// PNG image
+void write_png(const std::vector<unsigned char>& rgba, int width, int height,
+               const std::string& filename)
+{
+    PMP_TRACE_SCOPE("FrameCapture::write_png");
+
+    std::vector<unsigned char> rgb(size_t(3) * width * height);
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char* src = &rgba[size_t(4) * width * y];
+        unsigned char* dst = &rgb[size_t(3) * width * (height - 1 - y)];
+        for (int x = 0; x < width; ++x, src += 4, dst += 3)
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+    }
+
+    if (!stbi_write_png(filename.c_str(), width, height, 3, rgb.data(),
+                        3 * width))
+        std::cerr << "Cannot write " << filename << std::endl;
+}
+
+} // namespace
+
+FrameCapture::FrameCapture(unsigned int n_threads) : n_jobs_(0), stop_(false)
+{
+#ifndef __EMSCRIPTEN__
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+    for (unsigned int i = 0; i < n_threads; ++i)
+        threads_.emplace_back(&FrameCapture::work, this);
+#else
+    (void)n_threads;
+#endif
+}
+
+FrameCapture::~FrameCapture()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    job_added_.notify_all();
+    for (auto& thread : threads_)
+        thread.join();
+}
+
+void FrameCapture::read(int width, int height, const std::string& filename)
+{
+    PMP_TRACE_SCOPE("FrameCapture::read");
+
+#ifdef __EMSCRIPTEN__
+    // WebGL cannot map buffers, read and write synchronously
+    std::vector<unsigned char> pixels(size_t(4) * width * height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+                 pixels.data());
+    write_png(pixels, width, height, filename);
+#else
+    // wait for the oldest read if too many are in flight
+    poll();
+    if (readbacks_.size() >= max_readbacks)
+    {
+        Readback& oldest = readbacks_.front();
+        glClientWaitSync(oldest.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                         GLuint64(1000000000));
+        map(oldest);
+        readbacks_.pop_front();
+    }
+
+    Readback readback;
+    if (free_buffers_.empty())
+    {
+        glGenBuffers(1, &readback.buffer);
+    }
+    else
+    {
+        readback.buffer = free_buffers_.back();
+        free_buffers_.pop_back();
+    }
+    readback.width = width;
+    readback.height = height;
+    readback.filename = filename;
+
+    // the copy into the buffer runs asynchronously, the fence tells when
+    // it is done
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(4) * width * height,
+                 nullptr, GL_STREAM_READ);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    readbacks_.push_back(readback);
+#endif
+}
+
+void FrameCapture::poll()
+{
+    while (!readbacks_.empty())
+    {
+        Readback& oldest = readbacks_.front();
+        const GLenum status = glClientWaitSync(oldest.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        map(oldest);
+        readbacks_.pop_front();
+    }
+}
+
+size_t FrameCapture::n_pending()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return readbacks_.size() + n_jobs_;
+}
+
+void FrameCapture::finish()
+{
+    for (auto& readback : readbacks_)
+    {
+        glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                         GLuint64(1000000000));
+        map(readback);
+    }
+    readbacks_.clear();
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        job_done_.wait(lock, [this]() { return n_jobs_ == 0; });
+    }
+
+    if (!free_buffers_.empty())
+    {
+        glDeleteBuffers(GLsizei(free_buffers_.size()), free_buffers_.data());
+        free_buffers_.clear();
+    }
+}
+
+void FrameCapture::map(Readback& readback)
+{
+    PMP_TRACE_SCOPE("FrameCapture::map");
+
+    // copy the pixels out of the buffer, so that the buffer can be reused
+    // right away
+    const size_t size = size_t(4) * readback.width * readback.height;
+    auto pixels = std::make_shared<std::vector<unsigned char>>(size);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    const void* data =
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (data)
+    {
+        memcpy(pixels->data(), data, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glDeleteSync(readback.fence);
+    free_buffers_.push_back(readback.buffer);
+
+    if (!data)
+    {
+        std::cerr << "Cannot read pixels for " << readback.filename
+                  << std::endl;
+        return;
+    }
+
+    const int width = readback.width;
+    const int height = readback.height;
+    const std::string filename = readback.filename;
+    enqueue([pixels, width, height, filename]() {
+        write_png(*pixels, width, height, filename);
+    });
+}
+
+void FrameCapture::enqueue(std::function<void()> job)
+{
+    if (threads_.empty())
+    {
+        job();
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        job_done_.wait(lock, [this]() {
+            return n_jobs_ < max_jobs_per_thread * threads_.size();
+        });
+        jobs_.push_back(std::move(job));
+        ++n_jobs_;
+    }
+    job_added_.notify_one();
+}
+
+void FrameCapture::work()
+{
+    for (;;)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            job_added_.wait(lock,
+                            [this]() { return stop_ || !jobs_.empty(); });
+            if (jobs_.empty())
+                return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --n_jobs_;
+        }
+        job_done_.notify_all();
+    }
+}
+
+} // namespace pmp
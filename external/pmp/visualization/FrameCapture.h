@@ -0,0 +1,84 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#pragma once
+
+#include "pmp/visualization/GL.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pmp {
+
+//! \brief Save rendered frames as PNG images without stalling rendering.
+//! \details read() copies the framebuffer into a pixel buffer object, which
+//! the GPU fills while the next frames are rendered. poll() picks up finished
+//! copies and hands them to worker threads that encode and write the images.
+//! All functions except the constructor have to be called with the OpenGL
+//! context current.
+//! \ingroup visualization
+class FrameCapture
+{
+public:
+    //! start \p n_threads worker threads, by default half of the cores
+    explicit FrameCapture(unsigned int n_threads = 0);
+
+    //! stop the worker threads, call finish() before the OpenGL context is
+    //! destroyed
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    //! start reading the lower left \p width x \p height pixels of the read
+    //! framebuffer, to be written to \p filename. only blocks if the worker
+    //! threads fall far behind.
+    void read(int width, int height, const std::string& filename);
+
+    //! pass finished reads to the worker threads, call once per frame
+    void poll();
+
+    //! number of images that are not written yet
+    size_t n_pending();
+
+    //! wait until all images are written and release the pixel buffers
+    void finish();
+
+private:
+    // a read in flight
+    struct Readback
+    {
+        GLuint buffer;
+        GLsync fence;
+        int width, height;
+        std::string filename;
+    };
+
+    // copy the pixels of a finished read and queue them for encoding
+    void map(Readback& readback);
+
+    // run job on a worker thread, or right away if there are none
+    void enqueue(std::function<void()> job);
+
+    // loop of the worker threads
+    void work();
+
+    // reads in flight, oldest first, and buffers available for new reads
+    std::deque<Readback> readbacks_;
+    std::vector<GLuint> free_buffers_;
+
+    // worker threads and their jobs
+    std::vector<std::thread> threads_;
+    std::deque<std::function<void()>> jobs_;
+    std::mutex mutex_;
+    std::condition_variable job_added_, job_done_;
+    size_t n_jobs_; // queued or running
+    bool stop_;
+};
+
+} // namespace pmp
@@ -0,0 +1,61 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#include "pmp/visualization/FrameUniforms.h"
+
+#include <cstring>
+
+namespace pmp {
+
+const char* const FrameUniforms::block_name = "FrameUniforms";
+
+FrameUniforms::FrameUniforms() : buffer_(0)
+{
+    std::memset(data_, 0, sizeof(data_));
+}
+
+FrameUniforms::~FrameUniforms()
+{
+    if (buffer_)
+        glDeleteBuffers(1, &buffer_);
+}
+
+void FrameUniforms::update(const mat4& projection_matrix,
+                           const mat4& modelview_matrix, const vec3& light1,
+                           const vec3& light2)
+{
+    const mat4 mvp_matrix = projection_matrix * modelview_matrix;
+    const mat3 n_matrix = inverse(transpose(linear_part(modelview_matrix)));
+
+    // matrices are stored column-major, like OpenGL expects them
+    float data[n_floats] = {};
+    std::memcpy(data, mvp_matrix.data(), 16 * sizeof(float));
+    std::memcpy(data + 16, modelview_matrix.data(), 16 * sizeof(float));
+    for (int j = 0; j < 3; ++j)
+        for (int i = 0; i < 3; ++i)
+            data[32 + 4 * j + i] = n_matrix(i, j);
+    for (int i = 0; i < 3; ++i)
+    {
+        data[44 + i] = light1[i];
+        data[48 + i] = light2[i];
+    }
+
+    if (!buffer_)
+    {
+        glGenBuffers(1, &buffer_);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(data), data, GL_DYNAMIC_DRAW);
+        std::memcpy(data_, data, sizeof(data));
+    }
+    else if (std::memcmp(data, data_, sizeof(data)) != 0)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), data);
+        std::memcpy(data_, data, sizeof(data));
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding_point, buffer_);
+}
+
+} // namespace pmp
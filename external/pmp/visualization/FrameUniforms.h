@@ -0,0 +1,59 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#pragma once
+
+#include "pmp/visualization/GL.h"
+#include "pmp/MatVec.h"
+
+namespace pmp {
+
+//! \brief Uniform buffer with the matrices and lights of a frame.
+//! \details Holds the std140 uniform block
+//! \code
+//! layout (std140) uniform FrameUniforms
+//! {
+//!     mat4 modelview_projection_matrix;
+//!     mat4 modelview_matrix;
+//!     mat3 normal_matrix;
+//!     vec3 light1;
+//!     vec3 light2;
+//! };
+//! \endcode
+//! declared by the Phong and MatCap shaders, so that all programs read the
+//! same buffer instead of receiving the values as separate uniforms.
+//! \ingroup visualization
+class FrameUniforms
+{
+public:
+    //! name of the uniform block in the shaders
+    static const char* const block_name;
+
+    //! uniform buffer binding point the block is bound to
+    static const GLuint binding_point = 0;
+
+    //! default constructor, the buffer is created on the first update()
+    FrameUniforms();
+
+    //! delete the buffer
+    ~FrameUniforms();
+
+    FrameUniforms(const FrameUniforms&) = delete;
+    FrameUniforms& operator=(const FrameUniforms&) = delete;
+
+    //! compute the matrices from \p projection_matrix and
+    //! \p modelview_matrix, upload them together with the lights if anything
+    //! changed, and bind the buffer to binding_point
+    void update(const mat4& projection_matrix, const mat4& modelview_matrix,
+                const vec3& light1, const vec3& light2);
+
+private:
+    // std140 layout: two mat4, a mat3 as three vec4 columns, two vec3
+    // padded to vec4
+    static const int n_floats = 16 + 16 + 12 + 4 + 4;
+
+    GLuint buffer_;
+    float data_[n_floats];
+};
+
+} // namespace pmp
@@ -17,8 +17,15 @@ R"glsl(
 layout (location=0) in vec4 v_position;
 layout (location=1) in vec3 v_normal;
 out vec3 v2f_normal;
-uniform mat4 modelview_projection_matrix;
-uniform mat3 normal_matrix;
+
+layout (std140) uniform FrameUniforms
+{
+    highp mat4 modelview_projection_matrix;
+    highp mat4 modelview_matrix;
+    highp mat3 normal_matrix;
+    highp vec3 light1;
+    highp vec3 light2;
+};
 
 void main()
 {
@@ -0,0 +1,80 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#include "pmp/visualization/MemoryInfo.h"
+#include "pmp/MemoryUsage.h"
+
+#include <imgui.h>
+
+namespace pmp {
+
+namespace {
+
+double megabytes(double bytes)
+{
+    return bytes / (1024.0 * 1024.0);
+}
+
+void show_element(const char* name, const ElementMemory& element)
+{
+    if (!ImGui::TreeNode(name, "%s: %.1f MB", name,
+                         megabytes(element.used())))
+        return;
+
+    ImGui::BulletText("%.0f bytes per element, %.0f connectivity",
+                      element.bytes_per_element(),
+                      element.connectivity_per_element());
+    for (const auto& prop : element.properties)
+    {
+        ImGui::BulletText("%s: %.2f MB (%.2f reserved)%s", prop.name.c_str(),
+                          megabytes(prop.used), megabytes(prop.reserved),
+                          prop.shared ? " shared"
+                                      : (prop.mapped ? " mapped" : ""));
+    }
+    ImGui::TreePop();
+}
+
+} // namespace
+
+void show_memory_info(const SurfaceMeshGL& mesh)
+{
+    if (!ImGui::TreeNode("Memory"))
+        return;
+
+    const MeshMemory memory = mesh.memory_usage();
+    ImGui::BulletText("%.1f MB used, %.1f MB reserved",
+                      megabytes(memory.used()), megabytes(memory.reserved()));
+    ImGui::BulletText("%.1f MB OpenGL buffers",
+                      megabytes(mesh.gpu_memory()));
+    ImGui::BulletText("%.1f MB process, %.1f MB peak",
+                      megabytes(MemoryUsage::current_size()),
+                      megabytes(MemoryUsage::max_size()));
+
+    show_element("vertices", memory.vertices);
+    show_element("halfedges", memory.halfedges);
+    show_element("edges", memory.edges);
+    show_element("faces", memory.faces);
+
+    // growth of the process during the last operations
+    const std::vector<MemoryRecord> records = MemoryUsage::records();
+    if (!records.empty() && ImGui::TreeNode("Operations"))
+    {
+        for (auto it = records.rbegin(); it != records.rend(); ++it)
+        {
+            ImGui::BulletText("%s\npeak %+.1f MB, after %+.1f MB",
+                              it->operation.c_str(),
+                              megabytes(double(it->peak) - it->before),
+                              megabytes(double(it->after) - it->before));
+            if (it->gpu)
+            {
+                ImGui::SameLine();
+                ImGui::Text(", %.1f MB GPU", megabytes(it->gpu));
+            }
+        }
+        ImGui::TreePop();
+    }
+
+    ImGui::TreePop();
+}
+
+} // namespace pmp
@@ -0,0 +1,16 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+#pragma once
+
+#include "pmp/visualization/SurfaceMeshGL.h"
+
+namespace pmp {
+
+//! Show the memory used by the properties and OpenGL buffers of \p mesh,
+//! and by the recent operations recorded in MemoryUsage::records(), as a
+//! collapsed tree node of the current ImGui window.
+//! \ingroup visualization
+void show_memory_info(const SurfaceMeshGL& mesh);
+
+} // namespace pmp
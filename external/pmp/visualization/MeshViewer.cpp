@@ -2,6 +2,7 @@
 // Distributed under a MIT-style license, see LICENSE.txt for details.
 
 #include "pmp/visualization/MeshViewer.h"
+#include "pmp/visualization/MemoryInfo.h"
 
 #include <iostream>
 #include <limits>
@@ -109,6 +110,8 @@ void MeshViewer::process_imgui()
         ImGui::BulletText("%d vertices", (int)mesh_.n_vertices());
         ImGui::BulletText("%d edges", (int)mesh_.n_edges());
         ImGui::BulletText("%d faces", (int)mesh_.n_faces());
+        ImGui::BulletText("%d buffer vertices",
+                          (int)mesh_.n_buffer_vertices());
 
         // control crease angle
         ImGui::PushItemWidth(100);
@@ -119,6 +122,21 @@ void MeshViewer::process_imgui()
         {
             mesh_.set_crease_angle(crease_angle_);
         }
+
+        // culling of chunks of triangles
+        bool frustum_culling = mesh_.frustum_culling();
+        if (ImGui::Checkbox("Frustum Culling", &frustum_culling))
+            mesh_.set_frustum_culling(frustum_culling);
+        bool backface_culling = mesh_.backface_culling();
+        if (ImGui::Checkbox("Backface Culling", &backface_culling))
+            mesh_.set_backface_culling(backface_culling);
+        const CullingStats& stats = mesh_.culling_stats();
+        ImGui::BulletText("%u chunks drawn", stats.visible);
+        ImGui::BulletText("%u outside, %u back-facing", stats.outside,
+                          stats.backface);
+
+        // memory of the mesh and of recent operations
+        show_memory_info(mesh_);
     }
 }
 
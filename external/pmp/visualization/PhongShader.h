@@ -18,9 +18,15 @@ out vec3 v2f_normal;
 out vec2 v2f_tex;
 out vec3 v2f_view;
 
-uniform mat4 modelview_projection_matrix;
-uniform mat4 modelview_matrix;
-uniform mat3 normal_matrix;
+layout (std140) uniform FrameUniforms
+{
+    highp mat4 modelview_projection_matrix;
+    highp mat4 modelview_matrix;
+    highp mat3 normal_matrix;
+    highp vec3 light1;
+    highp vec3 light2;
+};
+
 uniform float point_size;
 uniform bool show_texture_layout;
 
@@ -59,8 +65,15 @@ uniform float  diffuse;
 uniform float  specular;
 uniform float  shininess;
 uniform float  alpha;
-uniform vec3   light1;
-uniform vec3   light2;
+
+layout (std140) uniform FrameUniforms
+{
+    highp mat4 modelview_projection_matrix;
+    highp mat4 modelview_matrix;
+    highp mat3 normal_matrix;
+    highp vec3 light1;
+    highp vec3 light2;
+};
 
 uniform sampler2D mytexture;
 
@@ -7,6 +7,8 @@
 #include <fstream>
 #include <sstream>
 #include <cassert>
+#include <cstring>
+#include <algorithm>
 
 namespace pmp {
 
@@ -24,6 +26,7 @@ void Shader::cleanup()
         glDeleteProgram(pid_);
         pid_ = 0;
     }
+    uniform_locations_.clear();
 
     for (GLint id : shaders_)
     {
@@ -172,9 +175,71 @@ bool Shader::link()
         return false;
     }
 
+    // linking resets the block bindings
+    for (const auto& block : uniform_blocks_)
+    {
+        GLuint index = glGetUniformBlockIndex(pid_, block.first.c_str());
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(pid_, index, block.second);
+    }
+
+    cache_uniform_locations();
+
     return true;
 }
 
+void Shader::cache_uniform_locations()
+{
+    uniform_locations_.clear();
+
+    GLint n_uniforms = 0;
+    GLint max_length = 0;
+    glGetProgramiv(pid_, GL_ACTIVE_UNIFORMS, &n_uniforms);
+    glGetProgramiv(pid_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+
+    std::vector<GLchar> buffer(max_length + 1);
+    for (GLint i = 0; i < n_uniforms; ++i)
+    {
+        GLsizei length = 0;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(pid_, GLuint(i), GLsizei(buffer.size()), &length,
+                           &size, &type, buffer.data());
+        std::string name(buffer.data(), length);
+
+        // arrays are reported as "name[0]", but set by their plain name
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            name.resize(name.size() - 3);
+
+        // members of uniform blocks have no location
+        GLint location = glGetUniformLocation(pid_, name.c_str());
+        if (location != -1)
+            uniform_locations_.emplace_back(name, location);
+    }
+
+    std::sort(uniform_locations_.begin(), uniform_locations_.end());
+}
+
+GLint Shader::uniform_location(const char* name) const
+{
+    auto it = std::lower_bound(
+        uniform_locations_.begin(), uniform_locations_.end(), name,
+        [](const std::pair<std::string, GLint>& uniform, const char* n) {
+            return strcmp(uniform.first.c_str(), n) < 0;
+        });
+    if (it == uniform_locations_.end() || it->first != name)
+        return -1;
+    return it->second;
+}
+
+GLint Shader::lookup(const char* name) const
+{
+    GLint location = uniform_location(name);
+    if (location == -1)
+        std::cerr << "Invalid uniform location for: " << name << std::endl;
+    return location;
+}
+
 bool Shader::load(const char* filename, std::string& source)
 {
     std::ifstream ifs(filename);
@@ -258,16 +323,35 @@ void Shader::bind_attribute(const char* name, GLuint index)
     link(); // have to re-link now!
 }
 
-void Shader::set_uniform(const char* name, float value)
+void Shader::bind_uniform_block(const char* name, GLuint binding)
 {
+    auto it = std::find_if(uniform_blocks_.begin(), uniform_blocks_.end(),
+                           [name](const std::pair<std::string, GLuint>& b) {
+                               return b.first == name;
+                           });
+    if (it != uniform_blocks_.end())
+        it->second = binding;
+    else
+        uniform_blocks_.emplace_back(name, binding);
+
     if (!pid_)
         return;
-    int location = glGetUniformLocation(pid_, name);
-    if (location == -1)
+    GLuint index = glGetUniformBlockIndex(pid_, name);
+    if (index == GL_INVALID_INDEX)
     {
-        std::cerr << "Invalid uniform location for: " << name << std::endl;
+        std::cerr << "Invalid uniform block: " << name << std::endl;
         return;
     }
+    glUniformBlockBinding(pid_, index, binding);
+}
+
+void Shader::set_uniform(const char* name, float value)
+{
+    if (!pid_)
+        return;
+    GLint location = lookup(name);
+    if (location == -1)
+        return;
     glUniform1f(location, value);
 }
 
@@ -275,12 +359,9 @@ void Shader::set_uniform(const char* name, int value)
 {
     if (!pid_)
         return;
-    int location = glGetUniformLocation(pid_, name);
+    GLint location = lookup(name);
     if (location == -1)
-    {
-        std::cerr << "Invalid uniform location for: " << name << std::endl;
         return;
-    }
     glUniform1i(location, value);
 }
 
@@ -288,12 +369,9 @@ void Shader::set_uniform(const char* name, const vec3& vec)
 {
     if (!pid_)
         return;
-    int location = glGetUniformLocation(pid_, name);
+    GLint location = lookup(name);
     if (location == -1)
-    {
-        std::cerr << "Invalid uniform location for: " << name << std::endl;
         return;
-    };
     glUniform3f(location, vec[0], vec[1], vec[2]);
 }
 
@@ -301,12 +379,9 @@ void Shader::set_uniform(const char* name, const vec4& vec)
 {
     if (!pid_)
         return;
-    int location = glGetUniformLocation(pid_, name);
+    GLint location = lookup(name);
     if (location == -1)
-    {
-        std::cerr << "Invalid uniform location for: " << name << std::endl;
         return;
-    }
     glUniform4f(location, vec[0], vec[1], vec[2], vec[3]);
 }
 
@@ -314,12 +389,9 @@ void Shader::set_uniform(const char* name, const mat3& mat)
 {
     if (!pid_)
         return;
-    int location = glGetUniformLocation(pid_, name);
+    GLint location = lookup(name);
     if (location == -1)
-    {
-        std::cerr << "Invalid uniform location for: " << name << std::endl;
         return;
-    }
     glUniformMatrix3fv(location, 1, false, mat.data());
 }
 
@@ -327,12 +399,9 @@ void Shader::set_uniform(const char* name, const mat4& mat)
 {
     if (!pid_)
         return;
-    int location = glGetUniformLocation(pid_, name);
+    GLint location = lookup(name);
     if (location == -1)
-    {
-        std::cerr << "Invalid uniform location for: " << name << std::endl;
         return;
-    }
     glUniformMatrix4fv(location, 1, false, mat.data());
 }
 
@@ -3,6 +3,8 @@
 
 #pragma once
 
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "pmp/visualization/GL.h"
@@ -49,6 +51,14 @@ public:
     //! bind attribute to location
     void bind_attribute(const char* name, GLuint index);
 
+    //! bind the uniform block \p name to the uniform buffer binding point
+    //! \p binding, the binding is kept when the program is re-linked
+    void bind_uniform_block(const char* name, GLuint binding);
+
+    //! location of the uniform \p name, -1 if the program has no such
+    //! uniform. uses the table built at link time instead of querying OpenGL.
+    GLint uniform_location(const char* name) const;
+
     //! upload float uniform
     //! \param name string of the uniform name
     //! \param value the value for the uniform
@@ -99,11 +109,23 @@ private:
     //! relink: use this after setting/changing attrib location
     bool link();
 
+    //! query the locations of all active uniforms after linking
+    void cache_uniform_locations();
+
+    //! cached location for \p name, prints an error if there is none
+    GLint lookup(const char* name) const;
+
     //! id of the linked shader program
     GLint pid_;
 
     //! id of the vertex shader
     std::vector<GLint> shaders_;
+
+    //! uniform names and locations, sorted by name
+    std::vector<std::pair<std::string, GLint>> uniform_locations_;
+
+    //! uniform blocks and their binding points
+    std::vector<std::pair<std::string, GLuint>> uniform_blocks_;
 };
 
 } // namespace pmp
@@ -5,13 +5,61 @@
 
 #include <stb_image.h>
 
+#include <algorithm>
+#include <cfloat>
+
 #include "pmp/visualization/PhongShader.h"
 #include "pmp/visualization/MatCapShader.h"
 #include "pmp/visualization/ColdWarmTexture.h"
 #include "pmp/algorithms/SurfaceNormals.h"
+#include "pmp/MemoryUsage.h"
+#include "pmp/Trace.h"
 
 namespace pmp {
 
+namespace {
+
+// triangles are culled in chunks of this many consecutive triangles
+const size_t triangles_per_chunk = 4096;
+
+// replace counts[0..n-2] by their exclusive prefix sum, counts[n-1] has to be
+// zero and receives the total. blocks are summed in parallel.
+size_t prefix_sum(std::vector<IndexType>& counts)
+{
+    const int n = int(counts.size());
+    const int nblocks = std::min(n, 256);
+    const int bsize = (n + nblocks - 1) / std::max(nblocks, 1);
+    std::vector<IndexType> sums(nblocks + 1, 0);
+
+#pragma omp parallel for
+    for (int b = 0; b < nblocks; ++b)
+    {
+        IndexType sum = 0;
+        for (int i = b * bsize; i < std::min(n, (b + 1) * bsize); ++i)
+            sum += counts[i];
+        sums[b + 1] = sum;
+    }
+
+    for (int b = 0; b < nblocks; ++b)
+        sums[b + 1] += sums[b];
+
+#pragma omp parallel for
+    for (int b = 0; b < nblocks; ++b)
+    {
+        IndexType sum = sums[b];
+        for (int i = b * bsize; i < std::min(n, (b + 1) * bsize); ++i)
+        {
+            const IndexType c = counts[i];
+            counts[i] = sum;
+            sum += c;
+        }
+    }
+
+    return n ? counts[n - 1] : 0;
+}
+
+} // namespace
+
 SurfaceMeshGL::SurfaceMeshGL()
 {
     // initialize GL buffers to zero
@@ -19,6 +67,7 @@ SurfaceMeshGL::SurfaceMeshGL()
     vertex_buffer_ = 0;
     normal_buffer_ = 0;
     tex_coord_buffer_ = 0;
+    triangle_buffer_ = 0;
     edge_buffer_ = 0;
     feature_buffer_ = 0;
 
@@ -29,6 +78,10 @@ SurfaceMeshGL::SurfaceMeshGL()
     n_features_ = 0;
     have_texcoords_ = false;
 
+    // culling
+    frustum_culling_ = true;
+    backface_culling_ = false;
+
     // material parameters
     front_color_ = vec3(0.6, 0.6, 0.6);
     back_color_ = vec3(0.5, 0.0, 0.0);
@@ -51,6 +104,7 @@ SurfaceMeshGL::~SurfaceMeshGL()
     glDeleteBuffers(1, &vertex_buffer_);
     glDeleteBuffers(1, &normal_buffer_);
     glDeleteBuffers(1, &tex_coord_buffer_);
+    glDeleteBuffers(1, &triangle_buffer_);
     glDeleteBuffers(1, &edge_buffer_);
     glDeleteBuffers(1, &feature_buffer_);
     glDeleteVertexArrays(1, &vertex_array_object_);
@@ -222,12 +276,195 @@ void SurfaceMeshGL::set_crease_angle(Scalar ca)
     if (ca != crease_angle_)
     {
         crease_angle_ = std::max(Scalar(0), std::min(Scalar(180), ca));
-        update_opengl_buffers();
+        update_opengl_buffers(UpdateNormals);
+    }
+}
+
+void SurfaceMeshGL::compute_corner_normals(std::vector<vec3>& normals)
+{
+    normals.resize(halfedges_size());
+
+    if (crease_angle_ < 1)
+    {
+        const int nf = int(faces_size());
+        const bool garbage = has_garbage();
+#pragma omp parallel for
+        for (int i = 0; i < nf; ++i)
+        {
+            const Face f(i);
+            if (!garbage || !is_deleted(f))
+            {
+                const vec3 n =
+                    (vec3)SurfaceNormals::compute_face_normal(*this, f);
+                for (auto h : halfedges(f))
+                    normals[h.idx()] = n;
+            }
+        }
+    }
+    else if (crease_angle_ > 170)
+    {
+        const int nv = int(vertices_size());
+        const bool garbage = has_garbage();
+#pragma omp parallel for
+        for (int i = 0; i < nv; ++i)
+        {
+            const Vertex v(i);
+            if ((!garbage || !is_deleted(v)) && !is_isolated(v))
+            {
+                const vec3 n =
+                    (vec3)SurfaceNormals::compute_vertex_normal(*this, v);
+                for (auto h : halfedges(v))
+                    normals[prev_halfedge(h).idx()] = n;
+            }
+        }
+    }
+    else
+    {
+        // convert from degrees to radians
+        const Scalar creaseAngle = crease_angle_ / 180.0 * M_PI;
+
+        auto hnormals = add_halfedge_property<Normal>("gl:hnormal");
+        SurfaceNormals::compute_corner_normals(*this, creaseAngle, hnormals);
+        const auto& hn = hnormals.vector();
+#pragma omp parallel for
+        for (int i = 0; i < int(hn.size()); ++i)
+            normals[i] = (vec3)hn[i];
+        remove_halfedge_property(hnormals);
     }
 }
 
-void SurfaceMeshGL::update_opengl_buffers()
+bool SurfaceMeshGL::update_buffer_attributes(unsigned int what,
+                                             std::vector<vec3>& cornerNormals)
 {
+    PMP_TRACE_SCOPE("SurfaceMeshGL::update_buffer_attributes");
+    // the vertex layout has to match the current mesh
+    const size_t n = buffer_corners_.size();
+    if (!vertex_array_object_ || !n_faces() || n != size_t(n_vertices_) ||
+        corner_indices_.size() != halfedges_size())
+        return false;
+
+    // polygons have to be re-triangulated if positions changed
+    if ((what & UpdatePositions) && face_triangles_.size() != n_faces())
+        return false;
+
+    const auto vpos = get_vertex_property<Point>("v:point");
+    const auto vtex = get_vertex_property<TexCoord>("v:tex");
+    const auto htex = get_halfedge_property<TexCoord>("h:tex");
+    const bool hasTexCoords = htex || vtex;
+
+    // normals and texture coordinates together determine the layout:
+    // corners sharing an OpenGL vertex have to agree on them, and different
+    // OpenGL vertices of a mesh vertex have to differ in at least one of them.
+    // otherwise the layout has to be rebuilt.
+    std::vector<vec3> normalArray;
+    std::vector<vec2> texArray;
+    if (what & (UpdateNormals | UpdateTexCoords))
+    {
+        if (hasTexCoords != have_texcoords_)
+            return false;
+
+        compute_corner_normals(cornerNormals);
+        auto cornerTexCoord = [&](Halfedge h) {
+            return htex ? (vec2)htex[h] : (vec2)vtex[to_vertex(h)];
+        };
+
+        normalArray.resize(n);
+        if (hasTexCoords)
+            texArray.resize(n);
+#pragma omp parallel for
+        for (int i = 0; i < int(n); ++i)
+        {
+            normalArray[i] = cornerNormals[buffer_corners_[i].idx()];
+            if (hasTexCoords)
+                texArray[i] = cornerTexCoord(buffer_corners_[i]);
+        }
+
+        auto same = [&](size_t i, size_t j) {
+            return normalArray[i] == normalArray[j] &&
+                   (!hasTexCoords || texArray[i] == texArray[j]);
+        };
+
+        bool valid = true;
+        const int nh = int(halfedges_size());
+        const bool garbage = has_garbage();
+#pragma omp parallel for reduction(&& : valid)
+        for (int i = 0; i < nh; ++i)
+        {
+            const Halfedge h(i);
+            if ((garbage && is_deleted(h)) || is_boundary(h))
+                continue;
+            const size_t idx = corner_indices_[i];
+            if (cornerNormals[i] != normalArray[idx] ||
+                (hasTexCoords && cornerTexCoord(h) != texArray[idx]))
+                valid = false;
+        }
+        if (!valid)
+            return false;
+
+        // the OpenGL vertices of a mesh vertex are stored consecutively
+        for (size_t i = 0, j = 0; i < n; i = j)
+        {
+            const Vertex v = to_vertex(buffer_corners_[i]);
+            for (j = i + 1; j < n && to_vertex(buffer_corners_[j]) == v; ++j)
+                for (size_t k = i; k < j; ++k)
+                    if (same(k, j))
+                        return false;
+        }
+    }
+
+    // upload what has changed
+    if (what & UpdatePositions)
+    {
+        std::vector<vec3> positionArray(n);
+#pragma omp parallel for
+        for (int i = 0; i < int(n); ++i)
+            positionArray[i] = (vec3)vpos[to_vertex(buffer_corners_[i])];
+
+        glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, n * 3 * sizeof(float),
+                        positionArray.data());
+
+        // the triangles stay in their chunks, only the bounds change
+        update_chunks(positionArray);
+    }
+
+    if (!normalArray.empty())
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, normal_buffer_);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, n * 3 * sizeof(float),
+                        normalArray.data());
+    }
+
+    if (!texArray.empty())
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, tex_coord_buffer_);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, n * 2 * sizeof(float),
+                        texArray.data());
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void SurfaceMeshGL::update_opengl_buffers(unsigned int what)
+{
+    PMP_TRACE_SCOPE("SurfaceMeshGL::update_opengl_buffers");
+    MemoryScope memory("SurfaceMeshGL::update_opengl_buffers");
+
+    // new positions require new normals
+    if (what & UpdatePositions)
+        what |= UpdateNormals;
+
+    // try to update only the changed attributes. if this fails, the corner
+    // normals it computed are reused below.
+    std::vector<vec3> cornerNormals;
+    if (!(what & UpdateTopology) &&
+        update_buffer_attributes(what, cornerNormals))
+    {
+        memory.set_gpu(gpu_memory());
+        return;
+    }
+
     // are buffers already initialized?
     if (!vertex_array_object_)
     {
@@ -236,6 +473,7 @@ void SurfaceMeshGL::update_opengl_buffers()
         glGenBuffers(1, &vertex_buffer_);
         glGenBuffers(1, &normal_buffer_);
         glGenBuffers(1, &tex_coord_buffer_);
+        glGenBuffers(1, &triangle_buffer_);
         glGenBuffers(1, &edge_buffer_);
         glGenBuffers(1, &feature_buffer_);
     }
@@ -244,159 +482,252 @@ void SurfaceMeshGL::update_opengl_buffers()
     glBindVertexArray(vertex_array_object_);
 
     // get vertex properties
-    auto vpos = get_vertex_property<Point>("v:point");
-    auto vtex = get_vertex_property<TexCoord>("v:tex");
-    auto htex = get_halfedge_property<TexCoord>("h:tex");
+    const auto vpos = get_vertex_property<Point>("v:point");
+    const auto vtex = get_vertex_property<TexCoord>("v:tex");
+    const auto htex = get_halfedge_property<TexCoord>("h:tex");
 
     // index array for remapping vertex indices during duplication
     auto vertex_indices = add_vertex_property<size_t>("v:index");
 
-    // produce arrays of points, normals, and texcoords
-    // (duplicate vertices to allow for flat shading)
+    // produce arrays of points, normals, texcoords, and triangle indices
+    // (duplicate vertices at creases to allow for flat shading)
     std::vector<vec3> positionArray;
     std::vector<vec3> normalArray;
     std::vector<vec2> texArray;
+    std::vector<unsigned int> triangleArray;
     std::vector<ivec3> triangles;
 
-    // we have a mesh: fill arrays by looping over faces
+    // we have a mesh: fill arrays by looping over vertices and faces
     if (n_faces())
     {
-        // reserve memory
-        positionArray.reserve(3 * n_faces());
-        normalArray.reserve(3 * n_faces());
-        if (htex || vtex)
-            texArray.reserve(3 * n_faces());
-
-        // precompute normals for easy cases
-        FaceProperty<Normal> fnormals;
-        VertexProperty<Normal> vnormals;
-        if (crease_angle_ < 1)
-        {
-            fnormals = add_face_property<Normal>("gl:fnormal");
-            for (auto f : faces())
-                fnormals[f] = SurfaceNormals::compute_face_normal(*this, f);
-        }
-        else if (crease_angle_ > 170)
+        // normal of each corner, indexed by halfedge
+        PMP_TRACE_STAGES(stage, "corner normals");
+        if (cornerNormals.size() != halfedges_size())
+            compute_corner_normals(cornerNormals);
+
+        // texture coordinate of the corner at to_vertex(h)
+        const bool hasTexCoords = htex || vtex;
+        auto cornerTexCoord = [&](Halfedge h) {
+            if (htex)
+                return (vec2)htex[h];
+            else if (vtex)
+                return (vec2)vtex[to_vertex(h)];
+            else
+                return vec2(0, 0);
+        };
+
+        // corners around a vertex share their OpenGL vertex if normal and
+        // texture coordinate agree, i.e., vertices are only duplicated at
+        // creases and texture seams. the layout is kept for partial updates.
+        // first pass: count the OpenGL vertices of each vertex and store the
+        // local index of each corner.
+        PMP_TRACE_NEXT(stage, "vertex layout");
+        const int nv = int(vertices_size());
+        const bool garbage = has_garbage();
+        std::vector<IndexType> vertexOffsets(nv + 1, 0);
+        corner_indices_.assign(halfedges_size(), 0);
+#pragma omp parallel
         {
-            vnormals = add_vertex_property<Normal>("gl:vnormal");
-            for (auto v : vertices())
-                vnormals[v] = SurfaceNormals::compute_vertex_normal(*this, v);
-        }
-
-        // data per face (for all corners)
-        std::vector<Halfedge> cornerHalfedges;
-        std::vector<Vertex> cornerVertices;
-        std::vector<vec3> cornerPositions;
-        std::vector<vec3> cornerNormals;
-        std::vector<vec2> cornerTexCoords;
-
-        // convert from degrees to radians
-        const Scalar creaseAngle = crease_angle_ / 180.0 * M_PI;
+            std::vector<Halfedge> distinct;
+#pragma omp for
+            for (int i = 0; i < nv; ++i)
+            {
+                const Vertex v(i);
+                if ((garbage && is_deleted(v)) || is_isolated(v))
+                    continue;
 
-        size_t vidx(0);
+                distinct.clear();
+                for (auto h : halfedges(v))
+                {
+                    if (is_boundary(h))
+                        continue;
+
+                    // corner of v in face(h)
+                    const Halfedge c = prev_halfedge(h);
+                    const vec3& n = cornerNormals[c.idx()];
+                    const vec2 t = cornerTexCoord(c);
+
+                    size_t idx = 0;
+                    for (; idx < distinct.size(); ++idx)
+                    {
+                        const Halfedge d = distinct[idx];
+                        if (cornerNormals[d.idx()] == n &&
+                            (!hasTexCoords || cornerTexCoord(d) == t))
+                            break;
+                    }
+                    if (idx == distinct.size())
+                        distinct.push_back(c);
+                    corner_indices_[c.idx()] = idx;
+                }
+                vertexOffsets[i] = distinct.size();
+            }
+        }
 
-        // loop over all faces
-        for (auto f : faces())
+        // second pass: write the OpenGL vertices at their final positions.
+        // a corner is the first of its OpenGL vertex if its local index is
+        // the number of OpenGL vertices seen so far.
+        const size_t nb = prefix_sum(vertexOffsets);
+        positionArray.resize(nb);
+        normalArray.resize(nb);
+        if (hasTexCoords)
+            texArray.resize(nb);
+        buffer_corners_.resize(nb);
+        auto& vertexIndices = vertex_indices.vector();
+#pragma omp parallel for
+        for (int i = 0; i < nv; ++i)
         {
-            // collect corner positions and normals
-            cornerHalfedges.clear();
-            cornerVertices.clear();
-            cornerPositions.clear();
-            cornerNormals.clear();
-            cornerTexCoords.clear();
-            Vertex v;
-            Normal n;
-
-            for (auto h : halfedges(f))
+            const Vertex v(i);
+            const IndexType first = vertexOffsets[i];
+            vertexIndices[i] = first;
+            if (vertexOffsets[i + 1] == first)
+                continue;
+
+            const vec3 p = (vec3)vpos[v];
+            IndexType seen = 0;
+            for (auto h : halfedges(v))
             {
-                v = to_vertex(h);
-                cornerHalfedges.push_back(h);
-                cornerVertices.push_back(v);
-                cornerPositions.push_back((vec3)vpos[v]);
+                if (is_boundary(h))
+                    continue;
 
-                if (crease_angle_ < 1)
-                {
-                    n = fnormals[f];
-                }
-                else if (crease_angle_ > 170)
-                {
-                    n = vnormals[v];
-                }
-                else
+                const Halfedge c = prev_halfedge(h);
+                const IndexType idx = first + corner_indices_[c.idx()];
+                if (corner_indices_[c.idx()] == seen)
                 {
-                    n = SurfaceNormals::compute_corner_normal(*this, h,
-                                                              creaseAngle);
+                    positionArray[idx] = p;
+                    normalArray[idx] = cornerNormals[c.idx()];
+                    if (hasTexCoords)
+                        texArray[idx] = cornerTexCoord(c);
+                    buffer_corners_[idx] = c;
+                    ++seen;
                 }
-                cornerNormals.push_back((vec3)n);
+                corner_indices_[c.idx()] = idx;
+            }
+        }
 
-                if (htex)
-                {
-                    cornerTexCoords.push_back((vec2)htex[h]);
-                }
-                else if (vtex)
+        // number of triangles per face is known from its valence
+        PMP_TRACE_NEXT(stage, "triangulate");
+        const int nf = int(faces_size());
+        std::vector<IndexType> faceOffsets(nf + 1, 0);
+#pragma omp parallel for
+        for (int i = 0; i < nf; ++i)
+        {
+            const Face f(i);
+            if (!garbage || !is_deleted(f))
+                faceOffsets[i] = valence(f) - 2;
+        }
+        const size_t nt = prefix_sum(faceOffsets);
+        triangleArray.resize(3 * nt);
+
+        // triangulate the faces only if positions or topology changed,
+        // otherwise reuse the cached triangulations
+        if ((what & (UpdatePositions | UpdateTopology)) ||
+            face_triangles_.size() != nt)
+        {
+            face_triangles_.resize(nt);
+
+            // store the triangles of each face in its range of the cache.
+            // tesselate() is thread-safe for triangles and quads only, larger
+            // polygons are handled serially below.
+            auto triangulate = [&](Face f, std::vector<vec3>& cornerPositions,
+                                   std::vector<ivec3>& triangles) {
+                cornerPositions.clear();
+                for (auto h : halfedges(f))
+                    cornerPositions.push_back((vec3)vpos[to_vertex(h)]);
+                assert(cornerPositions.size() >= 3);
+
+                tesselate(cornerPositions, triangles);
+                std::copy(triangles.begin(), triangles.end(),
+                          face_triangles_.begin() + faceOffsets[f.idx()]);
+            };
+
+#pragma omp parallel
+            {
+                std::vector<vec3> cornerPositions;
+                std::vector<ivec3> faceTriangles;
+#pragma omp for
+                for (int i = 0; i < nf; ++i)
                 {
-                    cornerTexCoords.push_back((vec2)vtex[v]);
+                    const IndexType n = faceOffsets[i + 1] - faceOffsets[i];
+                    if (n > 0 && n <= 2)
+                        triangulate(Face(i), cornerPositions, faceTriangles);
                 }
             }
-            assert(cornerVertices.size() >= 3);
 
-            // tessellate face into triangles
-            tesselate(cornerPositions, triangles);
-            for (auto& t : triangles)
+            std::vector<vec3> cornerPositions;
+            for (int i = 0; i < nf; ++i)
             {
-                int i0 = t[0];
-                int i1 = t[1];
-                int i2 = t[2];
+                if (faceOffsets[i + 1] - faceOffsets[i] > 2)
+                    triangulate(Face(i), cornerPositions, triangles);
+            }
+        }
 
-                positionArray.push_back(cornerPositions[i0]);
-                positionArray.push_back(cornerPositions[i1]);
-                positionArray.push_back(cornerPositions[i2]);
+        // map the triangles' corners to OpenGL vertices
+        PMP_TRACE_NEXT(stage, "triangle indices");
+#pragma omp parallel
+        {
+            std::vector<unsigned int> cornerIndices;
+#pragma omp for
+            for (int i = 0; i < nf; ++i)
+            {
+                const Face f(i);
+                if (faceOffsets[i + 1] == faceOffsets[i])
+                    continue;
 
-                normalArray.push_back(cornerNormals[i0]);
-                normalArray.push_back(cornerNormals[i1]);
-                normalArray.push_back(cornerNormals[i2]);
+                cornerIndices.clear();
+                for (auto h : halfedges(f))
+                    cornerIndices.push_back(corner_indices_[h.idx()]);
 
-                if (htex || vtex)
+                for (IndexType j = faceOffsets[i]; j < faceOffsets[i + 1]; ++j)
                 {
-                    texArray.push_back(cornerTexCoords[i0]);
-                    texArray.push_back(cornerTexCoords[i1]);
-                    texArray.push_back(cornerTexCoords[i2]);
+                    const ivec3& t = face_triangles_[j];
+                    triangleArray[3 * j] = cornerIndices[t[0]];
+                    triangleArray[3 * j + 1] = cornerIndices[t[1]];
+                    triangleArray[3 * j + 2] = cornerIndices[t[2]];
                 }
-
-                vertex_indices[cornerVertices[i0]] = vidx++;
-                vertex_indices[cornerVertices[i1]] = vidx++;
-                vertex_indices[cornerVertices[i2]] = vidx++;
             }
         }
 
-        // clean up
-        if (vnormals)
-            remove_vertex_property(vnormals);
-        if (fnormals)
-            remove_face_property(fnormals);
+        // group nearby triangles into chunks for culling
+        PMP_TRACE_NEXT(stage, "sort triangles");
+        sort_triangles(positionArray, triangleArray);
     }
 
     // we have a point cloud
     else if (n_vertices())
     {
-        auto position = vertex_property<Point>("v:point");
+        corner_indices_.clear();
+        buffer_corners_.clear();
+        face_triangles_.clear();
+
+        const auto position = get_vertex_property<Point>("v:point");
         if (position)
         {
-            positionArray.reserve(n_vertices());
-            for (auto v : vertices())
-                positionArray.push_back((vec3)position[v]);
+            if (!has_garbage())
+                positionArray = position.vector();
+            else
+            {
+                positionArray.reserve(n_vertices());
+                for (auto v : vertices())
+                    positionArray.push_back((vec3)position[v]);
+            }
         }
 
-        auto normals = get_vertex_property<Point>("v:normal");
+        const auto normals = get_vertex_property<Point>("v:normal");
         if (normals)
         {
-            normalArray.reserve(n_vertices());
-            for (auto v : vertices())
-                normalArray.push_back((vec3)normals[v]);
+            if (!has_garbage())
+                normalArray = normals.vector();
+            else
+            {
+                normalArray.reserve(n_vertices());
+                for (auto v : vertices())
+                    normalArray.push_back((vec3)normals[v]);
+            }
         }
     }
 
     // upload vertices
+    PMP_TRACE_SCOPE("upload");
     if (!positionArray.empty())
     {
         glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_);
@@ -432,6 +763,22 @@ void SurfaceMeshGL::update_opengl_buffers()
     else
         have_texcoords_ = false;
 
+    // upload triangle indices
+    if (!triangleArray.empty())
+    {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, triangle_buffer_);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     triangleArray.size() * sizeof(unsigned int),
+                     triangleArray.data(), GL_STATIC_DRAW);
+        n_triangles_ = triangleArray.size() / 3;
+    }
+    else
+        n_triangles_ = 0;
+
+    // keep the triangles to update the bounds of their chunks
+    chunk_triangles_.swap(triangleArray);
+    update_chunks(positionArray);
+
     // edge indices
     if (n_edges())
     {
@@ -480,6 +827,29 @@ void SurfaceMeshGL::update_opengl_buffers()
 
     // remove vertex index property again
     remove_vertex_property(vertex_indices);
+
+    memory.set_gpu(gpu_memory());
+}
+
+size_t SurfaceMeshGL::gpu_memory() const
+{
+    if (!vertex_array_object_)
+        return 0;
+
+    // GL_COPY_READ_BUFFER does not touch the element buffer of the VAO
+    const GLuint buffers[] = {vertex_buffer_,   normal_buffer_,
+                              tex_coord_buffer_, triangle_buffer_,
+                              edge_buffer_,     feature_buffer_};
+    size_t bytes = 0;
+    for (GLuint buffer : buffers)
+    {
+        GLint size = 0;
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+        bytes += size;
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    return bytes;
 }
 
 void SurfaceMeshGL::draw(const mat4& projection_matrix,
@@ -497,6 +867,8 @@ void SurfaceMeshGL::draw(const mat4& projection_matrix,
     {
         if (!phong_shader_.source(phong_vshader, phong_fshader))
             exit(1);
+        phong_shader_.bind_uniform_block(FrameUniforms::block_name,
+                                         FrameUniforms::binding_point);
     }
 
     // load shader?
@@ -504,6 +876,8 @@ void SurfaceMeshGL::draw(const mat4& projection_matrix,
     {
         if (!matcap_shader_.source(matcap_vshader, matcap_fshader))
             exit(1);
+        matcap_shader_.bind_uniform_block(FrameUniforms::block_name,
+                                          FrameUniforms::binding_point);
     }
 
     // we need some texture, otherwise WebGL complains
@@ -516,22 +890,19 @@ void SurfaceMeshGL::draw(const mat4& projection_matrix,
     if (is_empty())
         return;
 
+    // determine the visible triangles
+    cull_chunks(projection_matrix, modelview_matrix);
+
     // allow for transparent objects
     glEnable(GL_SAMPLE_ALPHA_TO_COVERAGE);
 
-    // setup matrices
-    mat4 mv_matrix = modelview_matrix;
-    mat4 mvp_matrix = projection_matrix * modelview_matrix;
-    mat3 n_matrix = inverse(transpose(linear_part(mv_matrix)));
+    // setup matrices and lights
+    frame_uniforms_.update(projection_matrix, modelview_matrix,
+                           vec3(1.0, 1.0, 1.0), vec3(-1.0, 1.0, 1.0));
 
     // setup shader
     phong_shader_.use();
-    phong_shader_.set_uniform("modelview_projection_matrix", mvp_matrix);
-    phong_shader_.set_uniform("modelview_matrix", mv_matrix);
-    phong_shader_.set_uniform("normal_matrix", n_matrix);
     phong_shader_.set_uniform("point_size", 5.0f);
-    phong_shader_.set_uniform("light1", vec3(1.0, 1.0, 1.0));
-    phong_shader_.set_uniform("light2", vec3(-1.0, 1.0, 1.0));
     phong_shader_.set_uniform("front_color", front_color_);
     phong_shader_.set_uniform("back_color", back_color_);
     phong_shader_.set_uniform("ambient", ambient_);
@@ -560,7 +931,7 @@ void SurfaceMeshGL::draw(const mat4& projection_matrix,
         {
             // draw faces
             glDepthRange(0.01, 1.0);
-            glDrawArrays(GL_TRIANGLES, 0, n_vertices_);
+            draw_triangles();
             glDisable(GL_SAMPLE_ALPHA_TO_COVERAGE);
 
             // overlay edges
@@ -579,7 +950,7 @@ void SurfaceMeshGL::draw(const mat4& projection_matrix,
     {
         if (n_faces())
         {
-            glDrawArrays(GL_TRIANGLES, 0, n_vertices_);
+            draw_triangles();
         }
     }
 
@@ -602,12 +973,9 @@ void SurfaceMeshGL::draw(const mat4& projection_matrix,
             if (texture_mode_ == MatCapTexture)
             {
                 matcap_shader_.use();
-                matcap_shader_.set_uniform("modelview_projection_matrix",
-                                           mvp_matrix);
-                matcap_shader_.set_uniform("normal_matrix", n_matrix);
                 matcap_shader_.set_uniform("alpha", alpha_);
                 glBindTexture(GL_TEXTURE_2D, texture_);
-                glDrawArrays(GL_TRIANGLES, 0, n_vertices_);
+                draw_triangles();
             }
             else
             {
@@ -616,7 +984,7 @@ void SurfaceMeshGL::draw(const mat4& projection_matrix,
                 phong_shader_.set_uniform("use_texture", true);
                 phong_shader_.set_uniform("use_srgb", srgb_);
                 glBindTexture(GL_TEXTURE_2D, texture_);
-                glDrawArrays(GL_TRIANGLES, 0, n_vertices_);
+                draw_triangles();
             }
         }
     }
@@ -632,7 +1000,7 @@ void SurfaceMeshGL::draw(const mat4& projection_matrix,
             phong_shader_.set_uniform("front_color", vec3(0.8, 0.8, 0.8));
             phong_shader_.set_uniform("back_color", vec3(0.9, 0.0, 0.0));
             glDepthRange(0.01, 1.0);
-            glDrawArrays(GL_TRIANGLES, 0, n_vertices_);
+            draw_triangles();
 
             // overlay edges
             glDepthRange(0.0, 1.0);
@@ -666,6 +1034,159 @@ void SurfaceMeshGL::draw(const mat4& projection_matrix,
     glCheckError();
 }
 
+void SurfaceMeshGL::sort_triangles(const std::vector<vec3>& positions,
+                                   std::vector<unsigned int>& triangles) const
+{
+    const size_t nt = triangles.size() / 3;
+    if (nt <= triangles_per_chunk)
+        return;
+
+    // quantize x to 5 bits and spread them such that two zeros follow
+    // each bit
+    auto spread = [](float s) {
+        uint32_t x = uint32_t(std::min(std::max(s, 0.0f), 31.0f));
+        x = (x | x << 8) & 0x0000f00f;
+        x = (x | x << 4) & 0x000c30c3;
+        x = (x | x << 2) & 0x00049249;
+        return x;
+    };
+
+    // quantize centroids to the largest extent of the bounding box
+    vec3 bbmin(FLT_MAX), bbmax(-FLT_MAX);
+    for (const vec3& p : positions)
+    {
+        bbmin = min(bbmin, p);
+        bbmax = max(bbmax, p);
+    }
+    const vec3 ext = bbmax - bbmin;
+    const float maxext = std::max(ext[0], std::max(ext[1], ext[2]));
+    const float scale = maxext > 0 ? 32.0f / maxext : 0;
+
+    // Morton code of the cell of each triangle. a chunk only has to be
+    // compact, not ordered within, hence the triangles are just grouped by
+    // cell, which is linear in their number.
+    const size_t n_cells = 1 << 15;
+    std::vector<uint32_t> cell(nt);
+#pragma omp parallel for
+    for (int i = 0; i < int(nt); ++i)
+    {
+        const vec3 c = (positions[triangles[3 * i]] +
+                        positions[triangles[3 * i + 1]] +
+                        positions[triangles[3 * i + 2]]) /
+                       3.0f;
+        const vec3 p = (c - bbmin) * scale;
+        cell[i] = spread(p[0]) | spread(p[1]) << 1 | spread(p[2]) << 2;
+    }
+
+    // counting sort, stable to keep the order deterministic
+    std::vector<size_t> offsets(n_cells + 1, 0);
+    for (uint32_t c : cell)
+        ++offsets[c + 1];
+    for (size_t c = 0; c < n_cells; ++c)
+        offsets[c + 1] += offsets[c];
+
+    std::vector<unsigned int> sorted(3 * nt);
+    for (size_t i = 0; i < nt; ++i)
+    {
+        const size_t j = offsets[cell[i]]++;
+        sorted[3 * j] = triangles[3 * i];
+        sorted[3 * j + 1] = triangles[3 * i + 1];
+        sorted[3 * j + 2] = triangles[3 * i + 2];
+    }
+    triangles.swap(sorted);
+}
+
+void SurfaceMeshGL::update_chunks(const std::vector<vec3>& positions)
+{
+    PMP_TRACE_SCOPE("SurfaceMeshGL::update_chunks");
+
+    const size_t nt = chunk_triangles_.size() / 3;
+    const int nc = int((nt + triangles_per_chunk - 1) / triangles_per_chunk);
+    chunks_.resize(nc);
+
+#pragma omp parallel
+    {
+        std::vector<vec3> normals;
+#pragma omp for
+        for (int i = 0; i < nc; ++i)
+        {
+            const size_t begin = i * triangles_per_chunk;
+            const size_t end = std::min(begin + triangles_per_chunk, nt);
+            TriangleChunk& chunk = chunks_[i];
+            chunk.bbmin = vec3(FLT_MAX);
+            chunk.bbmax = vec3(-FLT_MAX);
+            normals.clear();
+            for (size_t j = begin; j < end; ++j)
+            {
+                const vec3& p0 = positions[chunk_triangles_[3 * j]];
+                const vec3& p1 = positions[chunk_triangles_[3 * j + 1]];
+                const vec3& p2 = positions[chunk_triangles_[3 * j + 2]];
+                chunk.bbmin = min(chunk.bbmin, min(p0, min(p1, p2)));
+                chunk.bbmax = max(chunk.bbmax, max(p0, max(p1, p2)));
+
+                // degenerate triangles get a zero normal
+                const vec3 n = cross(p1 - p0, p2 - p0);
+                const float length = norm(n);
+                normals.push_back(length > 0 ? n / length : vec3(0, 0, 0));
+            }
+            chunk.cone = NormalCone(normals.data(), normals.size());
+        }
+    }
+}
+
+void SurfaceMeshGL::cull_chunks(const mat4& projection_matrix,
+                                const mat4& modelview_matrix)
+{
+    draw_ranges_.clear();
+    culling_stats_ = CullingStats();
+
+    // the frustum and the eye in object coordinates
+    const Frustum frustum(projection_matrix * modelview_matrix);
+    const vec4 e = inverse(modelview_matrix) * vec4(0, 0, 0, 1);
+    const vec3 eye(e[0] / e[3], e[1] / e[3], e[2] / e[3]);
+
+    const size_t nt = chunk_triangles_.size() / 3;
+    for (size_t i = 0; i < chunks_.size(); ++i)
+    {
+        const TriangleChunk& chunk = chunks_[i];
+        if (frustum_culling_ && frustum.is_outside(chunk.bbmin, chunk.bbmax))
+        {
+            ++culling_stats_.outside;
+            continue;
+        }
+        if (backface_culling_ &&
+            chunk.cone.is_backfacing(eye, 0.5f * (chunk.bbmin + chunk.bbmax),
+                                     0.5f * distance(chunk.bbmin, chunk.bbmax)))
+        {
+            ++culling_stats_.backface;
+            continue;
+        }
+        ++culling_stats_.visible;
+
+        // draw consecutive visible chunks at once
+        const size_t begin = i * triangles_per_chunk;
+        const size_t end = std::min(begin + triangles_per_chunk, nt);
+        const GLsizei first = GLsizei(3 * begin);
+        const GLsizei count = GLsizei(3 * (end - begin));
+        if (!draw_ranges_.empty() &&
+            draw_ranges_.back().first + draw_ranges_.back().second == first)
+            draw_ranges_.back().second += count;
+        else
+            draw_ranges_.push_back(std::make_pair(first, count));
+    }
+}
+
+void SurfaceMeshGL::draw_triangles()
+{
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, triangle_buffer_);
+    for (const auto& range : draw_ranges_)
+    {
+        glDrawElements(GL_TRIANGLES, range.second, GL_UNSIGNED_INT,
+                       reinterpret_cast<const void*>(size_t(range.first) *
+                                                     sizeof(unsigned int)));
+    }
+}
+
 void SurfaceMeshGL::tesselate(const std::vector<vec3>& points,
                               std::vector<ivec3>& triangles)
 {
@@ -6,6 +6,8 @@
 #include <limits>
 
 #include "pmp/SurfaceMesh.h"
+#include "pmp/visualization/Culling.h"
+#include "pmp/visualization/FrameUniforms.h"
 #include "pmp/visualization/GL.h"
 #include "pmp/visualization/Shader.h"
 #include "pmp/MatVec.h"
@@ -67,8 +69,46 @@ public:
     void draw(const mat4& projection_matrix, const mat4& modelview_matrix,
               const std::string draw_mode);
 
-    //! update all opengl buffers for efficient core profile rendering
-    void update_opengl_buffers();
+    //! parts of the mesh that changed, see update_opengl_buffers()
+    enum BufferUpdate
+    {
+        UpdatePositions = 0x01, //!< vertex positions (implies normals)
+        UpdateNormals = 0x02,   //!< normals, e.g., changed crease angle
+        UpdateTexCoords = 0x04, //!< texture coordinates (implies normals)
+        UpdateTopology = 0x08,  //!< connectivity, rebuilds all buffers
+        UpdateAll = 0x0F
+    };
+
+    //! update opengl buffers for efficient core profile rendering.
+    //! \details Only the attributes given by \p what are regenerated and
+    //! uploaded with glBufferSubData(). All buffers are rebuilt if the
+    //! topology changed or if corners sharing an OpenGL vertex no longer
+    //! agree on normal or texture coordinate. Polygons are re-triangulated
+    //! only if positions or topology changed.
+    void update_opengl_buffers(unsigned int what = UpdateAll);
+
+    //! skip chunks of triangles outside the view frustum when drawing
+    void set_frustum_culling(bool b) { frustum_culling_ = b; }
+    //! are chunks of triangles outside the view frustum skipped?
+    bool frustum_culling() const { return frustum_culling_; }
+
+    //! skip chunks of triangles that face away from the viewer when drawing.
+    //! back faces are not drawn then, which is only correct for closed
+    //! meshes.
+    void set_backface_culling(bool b) { backface_culling_ = b; }
+    //! are chunks of triangles facing away from the viewer skipped?
+    bool backface_culling() const { return backface_culling_; }
+
+    //! number of chunks of triangles drawn and culled by the last draw()
+    const CullingStats& culling_stats() const { return culling_stats_; }
+
+    //! number of vertices in the OpenGL buffers. corners share a vertex unless
+    //! they differ in normal or texture coordinate (creases, texture seams).
+    size_t n_buffer_vertices() const { return n_vertices_; }
+
+    //! bytes allocated in the OpenGL buffers (vertex attributes and indices),
+    //! queried from OpenGL, so the context has to be current
+    size_t gpu_memory() const;
 
     //! use color map to visualize scalar fields
     void use_cold_warm_texture();
@@ -136,12 +176,67 @@ private: // helpers for computing triangulation of a polygon
     void tesselate(const std::vector<vec3>& points,
                    std::vector<ivec3>& triangles);
 
+private: // helpers for partial buffer updates
+    // compute the normal of each corner, indexed by halfedge
+    void compute_corner_normals(std::vector<vec3>& normals);
+
+    // update the given attributes of the current vertex layout,
+    // returns false if the layout has to be rebuilt
+    bool update_buffer_attributes(unsigned int what,
+                                  std::vector<vec3>& cornerNormals);
+
+    // OpenGL vertex of each corner, indexed by halfedge
+    std::vector<unsigned int> corner_indices_;
+
+    // one corner per OpenGL vertex
+    std::vector<Halfedge> buffer_corners_;
+
+    // cached triangulation of all faces (as local corner indices), the
+    // triangles of a face are stored consecutively in face order
+    std::vector<ivec3> face_triangles_;
+
+private: // helpers for culling
+    // sort the triangles along a Morton curve through their centroids, such
+    // that chunks of consecutive triangles are spatially compact
+    void sort_triangles(const std::vector<vec3>& positions,
+                        std::vector<unsigned int>& triangles) const;
+
+    // compute bounding boxes and normal cones of the chunks
+    void update_chunks(const std::vector<vec3>& positions);
+
+    // determine the ranges of triangles to be drawn
+    void cull_chunks(const mat4& projection_matrix,
+                     const mat4& modelview_matrix);
+
+    // draw the triangles of the visible chunks
+    void draw_triangles();
+
+    // bounds of a chunk of consecutive triangles
+    struct TriangleChunk
+    {
+        vec3 bbmin, bbmax;
+        NormalCone cone;
+    };
+
+    // vertex indices of the triangles as in the triangle buffer
+    std::vector<unsigned int> chunk_triangles_;
+
+    // bounds of the chunks of triangles
+    std::vector<TriangleChunk> chunks_;
+
+    // ranges (first index, number of indices) of the visible triangles
+    std::vector<std::pair<GLsizei, GLsizei>> draw_ranges_;
+
+    bool frustum_culling_, backface_culling_;
+    CullingStats culling_stats_;
+
 private:
     //! OpenGL buffers
     GLuint vertex_array_object_;
     GLuint vertex_buffer_;
     GLuint normal_buffer_;
     GLuint tex_coord_buffer_;
+    GLuint triangle_buffer_;
     GLuint edge_buffer_;
     GLuint feature_buffer_;
 
@@ -156,6 +251,9 @@ private:
     Shader phong_shader_;
     Shader matcap_shader_;
 
+    //! matrices and lights shared by both shaders
+    FrameUniforms frame_uniforms_;
+
     //! material properties
     vec3 front_color_, back_color_;
     float ambient_, diffuse_, specular_, shininess_, alpha_;
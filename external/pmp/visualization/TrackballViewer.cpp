@@ -104,6 +104,14 @@ void TrackballViewer::resize(int width, int height)
     glViewport(0, 0, width, height);
 }
 
+void TrackballViewer::capture_step(unsigned int /*frame*/,
+                                   unsigned int n_frames)
+{
+    // one full turn around the vertical axis, the last frame shows the
+    // initial view
+    rotate(vec3(0, 1, 0), 360.0f / n_frames);
+}
+
 void TrackballViewer::display()
 {
     // clear buffers
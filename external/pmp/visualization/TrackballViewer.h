@@ -50,6 +50,10 @@ protected:
     //! this function is called if the window is resized
     virtual void resize(int width, int height) override;
 
+    //! turn the scene around the vertical axis while recording frames
+    virtual void capture_step(unsigned int frame,
+                              unsigned int n_frames) override;
+
 protected:
     //! reset the list of draw modes
     void clear_draw_modes();
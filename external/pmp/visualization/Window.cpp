@@ -2,6 +2,7 @@
 // Distributed under a MIT-style license, see LICENSE.txt for details.
 
 #include "Window.h"
+#include "pmp/Trace.h"
 #include <algorithm>
 
 #define IMGUI_DISABLE_OBSOLETE_FUNCTIONS
@@ -9,7 +10,6 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 #include <lato-font.h>
-#include <stb_image_write.h>
 
 #if __EMSCRIPTEN__
 #include <emscripten/emscripten.h>
@@ -28,7 +28,15 @@ Window::Window(const char* title, int width, int height, bool showgui)
       show_imgui_(showgui),
       imgui_scale_(1.0),
       show_help_(false),
-      screenshot_number_(0)
+      screenshot_number_(0),
+      capture_frame_(0),
+      capture_n_frames_(0),
+      redraw_frames_(0),
+      continuous_rendering_(false),
+      frame_times_(120, FrameTimes{0, 0, 0, 0, 0}),
+      frames_rendered_(0),
+      idle_time_(0),
+      refresh_rate_(60)
 {
     // initialize glfw window
     if (!glfwInit())
@@ -85,6 +93,11 @@ Window::Window(const char* title, int width, int height, bool showgui)
 
     // enable v-sync
     glfwSwapInterval(1);
+#ifndef __EMSCRIPTEN__
+    const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    if (mode && mode->refreshRate > 0)
+        refresh_rate_ = mode->refreshRate;
+#endif
 
     // now that we have a GL context, initialize GLEW
     glewExperimental = GL_TRUE;
@@ -143,6 +156,7 @@ Window::Window(const char* title, int width, int height, bool showgui)
     glfwSetMouseButtonCallback(window_, glfw_mouse);
     glfwSetScrollCallback(window_, glfw_scroll);
     glfwSetFramebufferSizeCallback(window_, glfw_resize);
+    glfwSetWindowRefreshCallback(window_, glfw_refresh);
 
     // setup imgui
     init_imgui();
@@ -153,6 +167,9 @@ Window::Window(const char* title, int width, int height, bool showgui)
     add_help_item("PageUp/Down", "Scale GUI dialogs");
 #ifndef __EMSCRIPTEN__
     add_help_item("PrtScr", "Save screenshot");
+    add_help_item("Shift+PrtScr", "Record 120 frames");
+    if (Trace::is_enabled())
+        add_help_item("T", "Write trace");
     add_help_item("Esc/Q", "Quit application");
 #endif
 
@@ -160,10 +177,17 @@ Window::Window(const char* title, int width, int height, bool showgui)
     for (bool& i : button_)
         i = false;
     ctrl_pressed_ = shift_pressed_ = alt_pressed_ = false;
+
+    // render the first frames
+    request_redraw();
 }
 
 Window::~Window()
 {
+    // write the remaining frames while the OpenGL context exists
+    glfwMakeContextCurrent(window_);
+    frame_capture_.finish();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -363,16 +387,56 @@ int Window::run()
 #else
     while (!glfwWindowShouldClose(window_))
     {
-        Window::render_frame();
+        if (continuous_rendering_ || redraw_frames_ > 0 || is_capturing())
+        {
+            Window::render_frame();
+        }
+        else if (frame_capture_.n_pending())
+        {
+            // pick up frames that are read in the background
+            glfwWaitEventsTimeout(0.01);
+            frame_capture_.poll();
+        }
+        else
+        {
+            // nothing changed, sleep until the next event
+            const double start = glfwGetTime();
+            glfwWaitEvents();
+            idle_time_ += glfwGetTime() - start;
+        }
     }
+
+    if (Trace::is_enabled())
+        write_trace();
 #endif
     return EXIT_SUCCESS;
 }
 
+void Window::request_redraw()
+{
+    redraw_frames_ = 3;
+
+    // wake up the render loop if it waits for events
+    glfwPostEmptyEvent();
+}
+
 void Window::render_frame()
 {
     glfwMakeContextCurrent(instance_->window_);
 
+    if (instance_->redraw_frames_ > 0)
+        --instance_->redraw_frames_;
+    PMP_TRACE_SCOPE("Window::render_frame");
+    PMP_TRACE_STAGES(zone, "processing");
+    FrameTimes times;
+    double time = glfwGetTime();
+    auto stage = [&time]() {
+        const double now = glfwGetTime();
+        const float elapsed = float(1000.0 * (now - time));
+        time = now;
+        return elapsed;
+    };
+
 #if __EMSCRIPTEN__
     // determine correct canvas/framebuffer size
     int w, h, f;
@@ -390,8 +454,16 @@ void Window::render_frame()
     }
 #endif
 
+    // advance a recorded sequence
+    const bool capturing = instance_->is_capturing();
+    if (capturing)
+        instance_->capture_step(instance_->capture_frame_,
+                                instance_->capture_n_frames_);
+
     // do some computations
     instance_->do_processing();
+    times.processing = stage();
+    PMP_TRACE_NEXT(zone, "gui");
 
     // preapre and process ImGUI elements
     if (instance_->show_imgui())
@@ -411,6 +483,7 @@ void Window::render_frame()
         ImGui::Separator();
         ImGui::Spacing();
         instance_->process_imgui();
+        instance_->show_frame_times();
         ImGui::End();
 
         // show imgui help
@@ -418,10 +491,25 @@ void Window::render_frame()
 
         ImGui::Render();
     }
+    times.gui = stage();
+    PMP_TRACE_NEXT(zone, "display");
 
     // draw scene
     instance_->display();
 
+    // record the scene without GUI
+    if (capturing)
+    {
+        char filename[100];
+        sprintf(filename, "%s-capture-%04u.png", instance_->title_.c_str(),
+                instance_->capture_frame_);
+        instance_->frame_capture_.read(instance_->width_, instance_->height_,
+                                       filename);
+        if (++instance_->capture_frame_ == instance_->capture_n_frames_)
+            std::cout << "Recorded " << instance_->capture_n_frames_
+                      << " frames" << std::endl;
+    }
+
     // draw GUI
     if (instance_->show_imgui())
     {
@@ -442,11 +530,71 @@ void Window::render_frame()
     glClearColor(rgba[0], rgba[1], rgba[2], rgba[3]);
 #endif
 
+    // take a screenshot including the GUI
+    if (!instance_->screenshot_filename_.empty())
+    {
+        instance_->frame_capture_.read(instance_->width_, instance_->height_,
+                                       instance_->screenshot_filename_);
+        instance_->screenshot_filename_.clear();
+    }
+
+    times.display = stage();
+    PMP_TRACE_NEXT(zone, "swap");
+
     // swap buffers
     glfwSwapBuffers(instance_->window_);
+    times.swap = stage();
+    PMP_TRACE_NEXT(zone, "events");
 
-    // handle events
+    // handle events, pass frames read in the background to the writers
     glfwPollEvents();
+    instance_->frame_capture_.poll();
+    times.events = stage();
+
+    std::vector<FrameTimes>& frame_times = instance_->frame_times_;
+    frame_times[instance_->frames_rendered_++ % frame_times.size()] = times;
+}
+
+void Window::show_frame_times()
+{
+    if (!ImGui::CollapsingHeader("Frame Times"))
+        return;
+
+    // averages over the frames in the ring buffer
+    const size_t n = std::min(frame_times_.size(), size_t(frames_rendered_));
+    FrameTimes average{0, 0, 0, 0, 0};
+    float max_total = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const FrameTimes& t = frame_times_[i];
+        average.processing += t.processing / n;
+        average.gui += t.gui / n;
+        average.display += t.display / n;
+        average.swap += t.swap / n;
+        average.events += t.events / n;
+        max_total = std::max(max_total, t.total());
+    }
+
+    // total CPU times of the last frames, oldest first
+    char overlay[32];
+    sprintf(overlay, "%.2f ms", average.total());
+    ImGui::PlotLines(
+        "##frame times",
+        [](void* data, int i) {
+            return static_cast<const FrameTimes*>(data)[i].total();
+        },
+        frame_times_.data(), int(n),
+        int(n < frame_times_.size() ? 0 : frames_rendered_ % n), overlay, 0,
+        1.2f * max_total, ImVec2(200 * imgui_scale_, 40 * imgui_scale_));
+
+    ImGui::Text("Processing: %.2f ms", average.processing);
+    ImGui::Text("GUI:        %.2f ms", average.gui);
+    ImGui::Text("Display:    %.2f ms", average.display);
+    ImGui::Text("Swap:       %.2f ms", average.swap);
+    ImGui::Text("Events:     %.2f ms", average.events);
+    ImGui::Text("%lu frames rendered, %lu skipped", frames_rendered_,
+                (unsigned long)(idle_time_ * refresh_rate_));
+    ImGui::Checkbox("Render continuously", &continuous_rendering_);
 }
 
 void Window::glfw_error(int error, const char* description)
@@ -456,6 +604,7 @@ void Window::glfw_error(int error, const char* description)
 
 void Window::glfw_character(GLFWwindow* window, unsigned int c)
 {
+    instance_->request_redraw();
     ImGui_ImplGlfw_CharCallback(window, c);
     if (!ImGui::GetIO().WantCaptureKeyboard)
     {
@@ -466,6 +615,7 @@ void Window::glfw_character(GLFWwindow* window, unsigned int c)
 void Window::glfw_keyboard(GLFWwindow* window, int key, int scancode,
                            int action, int mods)
 {
+    instance_->request_redraw();
     ImGui_ImplGlfw_KeyCallback(window, key, scancode, action, mods);
     if (!ImGui::GetIO().WantCaptureKeyboard)
     {
@@ -502,7 +652,7 @@ void Window::character(unsigned int c)
     }
 }
 
-void Window::keyboard(int key, int /*code*/, int action, int /*mods*/)
+void Window::keyboard(int key, int /*code*/, int action, int mods)
 {
     if (action != GLFW_PRESS && action != GLFW_REPEAT)
         return;
@@ -513,13 +663,29 @@ void Window::keyboard(int key, int /*code*/, int action, int /*mods*/)
         case GLFW_KEY_ESCAPE:
         case GLFW_KEY_Q:
         {
+            if (Trace::is_enabled())
+                write_trace();
+            frame_capture_.finish();
             exit(0);
             break;
         }
 
         case GLFW_KEY_PRINT_SCREEN:
         {
-            screenshot();
+            if (mods & GLFW_MOD_SHIFT)
+                capture_frames(120);
+            else
+                screenshot();
+            break;
+        }
+
+        case GLFW_KEY_T:
+        {
+            if (Trace::is_enabled())
+                write_trace();
+            else
+                std::cerr << "Tracing is disabled, configure with "
+                             "-DPMP_TRACING=ON to enable it\n";
             break;
         }
 #endif
@@ -621,12 +787,15 @@ void Window::exit_fullscreen()
 
 void Window::glfw_motion(GLFWwindow* /*window*/, double xpos, double ypos)
 {
+    instance_->request_redraw();
+
     // correct for highDPI scaling
     instance_->motion(instance_->scaling_ * xpos, instance_->scaling_ * ypos);
 }
 
 void Window::glfw_mouse(GLFWwindow* window, int button, int action, int mods)
 {
+    instance_->request_redraw();
     ImGui_ImplGlfw_MouseButtonCallback(window, button, action, mods);
     if (!ImGui::GetIO().WantCaptureMouse)
     {
@@ -648,6 +817,7 @@ void Window::glfw_scroll(GLFWwindow* window, double xoffset, double yoffset)
         yoffset = -t;
 #endif
 
+    instance_->request_redraw();
     ImGui_ImplGlfw_ScrollCallback(window, xoffset, yoffset);
     if (!ImGui::GetIO().WantCaptureMouse)
     {
@@ -660,6 +830,13 @@ void Window::glfw_resize(GLFWwindow* /*window*/, int width, int height)
     instance_->width_ = width;
     instance_->height_ = height;
     instance_->resize(width, height);
+    instance_->request_redraw();
+}
+
+void Window::glfw_refresh(GLFWwindow* /*window*/)
+{
+    // the contents of the window were damaged
+    instance_->request_redraw();
 }
 
 void Window::cursor_pos(double& x, double& y) const
@@ -675,20 +852,26 @@ void Window::screenshot()
     sprintf(filename, "%s-%d.png", title_.c_str(), screenshot_number_++);
     std::cout << "Save screenshot to " << filename << std::endl;
 
-    // allocate buffer
-    unsigned char* data = new unsigned char[3 * width_ * height_];
-
-    // read framebuffer
-    glfwMakeContextCurrent(window_);
-    glPixelStorei(GL_PACK_ALIGNMENT, 1);
-    glReadPixels(0, 0, width_, height_, GL_RGB, GL_UNSIGNED_BYTE, data);
+    // the frame is read in render_frame() before the buffers are swapped
+    screenshot_filename_ = filename;
+    request_redraw();
+}
 
-    // write to file
-    stbi_flip_vertically_on_write(true);
-    stbi_write_png(filename, width_, height_, 3, data, 3 * width_);
+void Window::capture_frames(unsigned int n_frames)
+{
+    std::cout << "Record " << n_frames << " frames to " << title_
+              << "-capture-*.png" << std::endl;
+    capture_frame_ = 0;
+    capture_n_frames_ = n_frames;
+}
 
-    // clean up
-    delete[] data;
+void Window::write_trace()
+{
+    const std::string filename = title_ + "-trace.json";
+    if (Trace::write(filename))
+        std::cout << "Save trace to " << filename << std::endl;
+    else
+        std::cerr << "Cannot write trace to " << filename << std::endl;
 }
 
 } // namespace pmp
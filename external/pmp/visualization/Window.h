@@ -4,7 +4,9 @@
 #pragma once
 
 #include "pmp/visualization/GL.h"
+#include "pmp/visualization/FrameCapture.h"
 
+#include <atomic>
 #include <vector>
 #include <utility>
 
@@ -36,6 +38,7 @@ protected:
     static void glfw_motion(GLFWwindow* window, double xpos, double ypos);
     static void glfw_scroll(GLFWwindow* window, double xoffset, double yoffset);
     static void glfw_resize(GLFWwindow* window, int width, int height);
+    static void glfw_refresh(GLFWwindow* window);
 
     static void render_frame();
 
@@ -71,6 +74,13 @@ protected:
     //! this function is called just before rendering
     virtual void do_processing() {}
 
+    //! this function is called before each frame \p frame of \p n_frames
+    //! recorded by capture_frames(), e.g., to move the camera
+    virtual void capture_step(unsigned int /*frame*/,
+                              unsigned int /*n_frames*/)
+    {
+    }
+
 protected:
     //! setup ImGUI user interface
     void init_imgui();
@@ -94,10 +104,37 @@ protected:
     //! show ImGUI help dialog
     void show_help();
 
-    //! take a screenshot, save it to `title-n.png` using the window title
-    //! and an incremented number `n`.
+    //! take a screenshot of the next frame, save it to `title-n.png` using
+    //! the window title and an incremented number `n`. the image is read
+    //! and written in the background.
     void screenshot();
 
+    //! \brief record the next \p n_frames frames
+    //! \details The frames are rendered continuously and saved without the
+    //! ImGUI dialogs to `title-capture-i.png`, where `i` is the frame
+    //! number. capture_step() is called before each frame.
+    void capture_frames(unsigned int n_frames);
+
+    //! is capture_frames() recording?
+    bool is_capturing() const { return capture_frame_ < capture_n_frames_; }
+
+    //! write the zones recorded by PMP_TRACE_SCOPE() to `title-trace.json`,
+    //! only useful if compiled with PMP_TRACING
+    void write_trace();
+
+    //! \brief request the scene to be rendered again
+    //! \details Unless rendering continuously, frames are only rendered after
+    //! input events. Call this function if the scene changed otherwise, e.g.,
+    //! in do_processing() or when a background computation finished. It can
+    //! be called from any thread.
+    void request_redraw();
+
+    //! render frames continuously, or only when something changed?
+    bool continuous_rendering() const { return continuous_rendering_; }
+
+    //! render frames continuously, or only when something changed
+    void set_continuous_rendering(bool b) { continuous_rendering_ = b; }
+
 protected:
     //! width of window
     int width() const { return width_; }
@@ -169,6 +206,43 @@ private:
 
     // screenshot number
     unsigned int screenshot_number_;
+
+    // file of the screenshot to be taken of the next frame, if any
+    std::string screenshot_filename_;
+
+    // current and total number of frames recorded by capture_frames()
+    unsigned int capture_frame_, capture_n_frames_;
+
+    // reads frames and writes them in the background
+    FrameCapture frame_capture_;
+
+    // number of frames still to be rendered. ImGUI needs a few frames to
+    // settle after input.
+    std::atomic<int> redraw_frames_;
+    bool continuous_rendering_;
+
+    // CPU times in ms of the stages of a frame
+    struct FrameTimes
+    {
+        float processing, gui, display, swap, events;
+        float total() const
+        {
+            return processing + gui + display + swap + events;
+        }
+    };
+
+    // times of the last frames as ring buffer, and the number of frames
+    // rendered so far
+    std::vector<FrameTimes> frame_times_;
+    unsigned long frames_rendered_;
+
+    // time spent waiting for events in seconds, and the refresh rate of the
+    // monitor to estimate the number of frames that were not rendered
+    double idle_time_;
+    int refresh_rate_;
+
+    // show frame times in the ImGUI dialog
+    void show_frame_times();
 };
 
 } // namespace pmp
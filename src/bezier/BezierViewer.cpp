@@ -132,6 +132,18 @@ void BezierViewer::process_imgui()
         ImGui::Spacing();
         ImGui::Spacing();
         ImGui::Text("Tesselation time:\n%.2fms", bezier_.tesselation_time_);
+
+        ImGui::Spacing();
+        ImGui::Spacing();
+        bool frustum_culling = bezier_.frustum_culling();
+        if (ImGui::Checkbox("Frustum Culling", &frustum_culling))
+            bezier_.set_frustum_culling(frustum_culling);
+        bool backface_culling = bezier_.backface_culling();
+        if (ImGui::Checkbox("Backface Culling", &backface_culling))
+            bezier_.set_backface_culling(backface_culling);
+        const CullingStats &stats = bezier_.culling_stats();
+        ImGui::Text("Patches: %u drawn\n%u outside, %u back-facing",
+                    stats.visible, stats.outside, stats.backface);
     }
 }
 
@@ -144,23 +156,21 @@ void BezierViewer::draw(const std::string &_draw_mode)
     {
         if (!phong_shader_.source(phong_vshader, phong_fshader))
             exit(1);
+        phong_shader_.bind_uniform_block(FrameUniforms::block_name,
+                                         FrameUniforms::binding_point);
     }
 
     // clear framebuffer and depth buffer first
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // setup matrices
+    // setup matrices and lights
     mat4 mv_matrix = modelview_matrix_;
-    mat4 mvp_matrix = projection_matrix_ * mv_matrix;
-    mat3 n_matrix = inverse(transpose(linear_part(mv_matrix)));
+    frame_uniforms_.update(projection_matrix_, mv_matrix,
+                           normalize(vec3(1.0, 1.0, 1.0)),
+                           normalize(vec3(-1.0, 1.0, 1.0)));
 
     // render filled surface triangles with Phong lighting
     phong_shader_.use();
-    phong_shader_.set_uniform("modelview_projection_matrix", mvp_matrix);
-    phong_shader_.set_uniform("modelview_matrix", mv_matrix);
-    phong_shader_.set_uniform("normal_matrix", n_matrix);
-    phong_shader_.set_uniform("light1", normalize(vec3(1.0, 1.0, 1.0)));
-    phong_shader_.set_uniform("light2", normalize(vec3(-1.0, 1.0, 1.0)));
     phong_shader_.set_uniform("front_color", vec3(0.9, 0.0, 0.0));
     phong_shader_.set_uniform("back_color", vec3(0.5, 0.0, 0.0));
     phong_shader_.set_uniform("ambient", 0.1f);
@@ -173,6 +183,9 @@ void BezierViewer::draw(const std::string &_draw_mode)
     phong_shader_.set_uniform("use_srgb", false);
     phong_shader_.set_uniform("show_texture_layout", false);
 
+    // skip invisible patches
+    bezier_.cull(projection_matrix_, mv_matrix);
+
     glDepthRange(0.01, 1.0); // reduce depth range for solid rendering,
     // such that wireframe will be slightly in front
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
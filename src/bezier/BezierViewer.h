@@ -11,6 +11,7 @@
 
 #include <pmp/visualization/TrackballViewer.h>
 #include <pmp/visualization/Shader.h>
+#include <pmp/visualization/FrameUniforms.h>
 
 #include "bezier_surface.h"
 
@@ -52,6 +53,9 @@ private:
     /// Phong shader
     pmp::Shader phong_shader_;
 
+    /// matrices and lights of the Phong shader
+    pmp::FrameUniforms frame_uniforms_;
+
     /// should we render the control mesh?
     bool render_control_mesh_;
 
@@ -10,6 +10,7 @@
 #include "bezier_patch.h"
 #include <algorithm>
 #include <cfloat>
+#include <pmp/Trace.h>
 
 using namespace pmp;
 
@@ -17,6 +18,9 @@ using namespace pmp;
 
 Bezier_patch::Bezier_patch()
     : selected_control_point_(0),
+      surface_bbmin_(FLT_MAX),
+      surface_bbmax_(-FLT_MAX),
+      culled_(false),
       cpoly_vertex_array_(0),
       cpoly_vertex_buffer_(0),
       cpoly_index_buffer_(0),
@@ -233,6 +237,8 @@ void Bezier_patch::position_normal(float _u, float _v, vec3 &_p, vec3 &_n) const
 
 void Bezier_patch::tessellate(unsigned int _resolution)
 {
+    PMP_TRACE_SCOPE("Bezier_patch::tessellate");
+    PMP_TRACE_STAGES(stage, "evaluate");
     surface_vertices_.clear();
     surface_normals_.clear();
     surface_triangles_.clear();
@@ -285,6 +291,7 @@ void Bezier_patch::tessellate(unsigned int _resolution)
 
 
     // test the results to avoid ulgy memory leaks
+    PMP_TRACE_NEXT(stage, "validate");
 
     if (surface_vertices_.size() != N * N)
     {
@@ -320,11 +327,46 @@ void Bezier_patch::tessellate(unsigned int _resolution)
         }
     }
 
+    PMP_TRACE_NEXT(stage, "bounds");
+    compute_surface_bounds();
+
+    PMP_TRACE_NEXT(stage, "upload");
     upload_opengl_buffers();
 }
 
 //-----------------------------------------------------------------------------
 
+void Bezier_patch::compute_surface_bounds()
+{
+    surface_bbmin_ = vec3(FLT_MAX);
+    surface_bbmax_ = vec3(-FLT_MAX);
+    for (const vec3 &p : surface_vertices_)
+    {
+        surface_bbmin_ = min(surface_bbmin_, p);
+        surface_bbmax_ = max(surface_bbmax_, p);
+    }
+
+    // the normals of the triangles, not the interpolated vertex normals,
+    // decide whether the drawn surface faces away from the viewer. without
+    // triangles only points are drawn, which are never culled as back faces.
+    std::vector<vec3> normals;
+    normals.reserve(surface_triangles_.size() / 3);
+    for (size_t i = 0; i + 2 < surface_triangles_.size(); i += 3)
+    {
+        const vec3 &p0 = surface_vertices_[surface_triangles_[i]];
+        const vec3 &p1 = surface_vertices_[surface_triangles_[i + 1]];
+        const vec3 &p2 = surface_vertices_[surface_triangles_[i + 2]];
+        const vec3 n = cross(p1 - p0, p2 - p0);
+        const float length = norm(n);
+        normals.push_back(length > 0 ? n / length : vec3(0, 0, 0));
+    }
+    surface_normal_cone_ = normals.empty()
+                               ? NormalCone()
+                               : NormalCone(normals.data(), normals.size());
+}
+
+//-----------------------------------------------------------------------------
+
 void Bezier_patch::upload_opengl_buffers()
 {
     // generate buffers for control polygon
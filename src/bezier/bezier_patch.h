@@ -11,6 +11,7 @@
 
 #include <pmp/MatVec.h>
 #include <pmp/visualization/GL.h>
+#include <pmp/visualization/Culling.h>
 
 #include <vector>
 
@@ -61,6 +62,9 @@ private:
     /// upload data to OpenGL buffers for control polgyon and tessellated mesh
     void upload_opengl_buffers();
 
+    /// compute bounding box and normal cone of the tessellated surface
+    void compute_surface_bounds();
+
     /// toggle bezier evaluation via de Casteljau or Bernstein polynomials
     void toggle_de_Casteljau();
 
@@ -86,6 +90,13 @@ private:
     /// array of triangles for tessellated surface (three indices per triangle)
     std::vector<GLuint> surface_triangles_;
 
+    /// bounding box of the tessellated surface
+    pmp::vec3 surface_bbmin_, surface_bbmax_;
+    /// cone containing the normals of the surface triangles
+    pmp::NormalCone surface_normal_cone_;
+    /// is the surface skipped when drawing? (see Bezier_surface::cull())
+    bool culled_;
+
     /// OpenGL vertex array object for control polygon
     GLuint cpoly_vertex_array_;
     /// OpenGL buffer object for control points
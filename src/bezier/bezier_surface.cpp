@@ -13,13 +13,15 @@
 #include <fstream>
 #include <iostream>
 #include <pmp/Timer.h>
+#include <pmp/Trace.h>
 #include <string>
 
 //=============================================================================
 
 using namespace pmp;
 
-Bezier_surface::Bezier_surface(const char *_filename) : picked_patch_(nullptr)
+Bezier_surface::Bezier_surface(const char *_filename)
+    : picked_patch_(nullptr), frustum_culling_(true), backface_culling_(false)
 {
     if (_filename)
     {
@@ -119,6 +121,7 @@ bool Bezier_surface::bounding_box(vec3 &_bbmin, vec3 &_bbmax) const
 
 void Bezier_surface::tessellate(unsigned int _resolution)
 {
+    PMP_TRACE_SCOPE("Bezier_surface::tessellate");
     pmp::Timer timer;
     timer.start();
 
@@ -147,10 +150,53 @@ void Bezier_surface::draw_control_polygon()
 
 void Bezier_surface::draw_surface(std::string drawmode, bool upload)
 {
-    // draw tessellated surface of all patches
+    // draw tessellated surface of all visible patches
     for (Bezier_patch &patch : patches_)
     {
-        patch.draw_surface(drawmode, upload);
+        if (!patch.culled_)
+            patch.draw_surface(drawmode, upload);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void Bezier_surface::cull(const mat4 &_projection_matrix,
+                          const mat4 &_modelview_matrix)
+{
+    culling_stats_ = CullingStats();
+
+    // the frustum and the eye in object coordinates
+    const Frustum frustum(_projection_matrix * _modelview_matrix);
+    const vec4 e = inverse(_modelview_matrix) * vec4(0, 0, 0, 1);
+    const vec3 eye(e[0] / e[3], e[1] / e[3], e[2] / e[3]);
+
+    for (Bezier_patch &patch : patches_)
+    {
+        const vec3 &bbmin = patch.surface_bbmin_;
+        const vec3 &bbmax = patch.surface_bbmax_;
+        patch.culled_ = false;
+
+        // patches that are not tessellated yet are always drawn
+        if (bbmin[0] > bbmax[0])
+        {
+            ++culling_stats_.visible;
+        }
+        else if (frustum_culling_ && frustum.is_outside(bbmin, bbmax))
+        {
+            patch.culled_ = true;
+            ++culling_stats_.outside;
+        }
+        else if (backface_culling_ &&
+                 patch.surface_normal_cone_.is_backfacing(
+                     eye, 0.5f * (bbmin + bbmax), 0.5f * distance(bbmin, bbmax)))
+        {
+            patch.culled_ = true;
+            ++culling_stats_.backface;
+        }
+        else
+        {
+            ++culling_stats_.visible;
+        }
     }
 }
 
@@ -42,9 +42,29 @@ public:
     /// draw the control polygon for all Bezier patches.
     void draw_control_polygon();
 
-    /// draw the tessellated surface of all Bezier patches.
+    /// draw the tessellated surface of all Bezier patches that were not
+    /// culled by the last call of cull().
     void draw_surface(std::string drawmode, bool upload = false);
 
+    /// determine the patches that are outside of the view frustum or face
+    /// away from the viewer, draw_surface() skips them.
+    void cull(const pmp::mat4 &_projection_matrix,
+              const pmp::mat4 &_modelview_matrix);
+
+    /// skip patches outside the view frustum?
+    bool frustum_culling() const { return frustum_culling_; }
+    /// skip patches outside the view frustum
+    void set_frustum_culling(bool _b) { frustum_culling_ = _b; }
+
+    /// skip patches facing away from the viewer?
+    bool backface_culling() const { return backface_culling_; }
+    /// skip patches facing away from the viewer. back faces are not drawn
+    /// then, which is only correct for closed surfaces.
+    void set_backface_culling(bool _b) { backface_culling_ = _b; }
+
+    /// number of patches drawn and culled after the last cull()
+    const pmp::CullingStats &culling_stats() const { return culling_stats_; }
+
     /// toggles between de casteljau and bernstein bezier patch evaluation
     void toggle_de_Casteljau();
 
@@ -69,5 +89,9 @@ private:
 
     /// currently picked Bezier patch
     Bezier_patch *picked_patch_;
+
+    /// culling of patches
+    bool frustum_culling_, backface_culling_;
+    pmp::CullingStats culling_stats_;
 };
 //=============================================================================
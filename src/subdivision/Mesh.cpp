@@ -9,11 +9,68 @@
 
 #include "Mesh.h"
 #include <pmp/visualization/PhongShader.h>
+#include <pmp/MemoryUsage.h>
+#include <pmp/Trace.h>
+#include <algorithm>
 #include <cfloat>
 
 //=============================================================================
 
-SubdivisionMesh::SubdivisionMesh() : SurfaceMeshGL() {}
+SubdivisionMesh::SubdivisionMesh()
+    : SurfaceMeshGL(),
+      use_grids_(true),
+      grid_vertex_array_object_(0),
+      grid_vertex_buffer_(0),
+      grid_normal_buffer_(0),
+      grid_triangle_buffer_(0),
+      grid_edge_buffer_(0),
+      grid_n_triangles_(0),
+      grid_n_edges_(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+
+SubdivisionMesh::~SubdivisionMesh()
+{
+    clear_grids();
+}
+
+//-----------------------------------------------------------------------------
+
+void SubdivisionMesh::clear_grids()
+{
+    grids_.clear();
+
+    // delete OpenGL buffers
+    glDeleteBuffers(1, &grid_vertex_buffer_);
+    glDeleteBuffers(1, &grid_normal_buffer_);
+    glDeleteBuffers(1, &grid_triangle_buffer_);
+    glDeleteBuffers(1, &grid_edge_buffer_);
+    glDeleteVertexArrays(1, &grid_vertex_array_object_);
+    grid_vertex_array_object_ = 0;
+    grid_vertex_buffer_ = 0;
+    grid_normal_buffer_ = 0;
+    grid_triangle_buffer_ = 0;
+    grid_edge_buffer_ = 0;
+    grid_n_triangles_ = 0;
+    grid_n_edges_ = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+void SubdivisionMesh::set_grid_subdivision(bool b)
+{
+    use_grids_ = b;
+
+    // continue with the halfedge mesh of the current level
+    if (!use_grids_ && !grids_.empty())
+    {
+        grids_.extract(*this);
+        clear_grids();
+        update_opengl_buffers();
+    }
+}
 
 //-----------------------------------------------------------------------------
 
@@ -21,7 +78,26 @@ void SubdivisionMesh::subdivide()
 {
     using namespace pmp;
 
+    PMP_TRACE_SCOPE("SubdivisionMesh::subdivide");
+    MemoryScope memory("SubdivisionMesh::subdivide");
+
+    // once all faces are quads, the levels are computed in per-face grids
+    if (use_grids_ && (!grids_.empty() || (n_faces() && is_quad_mesh())))
+    {
+        subdivide_grids();
+        memory.set_gpu(grid_gpu_memory());
+        return;
+    }
+
+    PMP_TRACE_STAGES(stage, "garbage collection");
+
+    // subdivision only adds elements, so after removing deleted ones all
+    // sweeps below can run over plain (and thread-parallel) index ranges
+    if (has_garbage())
+        garbage_collection();
+
     // reserve memory
+    PMP_TRACE_NEXT(stage, "reserve");
     int nv = n_vertices();
     int ne = n_edges();
     int nf = n_faces();
@@ -33,6 +109,10 @@ void SubdivisionMesh::subdivide()
     auto epoint = add_edge_property<Point>("catmull:epoint", Point(0));
     auto fpoint = add_face_property<Point>("catmull:fpoint", Point(0));
 
+    // the positions might still be shared with the control mesh. detach
+    // them once here instead of in the parallel loops below.
+    points.vector();
+
     /** \todo Implement the generalized version of Catmull-Clark subdivision
       *   that can handle arbitrary polygonal meshes (not just quad meshes).          \n
       *   You have to compute
@@ -65,8 +145,11 @@ void SubdivisionMesh::subdivide()
       */
 
     // i) New face vertices
+    PMP_TRACE_NEXT(stage, "face points");
     //schleife ueber alle faces, weil wir alle mittelpunkte bestimmen wollen
-    for(auto f: faces()) {
+#pragma omp parallel for
+    for (int i = 0; i < nf; ++i) {
+        Face f(i);
         vec3 p(0,0,0); //ein neuer Punkt den wir ausrechnen wollen mit 0,0,0 initializiert
         double ctr = 0; //counter variable zum zaehlen
         for(auto v : vertices(f)) { //ueber alle vetices vom face f
@@ -78,9 +161,12 @@ void SubdivisionMesh::subdivide()
     }
 
     // ii) new edge vertices
+    PMP_TRACE_NEXT(stage, "edge points");
     // die neuen kanten oder so
     // wichtig ist, ist es eine innere kante oder eine rand kante, dass bestimmen wir ueber catmull clark halbkanten dings
-    for(auto e : edges()) {
+#pragma omp parallel for
+    for (int i = 0; i < ne; ++i) {
+        Edge e(i);
         vec3 p(0,0,0); //wieder der punkt den wir berechnen wollen
         //ueber vertex(e,0) und vertex(e,1) kriegen wir den anfangs und endpunkt der kante
         //durch das teilen können wir dann den mittelpunkt bestimmen
@@ -98,7 +184,10 @@ void SubdivisionMesh::subdivide()
     }
 
     // 3) update old vertex positions
-    for(auto v : vertices()) {
+    PMP_TRACE_NEXT(stage, "vertex points");
+#pragma omp parallel for
+    for (int i = 0; i < nv; ++i) {
+        Vertex v(i);
         vec3 p(0,0,0);
         if(is_boundary(v)) {
             for(auto vv : vertices(v)) {
@@ -124,18 +213,23 @@ void SubdivisionMesh::subdivide()
 
 
     // assign new positions to old vertices
-    for (auto v : vertices())
+    PMP_TRACE_NEXT(stage, "assign points");
+#pragma omp parallel for
+    for (int i = 0; i < nv; ++i)
     {
+        Vertex v(i);
         points[v] = vpoint[v];
     }
 
     // split edges
+    PMP_TRACE_NEXT(stage, "split edges");
     for (auto e : edges())
     {
         insert_vertex(e, epoint[e]);
     }
 
     // split faces
+    PMP_TRACE_NEXT(stage, "split faces");
     for (auto f : faces())
     {
         Halfedge h0 = halfedge(f);
@@ -153,11 +247,257 @@ void SubdivisionMesh::subdivide()
     }
 
     // clean-up properties
+    PMP_TRACE_NEXT(stage, "clean-up");
     remove_vertex_property(vpoint);
     remove_edge_property(epoint);
     remove_face_property(fpoint);
 
     // upload new mesh to GPU
+    PMP_TRACE_NEXT(stage, "upload");
     update_opengl_buffers();
 }
+
+//-----------------------------------------------------------------------------
+
+void SubdivisionMesh::subdivide_grids()
+{
+    PMP_TRACE_STAGES(stage, "build grids");
+    if (grids_.empty())
+    {
+        if (has_garbage())
+            garbage_collection();
+        grids_.build(*this);
+    }
+
+    PMP_TRACE_NEXT(stage, "subdivide grids");
+    grids_.subdivide();
+
+    PMP_TRACE_NEXT(stage, "upload");
+    update_grid_buffers();
+}
+
+//-----------------------------------------------------------------------------
+
+void SubdivisionMesh::update_grid_buffers()
+{
+    using namespace pmp;
+
+    // the points of the grids are uploaded without conversion
+    static_assert(sizeof(Point) == 3 * sizeof(float),
+                  "grid points have to be float triples");
+
+    PMP_TRACE_SCOPE("SubdivisionMesh::update_grid_buffers");
+
+    // are buffers already initialized?
+    if (!grid_vertex_array_object_)
+    {
+        glGenVertexArrays(1, &grid_vertex_array_object_);
+        glGenBuffers(1, &grid_vertex_buffer_);
+        glGenBuffers(1, &grid_normal_buffer_);
+        glGenBuffers(1, &grid_triangle_buffer_);
+        glGenBuffers(1, &grid_edge_buffer_);
+    }
+    glBindVertexArray(grid_vertex_array_object_);
+
+    // upload points, straight from the grids
+    const std::vector<Point>& points = grids_.points();
+    glBindBuffer(GL_ARRAY_BUFFER, grid_vertex_buffer_);
+    glBufferData(GL_ARRAY_BUFFER, points.size() * sizeof(Point),
+                 points.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(0);
+
+    // upload normals
+    {
+        std::vector<Normal> normals;
+        grids_.compute_normals(normals);
+        glBindBuffer(GL_ARRAY_BUFFER, grid_normal_buffer_);
+        glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(Normal),
+                     normals.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+        glEnableVertexAttribArray(1);
+    }
+
+    // the indices are the same for each grid up to an offset, they are
+    // generated and uploaded for blocks of grids to bound the memory
+    const int n = grids_.resolution();
+    const int s = n + 1;
+    const size_t nf = grids_.n_grids();
+    const size_t triangles_per_grid = 6 * size_t(n) * n;
+    const size_t edges_per_grid = 4 * size_t(n) * s;
+    const size_t grids_per_block =
+        std::max(size_t(1), (size_t(1) << 22) / triangles_per_grid);
+
+    grid_n_triangles_ = GLsizei(nf * triangles_per_grid);
+    grid_n_edges_ = GLsizei(nf * edges_per_grid);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, grid_triangle_buffer_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 grid_n_triangles_ * sizeof(unsigned int), nullptr,
+                 GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, grid_edge_buffer_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 grid_n_edges_ * sizeof(unsigned int), nullptr,
+                 GL_STATIC_DRAW);
+
+    std::vector<unsigned int> triangles, edges;
+    for (size_t begin = 0; begin < nf; begin += grids_per_block)
+    {
+        const size_t end = std::min(nf, begin + grids_per_block);
+        triangles.clear();
+        edges.clear();
+        for (size_t f = begin; f < end; ++f)
+        {
+            const unsigned int offset = (unsigned int)(f * grids_.grid_size());
+            for (int v = 0; v < n; ++v)
+            {
+                for (int u = 0; u < n; ++u)
+                {
+                    const unsigned int i0 = offset + v * s + u;
+                    const unsigned int i1 = i0 + 1;
+                    const unsigned int i2 = i0 + s + 1;
+                    const unsigned int i3 = i0 + s;
+                    triangles.insert(triangles.end(), {i0, i1, i2});
+                    triangles.insert(triangles.end(), {i0, i2, i3});
+                }
+            }
+
+            // rows and columns of the grid
+            for (int j = 0; j <= n; ++j)
+            {
+                for (int i = 0; i < n; ++i)
+                {
+                    const unsigned int row = offset + j * s + i;
+                    const unsigned int col = offset + i * s + j;
+                    edges.insert(edges.end(), {row, row + 1, col, col + s});
+                }
+            }
+        }
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, grid_triangle_buffer_);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER,
+                        begin * triangles_per_grid * sizeof(unsigned int),
+                        triangles.size() * sizeof(unsigned int),
+                        triangles.data());
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, grid_edge_buffer_);
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER,
+                        begin * edges_per_grid * sizeof(unsigned int),
+                        edges.size() * sizeof(unsigned int), edges.data());
+    }
+
+    glBindVertexArray(0);
+}
+
+//-----------------------------------------------------------------------------
+
+size_t SubdivisionMesh::grid_gpu_memory() const
+{
+    if (!grid_vertex_array_object_)
+        return 0;
+
+    // GL_COPY_READ_BUFFER does not touch the element buffer of the VAO
+    const GLuint buffers[] = {grid_vertex_buffer_, grid_normal_buffer_,
+                              grid_triangle_buffer_, grid_edge_buffer_};
+    size_t bytes = 0;
+    for (GLuint buffer : buffers)
+    {
+        GLint size = 0;
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+        bytes += size_t(size);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    return bytes;
+}
+
+//-----------------------------------------------------------------------------
+
+void SubdivisionMesh::draw(const pmp::mat4& projection_matrix,
+                           const pmp::mat4& modelview_matrix,
+                           const std::string draw_mode)
+{
+    using namespace pmp;
+
+    if (grids_.empty())
+    {
+        SurfaceMeshGL::draw(projection_matrix, modelview_matrix, draw_mode);
+        return;
+    }
+
+    // load shader?
+    if (!grid_shader_.is_valid())
+    {
+        if (!grid_shader_.source(phong_vshader, phong_fshader))
+            exit(1);
+        grid_shader_.bind_uniform_block(FrameUniforms::block_name,
+                                        FrameUniforms::binding_point);
+    }
+
+    // setup matrices and lights
+    grid_uniforms_.update(projection_matrix, modelview_matrix,
+                          vec3(1.0, 1.0, 1.0), vec3(-1.0, 1.0, 1.0));
+
+    // setup shader
+    grid_shader_.use();
+    grid_shader_.set_uniform("point_size", 5.0f);
+    grid_shader_.set_uniform("front_color", front_color());
+    grid_shader_.set_uniform("back_color", back_color());
+    grid_shader_.set_uniform("ambient", ambient());
+    grid_shader_.set_uniform("diffuse", diffuse());
+    grid_shader_.set_uniform("specular", specular());
+    grid_shader_.set_uniform("shininess", shininess());
+    grid_shader_.set_uniform("alpha", alpha());
+    grid_shader_.set_uniform("use_lighting", true);
+    grid_shader_.set_uniform("use_texture", false);
+    grid_shader_.set_uniform("use_srgb", false);
+    grid_shader_.set_uniform("show_texture_layout", false);
+
+    glBindVertexArray(grid_vertex_array_object_);
+
+    if (draw_mode == "Points")
+    {
+#ifndef __EMSCRIPTEN__
+        glEnable(GL_PROGRAM_POINT_SIZE);
+#endif
+        glDrawArrays(GL_POINTS, 0, GLsizei(grids_.points().size()));
+    }
+
+    else if (draw_mode == "Hidden Line")
+    {
+        // draw faces
+        glDepthRange(0.01, 1.0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, grid_triangle_buffer_);
+        glDrawElements(GL_TRIANGLES, grid_n_triangles_, GL_UNSIGNED_INT,
+                       nullptr);
+
+        // overlay edges
+        glDepthRange(0.0, 1.0);
+        glDepthFunc(GL_LEQUAL);
+        grid_shader_.set_uniform("front_color", vec3(0.1, 0.1, 0.1));
+        grid_shader_.set_uniform("back_color", vec3(0.1, 0.1, 0.1));
+        grid_shader_.set_uniform("use_lighting", false);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, grid_edge_buffer_);
+        glDrawElements(GL_LINES, grid_n_edges_, GL_UNSIGNED_INT, nullptr);
+        glDepthFunc(GL_LESS);
+    }
+
+    else if (draw_mode == "Smooth Shading")
+    {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, grid_triangle_buffer_);
+        glDrawElements(GL_TRIANGLES, grid_n_triangles_, GL_UNSIGNED_INT,
+                       nullptr);
+    }
+
+    else if (draw_mode == "Edges")
+    {
+        grid_shader_.set_uniform("front_color", vec3(0.1, 0.1, 0.1));
+        grid_shader_.set_uniform("back_color", vec3(0.1, 0.1, 0.1));
+        grid_shader_.set_uniform("use_lighting", false);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, grid_edge_buffer_);
+        glDrawElements(GL_LINES, grid_n_edges_, GL_UNSIGNED_INT, nullptr);
+    }
+
+    glBindVertexArray(0);
+    glCheckError();
+}
 //=============================================================================
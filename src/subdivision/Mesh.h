@@ -9,8 +9,10 @@
 #pragma once
 //=============================================================================
 
+#include "QuadGrids.h"
 #include <pmp/visualization/GL.h>
 #include <pmp/visualization/Shader.h>
+#include <pmp/visualization/FrameUniforms.h>
 #include <pmp/MatVec.h>
 #include <pmp/visualization/SurfaceMeshGL.h>
 
@@ -23,7 +25,59 @@ public:
     /// Constructor
     SubdivisionMesh();
 
-    /// subdivides the mesh using the Catmull-Clark scheme
+    /// Destructor, deletes the OpenGL buffers of the grids
+    ~SubdivisionMesh();
+
+    /// subdivides the mesh using the Catmull-Clark scheme. once all faces
+    /// are quads, further levels are stored in per-face grids (see
+    /// QuadGrids) unless disabled by set_grid_subdivision().
     void subdivide();
+
+    /// use per-face grids for the levels of a quad mesh? disabling them
+    /// converts the current grids back into this halfedge mesh.
+    void set_grid_subdivision(bool b);
+    /// are per-face grids used for the levels of a quad mesh?
+    bool grid_subdivision() const { return use_grids_; }
+
+    /// the grids of the current level, empty if the level is stored in the
+    /// halfedge mesh. this mesh then holds the level the grids started at.
+    const QuadGrids& grids() const { return grids_; }
+
+    /// drop the grids without converting them, e.g., before loading a mesh
+    void clear_grids();
+
+    /// draw the grids if there are any, the halfedge mesh otherwise. the
+    /// grids support "Smooth Shading", "Hidden Line", "Edges", and "Points".
+    void draw(const pmp::mat4& projection_matrix,
+              const pmp::mat4& modelview_matrix, const std::string draw_mode);
+
+private:
+    /// subdivide the grids, building them from this mesh first
+    void subdivide_grids();
+
+    /// upload points, normals, and indices of the grids
+    void update_grid_buffers();
+
+    /// bytes allocated in the OpenGL buffers of the grids
+    size_t grid_gpu_memory() const;
+
+    /// levels of a quad mesh as per-face grids
+    QuadGrids grids_;
+    bool use_grids_;
+
+    /// OpenGL buffers of the grids
+    GLuint grid_vertex_array_object_;
+    GLuint grid_vertex_buffer_;
+    GLuint grid_normal_buffer_;
+    GLuint grid_triangle_buffer_;
+    GLuint grid_edge_buffer_;
+
+    /// number of indices in the triangle and edge buffers
+    GLsizei grid_n_triangles_;
+    GLsizei grid_n_edges_;
+
+    /// shader and matrices for drawing the grids
+    pmp::Shader grid_shader_;
+    pmp::FrameUniforms grid_uniforms_;
 };
 //=============================================================================
@@ -0,0 +1,486 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Computer Graphics"
+//     by Prof. Mario Botsch, TU Dortmund
+//
+//   Copyright (C)  Computer Graphics Group, TU Dortmund
+//
+//=============================================================================
+
+#include "QuadGrids.h"
+#include <pmp/Trace.h>
+#include <algorithm>
+
+//=============================================================================
+
+using namespace pmp;
+
+//=============================================================================
+
+QuadGrids::QuadGrids() : level_(0), n_(1), n_control_vertices_(0) {}
+
+//-----------------------------------------------------------------------------
+
+void QuadGrids::clear()
+{
+    // release the memory, grids of deep levels are large
+    std::vector<Point>().swap(points_);
+    std::vector<int>().swap(corner_vertices_);
+    std::vector<int>().swap(side_edges_);
+    std::vector<int>().swap(edge_sides_);
+    std::vector<Spoke>().swap(spokes_);
+    std::vector<int>().swap(spoke_begin_);
+    level_ = 0;
+    n_ = 1;
+    n_control_vertices_ = 0;
+}
+
+//-----------------------------------------------------------------------------
+
+bool QuadGrids::build(const SurfaceMesh& control)
+{
+    clear();
+
+    for (auto f : control.faces())
+        if (control.valence(f) != 4)
+            return false;
+
+    const int nf = int(control.faces_size());
+    n_control_vertices_ = control.vertices_size();
+
+    // corners and level-0 grids, and the side of each halfedge
+    std::vector<int> halfedge_sides(control.halfedges_size(), -1);
+    corner_vertices_.resize(4 * nf);
+    points_.resize(4 * nf);
+    for (auto f : control.faces())
+    {
+        Halfedge h = control.halfedge(f);
+        for (int i = 0; i < 4; ++i, h = control.next_halfedge(h))
+        {
+            const int side = 4 * f.idx() + i;
+            const Vertex v = control.from_vertex(h);
+            halfedge_sides[h.idx()] = side;
+            corner_vertices_[side] = v.idx();
+            points_[index(side, 0, 0, 1)] = control.position(v);
+        }
+    }
+
+    // the sides of each edge, boundary edges have their side first
+    edge_sides_.resize(2 * control.edges_size());
+    side_edges_.resize(4 * nf);
+    for (auto e : control.edges())
+    {
+        int a = halfedge_sides[control.halfedge(e, 0).idx()];
+        int b = halfedge_sides[control.halfedge(e, 1).idx()];
+        if (a == -1)
+            std::swap(a, b);
+        edge_sides_[2 * e.idx()] = a;
+        edge_sides_[2 * e.idx() + 1] = b;
+        if (a != -1)
+            side_edges_[a] = 2 * e.idx();
+        if (b != -1)
+            side_edges_[b] = 2 * e.idx() + 1;
+    }
+
+    // the edges around each vertex
+    spoke_begin_.reserve(control.vertices_size() + 1);
+    spoke_begin_.push_back(0);
+    for (auto v : control.vertices())
+    {
+        for (auto h : control.halfedges(v))
+        {
+            const int side = halfedge_sides[h.idx()];
+            const int opposite =
+                halfedge_sides[control.opposite_halfedge(h).idx()];
+            if (side != -1)
+                spokes_.push_back(Spoke{side, false, opposite == -1});
+            else if (opposite != -1)
+                spokes_.push_back(Spoke{opposite, true, true});
+        }
+        spoke_begin_.push_back(int(spokes_.size()));
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+
+size_t QuadGrids::n_vertices() const
+{
+    if (empty())
+        return 0;
+    const size_t n = n_ - 1;
+    return n_control_vertices_ + edge_sides_.size() / 2 * n +
+           n_grids() * n * n;
+}
+
+//-----------------------------------------------------------------------------
+
+size_t QuadGrids::memory() const
+{
+    return points_.capacity() * sizeof(Point) +
+           (corner_vertices_.capacity() + side_edges_.capacity() +
+            edge_sides_.capacity() + spoke_begin_.capacity()) *
+               sizeof(int) +
+           spokes_.capacity() * sizeof(Spoke);
+}
+
+//-----------------------------------------------------------------------------
+
+void QuadGrids::subdivide()
+{
+    if (empty())
+        return;
+
+    PMP_TRACE_SCOPE("QuadGrids::subdivide");
+
+    const int n = n_;
+    const int m = 2 * n;
+    const int so = n + 1; // row stride of the old grids
+    const int sn = m + 1; // row stride of the new grids
+    const int nf = int(n_grids());
+
+    std::vector<Point> new_points(size_t(nf) * sn * sn);
+    const Point* P0 = points_.data();
+    Point* Q0 = new_points.data();
+
+    // i) the regular part inside each grid, which only needs the points of
+    // the grid itself. all loops run over contiguous rows.
+    PMP_TRACE_STAGES(stage, "faces");
+#pragma omp parallel for
+    for (int f = 0; f < nf; ++f)
+    {
+        const Point* P = P0 + size_t(f) * so * so;
+        Point* Q = Q0 + size_t(f) * sn * sn;
+
+        // face points
+        for (int j = 0; j < n; ++j)
+        {
+            const Point* p0 = P + j * so;
+            const Point* p1 = p0 + so;
+            Point* q = Q + (2 * j + 1) * sn + 1;
+            for (int i = 0; i < n; ++i)
+                q[2 * i] = 0.25f * (p0[i] + p0[i + 1] + p1[i] + p1[i + 1]);
+        }
+
+        // edge points of the horizontal edges in row j
+        for (int j = 1; j < n; ++j)
+        {
+            const Point* p = P + j * so;
+            const Point* fb = Q + (2 * j - 1) * sn + 1;
+            const Point* fa = Q + (2 * j + 1) * sn + 1;
+            Point* q = Q + 2 * j * sn + 1;
+            for (int i = 0; i < n; ++i)
+                q[2 * i] = 0.25f * (p[i] + p[i + 1] + fb[2 * i] + fa[2 * i]);
+        }
+
+        // edge points of the vertical edges between rows j and j+1
+        for (int j = 0; j < n; ++j)
+        {
+            const Point* p0 = P + j * so;
+            const Point* p1 = p0 + so;
+            Point* q = Q + (2 * j + 1) * sn;
+            for (int i = 1; i < n; ++i)
+                q[2 * i] =
+                    0.25f * (p0[i] + p1[i] + q[2 * i - 1] + q[2 * i + 1]);
+        }
+
+        // vertex points, all vertices inside a grid have valence 4
+        for (int j = 1; j < n; ++j)
+        {
+            const Point* p = P + j * so;
+            const Point* pb = p - so;
+            const Point* pa = p + so;
+            const Point* fb = Q + (2 * j - 1) * sn;
+            const Point* fa = Q + (2 * j + 1) * sn;
+            Point* q = Q + 2 * j * sn;
+            for (int i = 1; i < n; ++i)
+                q[2 * i] = 0.5f * p[i] +
+                           0.0625f * (p[i - 1] + p[i + 1] + pb[i] + pa[i] +
+                                      fb[2 * i - 1] + fb[2 * i + 1] +
+                                      fa[2 * i - 1] + fa[2 * i + 1]);
+        }
+    }
+
+    // ii) points on the control edges, computed from both adjacent grids
+    // and copied to both
+    PMP_TRACE_NEXT(stage, "edges");
+    const int ne = int(edge_sides_.size() / 2);
+#pragma omp parallel for
+    for (int e = 0; e < ne; ++e)
+    {
+        const int a = edge_sides_[2 * e];
+        const int b = edge_sides_[2 * e + 1];
+        if (a == -1)
+            continue;
+
+        // edge points
+        for (int t = 0; t < n; ++t)
+        {
+            const Point p = P0[index(a, t, 0, n)] + P0[index(a, t + 1, 0, n)];
+            Point q;
+            if (b == -1)
+                q = 0.5f * p;
+            else
+                q = 0.25f * (p + Q0[index(a, 2 * t + 1, 1, m)] +
+                             Q0[index(b, m - 2 * t - 1, 1, m)]);
+            Q0[index(a, 2 * t + 1, 0, m)] = q;
+            if (b != -1)
+                Q0[index(b, m - 2 * t - 1, 0, m)] = q;
+        }
+
+        // vertex points, of valence 4 or on the boundary
+        for (int t = 1; t < n; ++t)
+        {
+            const Point& p = P0[index(a, t, 0, n)];
+            const Point r =
+                P0[index(a, t - 1, 0, n)] + P0[index(a, t + 1, 0, n)];
+            Point q;
+            if (b == -1)
+                q = 0.75f * p + 0.125f * r;
+            else
+                q = 0.5f * p +
+                    0.0625f * (r + P0[index(a, t, 1, n)] +
+                               P0[index(b, n - t, 1, n)] +
+                               Q0[index(a, 2 * t - 1, 1, m)] +
+                               Q0[index(a, 2 * t + 1, 1, m)] +
+                               Q0[index(b, m - 2 * t - 1, 1, m)] +
+                               Q0[index(b, m - 2 * t + 1, 1, m)]);
+            Q0[index(a, 2 * t, 0, m)] = q;
+            if (b != -1)
+                Q0[index(b, m - 2 * t, 0, m)] = q;
+        }
+    }
+
+    // iii) control vertices of arbitrary valence, computed from all grids
+    // around them and copied to all
+    PMP_TRACE_NEXT(stage, "vertices");
+    const int nv = int(spoke_begin_.size()) - 1;
+#pragma omp parallel for
+    for (int v = 0; v < nv; ++v)
+    {
+        const int begin = spoke_begin_[v];
+        const int end = spoke_begin_[v + 1];
+        if (begin == end)
+            continue;
+
+        const Spoke& first = spokes_[begin];
+        const Point& p = P0[index(first.side, first.reversed ? n : 0, 0, n)];
+
+        Point edges(0, 0, 0), faces(0, 0, 0), boundary(0, 0, 0);
+        int n_boundary = 0;
+        for (int i = begin; i < end; ++i)
+        {
+            const Spoke& s = spokes_[i];
+            const Point& r = P0[index(s.side, s.reversed ? n - 1 : 1, 0, n)];
+            edges += r;
+            if (s.boundary)
+            {
+                boundary += r;
+                ++n_boundary;
+            }
+            if (!s.reversed)
+                faces += Q0[index(s.side, 1, 1, m)];
+        }
+
+        Point q;
+        if (n_boundary == 0)
+        {
+            const float k = float(end - begin);
+            q = ((k - 2.0f) / k) * p + (1.0f / (k * k)) * (edges + faces);
+        }
+        else if (n_boundary == 2)
+            q = 0.75f * p + 0.125f * boundary;
+        else // non-manifold vertex, keep it
+            q = p;
+
+        for (int i = begin; i < end; ++i)
+            if (!spokes_[i].reversed)
+                Q0[index(spokes_[i].side, 0, 0, m)] = q;
+    }
+
+    points_.swap(new_points);
+    n_ = m;
+    ++level_;
+}
+
+//-----------------------------------------------------------------------------
+
+void QuadGrids::compute_normals(std::vector<Normal>& normals) const
+{
+    PMP_TRACE_SCOPE("QuadGrids::compute_normals");
+
+    normals.assign(points_.size(), Normal(0, 0, 0));
+    if (empty())
+        return;
+
+    const int n = n_;
+    const int s = n + 1;
+    const int nf = int(n_grids());
+    const int ne = int(edge_sides_.size() / 2);
+    const int nv = int(spoke_begin_.size()) - 1;
+    const Point* P0 = points_.data();
+    Normal* N0 = normals.data();
+
+    // add the normal of each quad to its corners. the cross product of the
+    // diagonals is twice the area-weighted normal.
+#pragma omp parallel for
+    for (int f = 0; f < nf; ++f)
+    {
+        const Point* P = P0 + size_t(f) * s * s;
+        Normal* N = N0 + size_t(f) * s * s;
+        for (int j = 0; j < n; ++j)
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                const int k = j * s + i;
+                const Normal c =
+                    cross(P[k + s + 1] - P[k], P[k + s] - P[k + 1]);
+                N[k] += c;
+                N[k + 1] += c;
+                N[k + s] += c;
+                N[k + s + 1] += c;
+            }
+        }
+    }
+
+    // add the quads of the neighboring grid along each control edge
+#pragma omp parallel for
+    for (int e = 0; e < ne; ++e)
+    {
+        const int a = edge_sides_[2 * e];
+        const int b = edge_sides_[2 * e + 1];
+        if (a == -1 || b == -1)
+            continue;
+        for (int t = 1; t < n; ++t)
+        {
+            const size_t ia = index(a, t, 0, n);
+            const size_t ib = index(b, n - t, 0, n);
+            N0[ia] = N0[ib] = N0[ia] + N0[ib];
+        }
+    }
+
+    // add the quads of all grids around each control vertex
+#pragma omp parallel for
+    for (int v = 0; v < nv; ++v)
+    {
+        Normal sum(0, 0, 0);
+        for (int i = spoke_begin_[v]; i < spoke_begin_[v + 1]; ++i)
+            if (!spokes_[i].reversed)
+                sum += N0[index(spokes_[i].side, 0, 0, n)];
+        for (int i = spoke_begin_[v]; i < spoke_begin_[v + 1]; ++i)
+            if (!spokes_[i].reversed)
+                N0[index(spokes_[i].side, 0, 0, n)] = sum;
+    }
+
+    const int np = int(normals.size());
+#pragma omp parallel for
+    for (int i = 0; i < np; ++i)
+        N0[i].normalize();
+}
+
+//-----------------------------------------------------------------------------
+
+void QuadGrids::extract(SurfaceMesh& mesh) const
+{
+    PMP_TRACE_SCOPE("QuadGrids::extract");
+
+    mesh.clear();
+    if (empty())
+        return;
+
+    const int n = n_;
+    const int s = n + 1;
+    const int nf = int(n_grids());
+    const size_t edge_base = n_control_vertices_;
+    const size_t face_base = edge_base + edge_sides_.size() / 2 * (n - 1);
+
+    // index of each grid point among the distinct vertices: control
+    // vertices first, then the points inside control edges, then the points
+    // inside grids
+    std::vector<IndexType> ids(points_.size());
+#pragma omp parallel for
+    for (int f = 0; f < nf; ++f)
+    {
+        for (int v = 0; v <= n; ++v)
+        {
+            for (int u = 0; u <= n; ++u)
+            {
+                size_t id;
+                if (u > 0 && u < n && v > 0 && v < n)
+                {
+                    id = face_base + size_t(f) * (n - 1) * (n - 1) +
+                         size_t(v - 1) * (n - 1) + (u - 1);
+                }
+                else
+                {
+                    int side, t;
+                    if (v == 0 && u < n)
+                    {
+                        side = 0;
+                        t = u;
+                    }
+                    else if (u == n && v < n)
+                    {
+                        side = 1;
+                        t = v;
+                    }
+                    else if (v == n && u > 0)
+                    {
+                        side = 2;
+                        t = n - u;
+                    }
+                    else
+                    {
+                        side = 3;
+                        t = n - v;
+                    }
+                    side += 4 * f;
+
+                    if (t == 0)
+                    {
+                        id = corner_vertices_[side];
+                    }
+                    else
+                    {
+                        const int se = side_edges_[side];
+                        if (se & 1)
+                            t = n - t;
+                        id = edge_base + size_t(se >> 1) * (n - 1) + (t - 1);
+                    }
+                }
+                ids[size_t(f) * s * s + v * s + u] = IndexType(id);
+            }
+        }
+    }
+
+    // add the vertices that are used, in the order of their index
+    const size_t n_ids = face_base + size_t(nf) * (n - 1) * (n - 1);
+    std::vector<IndexType> vertices(n_ids, PMP_MAX_INDEX);
+    for (size_t i = 0; i < ids.size(); ++i)
+        vertices[ids[i]] = IndexType(i);
+
+    mesh.reserve(n_vertices(), n_vertices() + n_quads(), n_quads());
+    for (auto& v : vertices)
+        if (v != PMP_MAX_INDEX)
+            v = mesh.add_vertex(points_[v]).idx();
+
+    // add the quads
+    for (int f = 0; f < nf; ++f)
+    {
+        const IndexType* id = ids.data() + size_t(f) * s * s;
+        for (int j = 0; j < n; ++j)
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                const int k = j * s + i;
+                mesh.add_quad(Vertex(vertices[id[k]]),
+                              Vertex(vertices[id[k + 1]]),
+                              Vertex(vertices[id[k + s + 1]]),
+                              Vertex(vertices[id[k + s]]));
+            }
+        }
+    }
+}
+
+//=============================================================================
@@ -0,0 +1,142 @@
+//=============================================================================
+//
+//   Exercise code for the lecture "Computer Graphics"
+//     by Prof. Mario Botsch, TU Dortmund
+//
+//   Copyright (C)  Computer Graphics Group, TU Dortmund
+//
+//=============================================================================
+#pragma once
+//=============================================================================
+
+#include <pmp/SurfaceMesh.h>
+
+#include <vector>
+
+//=============================================================================
+
+/// \brief Catmull-Clark levels of a quad mesh stored as one regular grid of
+/// points per quad.
+/// \details Each control quad holds a (n+1) x (n+1) grid of positions,
+/// n = 2^level. Grid point (u,v) of a face lies at corner 0 of the face for
+/// (0,0), at corner 1 for (n,0), at corner 2 for (n,n), and at corner 3 for
+/// (0,n), where corner i is the start vertex of the i-th halfedge of the face.
+/// Points on the control edges and vertices are stored once per adjacent
+/// face. They are computed once per edge or vertex and copied to all faces,
+/// so that the copies are identical. Only positions are stored, which takes
+/// about 12 bytes per vertex instead of the 100+ bytes of the halfedge mesh.
+class QuadGrids
+{
+public:
+    /// Constructor
+    QuadGrids();
+
+    /// start at level 0 with the quads of \p control. returns false if
+    /// \p control has faces that are not quads. \p control must not have
+    /// garbage, and is not referenced afterwards.
+    bool build(const pmp::SurfaceMesh& control);
+
+    /// remove all grids
+    void clear();
+
+    /// are there no grids?
+    bool empty() const { return points_.empty(); }
+
+    /// number of subdivision steps applied to the grids
+    int level() const { return level_; }
+
+    /// number of quads along each side of a grid (2^level)
+    int resolution() const { return n_; }
+
+    /// number of grids, one per control quad
+    size_t n_grids() const { return corner_vertices_.size() / 4; }
+
+    /// number of points per grid
+    size_t grid_size() const { return size_t(n_ + 1) * (n_ + 1); }
+
+    /// number of distinct vertices, not counting the copies on shared edges
+    size_t n_vertices() const;
+
+    /// number of quads in all grids
+    size_t n_quads() const { return n_grids() * n_ * n_; }
+
+    /// points of all grids, grid f starts at f * grid_size(), point (u,v)
+    /// of a grid at v * (resolution() + 1) + u
+    const std::vector<pmp::Point>& points() const { return points_; }
+
+    /// bytes allocated for the points and the control topology
+    size_t memory() const;
+
+    /// apply one Catmull-Clark step to all grids
+    void subdivide();
+
+    /// compute a unit vertex normal for each point, averaged over all
+    /// adjacent quads of all grids
+    void compute_normals(std::vector<pmp::Normal>& normals) const;
+
+    /// build the halfedge mesh of the current level in \p mesh, which is
+    /// cleared first
+    void extract(pmp::SurfaceMesh& mesh) const;
+
+private:
+    /// a control edge seen from a control vertex
+    struct Spoke
+    {
+        int side;      ///< side (4 * face + i) containing the edge
+        bool reversed; ///< does the side point towards the vertex?
+        bool boundary; ///< is the edge a boundary edge?
+    };
+
+    /// index in points_ of the point at position t along side \p side, at
+    /// distance d from it into the face, for grids of resolution n
+    static size_t index(int side, int t, int d, int n)
+    {
+        const int face = side >> 2;
+        int u, v;
+        switch (side & 3)
+        {
+            case 0:
+                u = t;
+                v = d;
+                break;
+            case 1:
+                u = n - d;
+                v = t;
+                break;
+            case 2:
+                u = n - t;
+                v = n - d;
+                break;
+            default:
+                u = d;
+                v = n - t;
+                break;
+        }
+        return size_t(face) * (n + 1) * (n + 1) + size_t(v) * (n + 1) + u;
+    }
+
+    /// points of all grids
+    std::vector<pmp::Point> points_;
+
+    /// number of subdivision steps and grid resolution (2^level_)
+    int level_, n_;
+
+    /// number of control vertices
+    size_t n_control_vertices_;
+
+    /// control vertex at each corner, 4 per face
+    std::vector<int> corner_vertices_;
+
+    /// 2 * edge (+1 if second side of the edge) for each side, 4 per face
+    std::vector<int> side_edges_;
+
+    /// the sides of each control edge, 2 per edge, -1 for boundary
+    std::vector<int> edge_sides_;
+
+    /// the edges around each control vertex, those of vertex v are
+    /// spokes_[spoke_begin_[v]] to spokes_[spoke_begin_[v + 1] - 1]
+    std::vector<Spoke> spokes_;
+    std::vector<int> spoke_begin_;
+};
+
+//=============================================================================
@@ -9,6 +9,9 @@
 
 #include <imgui.h>
 #include "Subdivision_Viewer.h"
+#include <pmp/Timer.h>
+#include <pmp/visualization/MemoryInfo.h>
+#include <pmp/algorithms/SurfaceNormals.h>
 #include <cfloat>
 #include <iostream>
 #include <sstream>
@@ -26,6 +29,9 @@ Subdivision_Viewer::Subdivision_Viewer(const char* title, int width, int height,
     crease_angle_ = 30.0;
     mesh_index_ = 0;
     draw_control_mesh_ = false;
+    normals_time_[0] = normals_time_[1] = 0.0;
+    update_time_[0] = update_time_[1] = 0.0;
+    report_write_ = false;
 
     // add imgui help items
     add_help_item("S", "Subdivide", 0);
@@ -41,7 +47,10 @@ bool Subdivision_Viewer::load_mesh(const char* filename)
 
     if (success)
     {
-        surface_mesh_.read(filename);
+        // share the data of the mesh just loaded by MeshViewer instead of
+        // parsing the file a second time (copy-on-write until subdivided)
+        surface_mesh_.clear_grids();
+        static_cast<pmp::SurfaceMesh&>(surface_mesh_) = mesh_;
 
         // update scene center and bounds
         pmp::BoundingBox bb = mesh_.bounds();
@@ -91,9 +100,24 @@ void Subdivision_Viewer::process_imgui()
     if (ImGui::CollapsingHeader("Mesh Info", ImGuiTreeNodeFlags_DefaultOpen))
     {
         // output mesh statistics
-        ImGui::BulletText("%d vertices", (int)surface_mesh_.n_vertices());
-        ImGui::BulletText("%d edges", (int)surface_mesh_.n_edges());
-        ImGui::BulletText("%d faces", (int)surface_mesh_.n_faces());
+        const QuadGrids& grids = surface_mesh_.grids();
+        if (grids.empty())
+        {
+            ImGui::BulletText("%d vertices", (int)surface_mesh_.n_vertices());
+            ImGui::BulletText("%d edges", (int)surface_mesh_.n_edges());
+            ImGui::BulletText("%d faces", (int)surface_mesh_.n_faces());
+            ImGui::BulletText("%d buffer vertices",
+                              (int)surface_mesh_.n_buffer_vertices());
+        }
+        else
+        {
+            ImGui::BulletText("%d grids of level %d", (int)grids.n_grids(),
+                              grids.level());
+            ImGui::BulletText("%d vertices", (int)grids.n_vertices());
+            ImGui::BulletText("%d faces", (int)grids.n_quads());
+            ImGui::BulletText("%.1f MB grid memory",
+                              grids.memory() / (1024.0 * 1024.0));
+        }
 
         ImGui::Spacing();
         ImGui::Spacing();
@@ -109,6 +133,23 @@ void Subdivision_Viewer::process_imgui()
         }
         ImGui::Spacing();
         ImGui::Spacing();
+
+        // culling of chunks of triangles
+        bool frustum_culling = surface_mesh_.frustum_culling();
+        if (ImGui::Checkbox("Frustum Culling", &frustum_culling))
+            surface_mesh_.set_frustum_culling(frustum_culling);
+        bool backface_culling = surface_mesh_.backface_culling();
+        if (ImGui::Checkbox("Backface Culling", &backface_culling))
+            surface_mesh_.set_backface_culling(backface_culling);
+        const pmp::CullingStats& stats = surface_mesh_.culling_stats();
+        ImGui::BulletText("%u chunks drawn", stats.visible);
+        ImGui::BulletText("%u outside, %u back-facing", stats.outside,
+                          stats.backface);
+
+        // memory of the mesh and of recent operations
+        pmp::show_memory_info(surface_mesh_);
+        ImGui::Spacing();
+        ImGui::Spacing();
     }
 
     if (ImGui::CollapsingHeader("Drawmode", ImGuiTreeNodeFlags_DefaultOpen))
@@ -135,7 +176,80 @@ void Subdivision_Viewer::process_imgui()
         {
             surface_mesh_.subdivide();
         }
+
+        bool use_grids = surface_mesh_.grid_subdivision();
+        if (ImGui::Checkbox("Quad Grids", &use_grids))
+            surface_mesh_.set_grid_subdivision(use_grids);
+
+        ImGui::Spacing();
+        ImGui::Spacing();
+        if (ImGui::Button("Reorder (Morton)"))
+        {
+            reorder_mesh(pmp::SurfaceMesh::MortonOrder);
+        }
+        if (ImGui::Button("Reorder (BFS)"))
+        {
+            reorder_mesh(pmp::SurfaceMesh::BreadthFirstOrder);
+        }
+        ImGui::Text("Vertex normals:\n%.2fms -> %.2fms", normals_time_[0],
+                    normals_time_[1]);
+        ImGui::Text("Buffer update:\n%.2fms -> %.2fms", update_time_[0],
+                    update_time_[1]);
+
+        if (writer_.is_writing())
+        {
+            ImGui::Spacing();
+            ImGui::Text("Writing %s", writer_.filename().c_str());
+            ImGui::ProgressBar(writer_.progress());
+
+            // keep updating the progress bar
+            request_redraw();
+        }
+        else if (report_write_)
+        {
+            report_write_ = false;
+            if (writer_.wait())
+                std::cout << "Wrote " << writer_.filename() << std::endl;
+            else
+                std::cerr << "Failed to write mesh to " << writer_.filename()
+                          << " !" << std::endl;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void Subdivision_Viewer::reorder_mesh(pmp::SurfaceMesh::Ordering ordering)
+{
+    // the grids have a fixed order, the halfedge mesh is not drawn
+    if (!surface_mesh_.grids().empty())
+    {
+        std::cerr << "Disable the quad grids to reorder the mesh !"
+                  << std::endl;
+        return;
+    }
+
+    pmp::Timer timer;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        if (i == 1)
+        {
+            surface_mesh_.reorder(ordering);
+        }
+
+        timer.start();
+        pmp::SurfaceNormals::compute_vertex_normals(surface_mesh_);
+        normals_time_[i] = timer.stop().elapsed();
+
+        timer.start();
+        surface_mesh_.update_opengl_buffers();
+        update_time_[i] = timer.stop().elapsed();
     }
+
+    // normals were only computed for timing
+    auto vnormals = surface_mesh_.get_vertex_property<pmp::Normal>("v:normal");
+    surface_mesh_.remove_vertex_property(vnormals);
 }
 
 //-----------------------------------------------------------------------------
@@ -171,9 +285,18 @@ void Subdivision_Viewer::keyboard(int key, int scancode, int action, int mods)
             break;
         }
 
-        case GLFW_KEY_O: // write mesh
+        case GLFW_KEY_O: // write mesh in the background
         {
-            surface_mesh_.write("output.off");
+            // the grids are converted first, the writer keeps a snapshot
+            pmp::SurfaceMesh mesh = surface_mesh_;
+            if (!surface_mesh_.grids().empty() && !writer_.is_writing())
+                surface_mesh_.grids().extract(mesh);
+
+            if (writer_.write(mesh, "output.off"))
+                report_write_ = true;
+            else
+                std::cerr << "Still writing " << writer_.filename() << " !"
+                          << std::endl;
             break;
         }
 
@@ -10,6 +10,7 @@
 //=============================================================================
 
 #include "Mesh.h"
+#include <pmp/AsyncMeshWriter.h>
 #include <pmp/visualization/MeshViewer.h>
 
 //=============================================================================
@@ -36,6 +37,11 @@ public:
     virtual void keyboard(int key, int code, int action, int mod) override;
 
 protected:
+    /// reorder the mesh elements for memory locality and measure the time
+    /// for computing vertex normals and updating the OpenGL buffers before
+    /// and after reordering
+    void reorder_mesh(pmp::SurfaceMesh::Ordering ordering);
+
     /// the subdivided mesh
     SubdivisionMesh surface_mesh_;
 
@@ -44,5 +50,14 @@ protected:
 
     /// index of currently loaded mesh
     int mesh_index_;
+
+    /// timings (in ms) of the last reordering, before [0] and after [1]
+    double normals_time_[2], update_time_[2];
+
+    /// writes the subdivided mesh in the background
+    pmp::AsyncMeshWriter writer_;
+
+    /// indicates if the result of the last write still has to be reported
+    bool report_write_;
 };
 //=============================================================================
@@ -0,0 +1,57 @@
+// Copyright 2011-2020 the Polygon Mesh Processing Library developers.
+// Distributed under a MIT-style license, see LICENSE.txt for details.
+
+// Regression check for the copy-on-write of property arrays: several
+// threads write to a property of a mesh copy at once, the first write of
+// each thread has to see the private data made by the first detach().
+// Build with -fsanitize=thread to check for data races.
+
+#include <pmp/SurfaceMesh.h>
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace pmp;
+
+int main()
+{
+    const int n_vertices = 100000;
+    const int n_threads = 4;
+
+    SurfaceMesh mesh;
+    auto p = mesh.add_vertex_property<int>("v:value", 0);
+    for (int i = 0; i < n_vertices; ++i)
+        mesh.add_vertex(Point(0, 0, 0));
+
+    bool ok = true;
+    for (int round = 0; round < 20 && ok; ++round)
+    {
+        // the copy shares the data of the mesh until it is written
+        SurfaceMesh copy = mesh;
+        auto q = copy.get_vertex_property<int>("v:value");
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < n_threads; ++t)
+        {
+            threads.emplace_back([&q, t]() {
+                for (int i = t; i < n_vertices; i += n_threads)
+                    q[Vertex(i)] = i + 1;
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        for (int i = 0; i < n_vertices && ok; ++i)
+        {
+            if (p[Vertex(i)] != 0 || q[Vertex(i)] != i + 1)
+            {
+                std::cerr << "copy-on-write failed at vertex " << i
+                          << " in round " << round << std::endl;
+                ok = false;
+            }
+        }
+    }
+
+    return ok ? 0 : 1;
+}